@@ -10,6 +10,7 @@ public:
   StepFilterPrimary();
   virtual ~StepFilterPrimary(){}
   virtual bool filterStep(const G4Step*step) const;
+  virtual StepFilterBase * createNew() const { return new StepFilterPrimary; }
 };
 
 #endif
@@ -11,6 +11,7 @@ public:
   virtual ~StepFilterTime(){}
   virtual void initFilter();
   virtual bool filterStep(const G4Step*) const;
+  virtual StepFilterBase * createNew() const { return new StepFilterTime; }
 private:
   virtual bool validateParameters();
   double m_minPreTime;
@@ -11,6 +11,7 @@ public:
   virtual ~StepFilterVolume(){}
   virtual void initFilter();
   virtual bool filterStep(const G4Step*) const;
+  virtual StepFilterBase * createNew() const { return new StepFilterVolume; }
 private:
   virtual bool validateParameters();
   Utils::FastLookupSet<std::string> m_volnames;//todo/fixme: should use fast string sort!!!!
@@ -1,10 +1,17 @@
 #include "G4CustomPyGenBase.hh"
+#include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Random/RandomManager.hh"
+#include <pybind11/numpy.h>
+#include <limits>
 
 G4CustomPyGen::GenBaseCpp::GenBaseCpp()
   : ParticleGenBase("_tmpname_"),//Name will be changed on python side
     m_gunwrapper(0),
     m_unlimited(true),
-    m_currentEventAborted(false)
+    m_currentEventAborted(false),
+    m_batchIdx(std::numeric_limits<std::uint64_t>::max()),
+    m_batchSize(0),
+    m_evtCount(0)
 {
 }
 
@@ -15,6 +22,7 @@ G4CustomPyGen::GenBaseCpp::~GenBaseCpp()
   m_pyfct_validatePars = py::object();
   m_pyfct_initGen = py::object();
   m_pyfct_genEvt = py::object();
+  m_pyfct_genBatch = py::object();
   delete m_gunwrapper;//todo: test what happens if user keeps ref
 }
 
@@ -29,6 +37,10 @@ void G4CustomPyGen::GenBaseCpp::init()
 
 void G4CustomPyGen::GenBaseCpp::gen( G4Event * evt )
 {
+  if (m_pyfct_genBatch) {
+    genFromBatch(evt);
+    return;
+  }
   assert(m_pyfct_genEvt);
   m_gunwrapper->setEvent(evt);
   m_pyfct_genEvt(m_gunwrapper_pyobj);
@@ -41,6 +53,102 @@ void G4CustomPyGen::GenBaseCpp::gen( G4Event * evt )
   }
 }
 
+void G4CustomPyGen::GenBaseCpp::genFromBatch( G4Event * evt )
+{
+  //Events are numbered consecutively in jobs without event indices:
+  std::uint64_t idx = FrameworkGlobals::hasCurrentEvtIndex() ? FrameworkGlobals::currentEvtIndex() : m_evtCount;
+  ++m_evtCount;
+  std::uint64_t ibatch = idx / m_batchSize;
+  if (ibatch!=m_batchIdx)
+    generateBatch(ibatch);
+  std::size_t i = idx - ibatch * m_batchSize;
+  if (i>=m_batch.size()) {
+    //Short batch from limited generator, which ran out of events:
+    signalEndOfEvents(true);
+    return;
+  }
+  const BatchEntry& e = m_batch[i];
+  m_gunwrapper->setEvent(evt);
+  m_gunwrapper->set_type(e.pdg);
+  m_gunwrapper->set_energy(e.ekin);
+  m_gunwrapper->set_position(e.pos[0],e.pos[1],e.pos[2]);
+  m_gunwrapper->set_direction(e.dir[0],e.dir[1],e.dir[2]);
+  m_gunwrapper->set_time(e.time);
+  m_gunwrapper->set_weight(e.weight);
+  m_gunwrapper->fire();
+  if (i+1==m_batch.size()&&m_batch.size()<m_batchSize)
+    signalEndOfEvents(false);
+}
+
+void G4CustomPyGen::GenBaseCpp::generateBatch( std::uint64_t ibatch )
+{
+  //Draw the random numbers of the batch from a seed derived from (but not equal
+  //to) the seed of its first event, restoring the seed of the current event
+  //afterwards. Jobs without event indices always start a batch at its first
+  //event:
+  const bool reseed = RandomManager::isInitialised();
+  if (reseed) {
+    std::uint64_t seed = ( FrameworkGlobals::hasCurrentEvtIndex()
+                           ? RandomManager::seedForEvtIndex(RandomManager::seedOfFirstEvent(),ibatch * m_batchSize)
+                           : FrameworkGlobals::currentEvtSeed() );
+    RandomManager::setEngineSeed(RandomManager::seedForEvtIndex(seed,1));
+  }
+
+  using ArrDbl = py::array_t<double,py::array::c_style|py::array::forcecast>;
+  using ArrInt = py::array_t<int,py::array::c_style|py::array::forcecast>;
+  py::object res = m_pyfct_genBatch(m_batchSize);
+  py::tuple t = res.cast<py::tuple>();
+  if (t.size()!=6)
+    throw std::runtime_error("G4CustomPyGen ERROR: generate_batch must return (pdg, ekin, pos, dir, time, weight)");
+  auto pdg = t[0].cast<ArrInt>();
+  auto ekin = t[1].cast<ArrDbl>();
+  auto pos = t[2].cast<ArrDbl>();
+  auto dir = t[3].cast<ArrDbl>();
+  const std::size_t n = pdg.ndim()==1 ? pdg.shape(0) : 0;
+  auto badShape = [n](const ArrDbl& a, bool vec) {
+    return vec ? ( a.ndim()!=2 || (std::size_t)a.shape(0)!=n || a.shape(1)!=3 ) : ( a.ndim()!=1 || (std::size_t)a.shape(0)!=n );
+  };
+  if (pdg.ndim()!=1||badShape(ekin,false)||badShape(pos,true)||badShape(dir,true))
+    throw std::runtime_error("G4CustomPyGen ERROR: generate_batch returned arrays of inconsistent shapes");
+  if (n>m_batchSize||(n<m_batchSize&&m_unlimited))
+    throw std::runtime_error("G4CustomPyGen ERROR: generate_batch(n) must return n particles (fewer only for limited generators)");
+  //Time and weight are optional:
+  ArrDbl time, weight;
+  if (!t[4].is_none()) {
+    time = t[4].cast<ArrDbl>();
+    if (badShape(time,false))
+      throw std::runtime_error("G4CustomPyGen ERROR: generate_batch returned arrays of inconsistent shapes");
+  }
+  if (!t[5].is_none()) {
+    weight = t[5].cast<ArrDbl>();
+    if (badShape(weight,false))
+      throw std::runtime_error("G4CustomPyGen ERROR: generate_batch returned arrays of inconsistent shapes");
+  }
+
+  m_batch.resize(n);
+  const int * pdgdata = pdg.data();
+  const double * ekindata = ekin.data();
+  const double * posdata = pos.data();
+  const double * dirdata = dir.data();
+  const double * timedata = t[4].is_none() ? nullptr : time.data();
+  const double * weightdata = t[5].is_none() ? nullptr : weight.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    BatchEntry& e = m_batch[i];
+    e.pdg = pdgdata[i];
+    e.ekin = ekindata[i];
+    e.time = timedata ? timedata[i] : 0.0;
+    e.weight = weightdata ? weightdata[i] : 1.0;
+    for (int j = 0; j < 3; ++j) {
+      e.pos[j] = posdata[3*i+j];
+      e.dir[j] = dirdata[3*i+j];
+    }
+  }
+  m_batchIdx = ibatch;
+
+  if (reseed)
+    RandomManager::setEngineSeed(FrameworkGlobals::currentEvtSeed());
+}
+
 bool G4CustomPyGen::GenBaseCpp::validateParameters()
 {
   if (m_pyfct_validatePars) {
@@ -67,3 +175,12 @@ void G4CustomPyGen::GenBaseCpp::regpyfct_genEvt(py::object o)
   assert(o);
   m_pyfct_genEvt=o;
 }
+
+void G4CustomPyGen::GenBaseCpp::regpyfct_genBatch(py::object o, unsigned batchsize)
+{
+  assert(o);
+  if (!batchsize)
+    throw std::runtime_error("G4CustomPyGen ERROR: batch size must be positive");
+  m_pyfct_genBatch=o;
+  m_batchSize=batchsize;
+}
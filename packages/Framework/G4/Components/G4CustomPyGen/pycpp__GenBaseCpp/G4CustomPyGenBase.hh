@@ -4,6 +4,7 @@
 #include "Core/Python.hh"
 #include "G4Interfaces/ParticleGenBase.hh"
 #include "G4GunWrapper.hh"
+#include <vector>
 
 namespace G4CustomPyGen {
 
@@ -22,20 +23,40 @@ namespace G4CustomPyGen {
     void regpyfct_validatePars(py::object);
     void regpyfct_initGen(py::object);
     void regpyfct_genEvt(py::object);
+    void regpyfct_genBatch(py::object, unsigned batchsize);
 
     virtual bool unlimited() const { return m_unlimited; }
 
+    virtual unsigned eventBatchSize() const { return m_pyfct_genBatch ? m_batchSize : 1; }
+
     void py_set_unlimited(bool u) { m_unlimited = u; }
 
     void py_signalEndOfEvents(bool u) { m_currentEventAborted = u; signalEndOfEvents(u); }
 
   protected:
     bool validateParameters();
+    //Batched generation, where the python generate_batch(n) function returns
+    //one particle for each of n events at a time. Events are grouped in batches
+    //by their index in the job, and the random numbers of a batch only depend
+    //on the index of the batch, so events stay reproducible no matter how they
+    //are distributed between processes or threads:
+    struct BatchEntry {
+      int pdg;
+      double ekin, time, weight;
+      double pos[3], dir[3];
+    };
+    void genFromBatch(G4Event*);
+    void generateBatch(std::uint64_t ibatch);
     G4GunWrapper * m_gunwrapper;
     py::object m_gunwrapper_pyobj;
     py::object m_pyfct_validatePars;
     py::object m_pyfct_initGen;
     py::object m_pyfct_genEvt;
+    py::object m_pyfct_genBatch;
+    std::vector<BatchEntry> m_batch;
+    std::uint64_t m_batchIdx;//index of the batch in m_batch
+    unsigned m_batchSize;
+    std::uint64_t m_evtCount;
     bool m_unlimited;
     bool m_currentEventAborted;
   };
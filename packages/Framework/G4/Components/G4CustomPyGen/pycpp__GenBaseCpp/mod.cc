@@ -1,10 +1,20 @@
 #include "Core/Python.hh"
 #include "G4CustomPyGenBase.hh"
 #include "G4GunWrapper.hh"
+#include "CLHEP/Random/Random.h"
+#include <pybind11/numpy.h>
 
 namespace G4CustomPyGen {
   void gun_set_type_v1(G4GunWrapper*g,const char*n) { g->set_type(n); }
   void gun_set_type_v2(G4GunWrapper*g,int pdg) { g->set_type(pdg); }
+  //Array of n flat random numbers in (0,1) for batched generation:
+  py::array_t<double> rand_array(GenBaseCpp*, std::size_t n)
+  {
+    py::array_t<double> a(n);
+    if (n)
+      CLHEP::HepRandom::getTheEngine()->flatArray(static_cast<int>(n),a.mutable_data());
+    return a;
+  }
 }
 
 PYTHON_MODULE( mod )
@@ -15,6 +25,8 @@ PYTHON_MODULE( mod )
     .def("_regpyfct_validatePars",&G4CustomPyGen::GenBaseCpp::regpyfct_validatePars)
     .def("_regpyfct_initGen",&G4CustomPyGen::GenBaseCpp::regpyfct_initGen)
     .def("_regpyfct_genEvt",&G4CustomPyGen::GenBaseCpp::regpyfct_genEvt)
+    .def("_regpyfct_genBatch",&G4CustomPyGen::GenBaseCpp::regpyfct_genBatch)
+    .def("rand_array",&G4CustomPyGen::rand_array)
     .def("_py_set_unlimited",&G4CustomPyGen::GenBaseCpp::py_set_unlimited)
     .def("signalEndOfEvents",&G4CustomPyGen::GenBaseCpp::py_signalEndOfEvents)
     ;
@@ -81,6 +81,28 @@ class AlphaHistGen(G4CustomPyGen.GenBase):
         gun.set_energy(self._esampler())
 
 
+class ThermalNeutronBatchGen(G4CustomPyGen.GenBase):
+    """Generator which produces a pencil beam of neutrons with a Maxwellian
+    energy distribution. Particles are generated for many events at a time with
+    numpy, avoiding the overhead of calling python for each event"""
+
+    batch_size = 10000
+
+    def declare_parameters(self):
+        self.addParameterDouble("temperature_kelvin",293.15)
+
+    def generate_batch(self,n):
+        import numpy as np
+        kT = self.temperature_kelvin * Units.k_Boltzmann
+        #Maxwellian in energy is a gamma distribution with shape 3/2:
+        r = self.rand_array(3*n).reshape(n,3)
+        c = np.cos(0.5*np.pi*r[:,2])
+        ekin = kT * ( -np.log(r[:,0]) - np.log(r[:,1])*c*c )
+        pos = np.zeros((n,3))
+        direction = np.zeros((n,3))
+        direction[:,2] = 1.0
+        return np.full(n,2112), ekin, pos, direction, None, None
+
 class LimitedGen(G4CustomPyGen.GenBase):
     """Example of generator which produces a finite amount of events. Here we want N
     points equidistant in some interval, but another use-case might be that of
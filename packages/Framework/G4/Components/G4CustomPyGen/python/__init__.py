@@ -34,9 +34,21 @@ class GenBase(_GenBaseCpp):
         if f:
             self._regpyfct_initGen(f)
 
+        #Batched generation with generate_batch(self,n) replaces generate_event,
+        #returning arrays (pdg, ekin, pos, dir, time, weight) with one particle
+        #for each of n events (pos and dir with shape (n,3), time and weight can
+        #be None). Random numbers should come from self.rand_array(n):
+        f = getattr(self,'generate_batch',None)#optional
+        if f:
+            bs = getattr(self,'batch_size',1000)
+            if not isinstance(bs,int) or bs<1:
+                raise ValueError('batch_size must be a positive integer')
+            self._regpyfct_genBatch(f,bs)
+            return
+
         f = getattr(self,'generate_event',None)#required
         if not f:
-            raise NotImplementedError("Must provide implementation of method generate_event(self,gun)");
+            raise NotImplementedError("Must provide implementation of method generate_event(self,gun) or generate_batch(self,n)");
         self._regpyfct_genEvt(f);
 
     def __construct_name(self):
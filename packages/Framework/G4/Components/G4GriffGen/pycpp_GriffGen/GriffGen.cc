@@ -94,19 +94,26 @@ void GriffGen::gen(G4Event*evt)
 
   assert(m_dr->eventActive());
 
-  //Check that we have step info:
-  if (m_dr->eventStorageMode()==GriffFormat::Format::MODE_MINIMAL)
+  //Check that we have step info (in MINIMAL mode, some segments might still
+  //have full step info, which is checked per track below):
+  if (m_dr->eventStorageMode()==GriffFormat::Format::MODE_MINIMAL&&!m_dr->eventHasMixedStorage())
     throw std::runtime_error("GriffGen ERROR - Can't generate particles based on events in Griff MINIMAL mode");
 
   //Simply reshoot based on first step on tracks in griff files. Either for all primary or all tracks:
+  auto firstStep = [](const GriffDataRead::Track* trk)
+  {
+    if (!trk->segmentBegin()->hasStepInfo())
+      throw std::runtime_error("GriffGen ERROR - Can't generate particles based on tracks whose first segment has no step info");
+    return trk->firstStep();
+  };
   if (m_primary_only) {
     auto trkE = m_dr->primaryTrackEnd();
     for (auto trk = m_dr->primaryTrackBegin();trk!=trkE;++trk)
-      shootPreStep(evt,trk->firstStep());
+      shootPreStep(evt,firstStep(trk));
   } else {
     auto trkE = m_dr->trackEnd();
     for (auto trk = m_dr->trackBegin();trk!=trkE;++trk)
-      shootPreStep(evt,trk->firstStep());
+      shootPreStep(evt,firstStep(trk));
   }
 }
 
@@ -29,6 +29,7 @@ public:
   virtual ~ProfiledBeamGen();
   void init();
   void gen(G4Event*);
+  ParticleGenBase * createNew() const { return new ProfiledBeamGen; }
 
 protected:
   bool validateParameters();
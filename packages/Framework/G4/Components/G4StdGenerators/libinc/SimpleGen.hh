@@ -14,6 +14,7 @@ public:
   virtual ~SimpleGen();
   void init();
   void gen(G4Event*);
+  ParticleGenBase * createNew() const { return new SimpleGen; }
 
 protected:
   bool validateParameters();
@@ -14,6 +14,7 @@ public:
   virtual ~FlexGen();
   void init();
   void gen(G4Event*);
+  ParticleGenBase * createNew() const { return new FlexGen; }
 
 protected:
   bool validateParameters();
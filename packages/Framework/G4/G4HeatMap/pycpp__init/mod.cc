@@ -2,6 +2,7 @@
 #include "Mesh/Mesh.hh"
 #include "G4ExprParser/G4SteppingASTBuilder.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/MPMergeService.hh"
 
 #include "G4Utils/GeoUtils.hh"
 #include "G4UserSteppingAction.hh"
@@ -47,6 +48,19 @@ namespace DMWriter {
 
   HeatMapSteppingAction * HeatMapSteppingAction::m_theInstance = 0;
 
+  class HeatMapMerger : public G4Interfaces::MPMerger {
+    //Merges the intermediate files of all procs in MP jobs.
+  public:
+    HeatMapMerger(HeatMapWriterPtr writer) : m_writer(writer) {}
+    virtual ~HeatMapMerger() = default;
+    const char* mergerName() const { return "HeatMapWriter"; }
+    std::vector<std::string> prepareMerge();
+    void mergeFiles(const std::string& target, const std::string& source);
+    void finishMerge(const std::string& merged);
+  private:
+    HeatMapWriterPtr m_writer;
+  };
+
   struct HeatMapEventAction : public G4UserEventAction
   {
     HeatMapEventAction() : G4UserEventAction() {}
@@ -77,7 +91,6 @@ namespace DMWriter {
     void setFilterExpression(const char *);
     void setQuantityExpression(const char *);
     void ensureWrite();
-    void merge();
     std::string cacheFile(unsigned iproc) const;
     const std::string& outputFile() const { return m_outputFile; }
 
@@ -242,11 +255,11 @@ namespace DMWriter {
 
     //register to get g4 stepping callbacks and a ensure_write_file call after G4 loop:
     HeatMapSteppingAction::registerWriter(this->shared_from_this());
-    //Register a merge callback (will only ever get invoked in parent proc in true MP jobs):
+    //Register for merging of intermediate files (only needed when the launcher
+    //will fork, and then only ever invoked in the parent proc):
     py::object pylauncher = pyextra::pyimport("G4Launcher").attr("getTheLauncher")();
-
-    py::cpp_function py_merge_function( [this](){ this->merge(); } );
-    pylauncher.attr("postmp_hook")( py_merge_function );
+    if (pylauncher.attr("getMultiProcessing")().cast<unsigned>()>1)
+      G4Interfaces::MPMergeService::registerMerger(std::make_shared<HeatMapMerger>(this->shared_from_this()));
   }
 
   void HeatMapWriter::setComments(const char * c)
@@ -310,8 +323,8 @@ namespace DMWriter {
 
     std::string fn = m_outputFile;
     if (FrameworkGlobals::isForked()) {
-      if (FrameworkGlobals::isParent())
-        return;//parent in MP job only writes final file after merging.
+      //all procs in MP job write intermediate files, which are merged into the
+      //final file afterwards:
       fn = cacheFile(FrameworkGlobals::mpID());
       printf("HeatMapWriter: Writing intermediate result from proc%i\n",FrameworkGlobals::mpID());
     } else {
@@ -323,27 +336,36 @@ namespace DMWriter {
       printf("HeatMapWriter: Done\n");
   }
 
-  void HeatMapWriter::merge() {
-    ensureWrite();
-
-    //Ok, we now have nprocs-1 temporary output files from child procs from which
-    //we must merge results (always in the same order due to non-commutativity of
-    //floating point addition).
-
+  std::vector<std::string> HeatMapMerger::prepareMerge()
+  {
+    m_writer->ensureWrite();
+    std::vector<std::string> files;
     unsigned nprocs = FrameworkGlobals::nProcs();
-    for (unsigned i = 1; i < nprocs; ++i) {
-      std::string fnother = cacheFile(i);
-      printf("HeatMapWriter: Merging output of proc%i into proc0\n",i);
-      m_mesh.merge(fnother);
-      int rr = remove(fnother.c_str());
-      if (rr)
-        printf("HeatMapWriter: WARNING - Could not remove file after merging: %s\n",fnother.c_str());
+    for (unsigned i = 0; i < nprocs; ++i)
+      files.push_back(m_writer->cacheFile(i));
+    return files;
+  }
 
-    }
-    printf("HeatMapWriter: Done merging output from %i processes.\n",nprocs);
-    printf("HeatMapWriter: Writing result to %s\n",m_outputFile.c_str());
-    m_mesh.saveToFile(m_outputFile);
-    m_mesh.filler().data().clear();
+  void HeatMapMerger::mergeFiles(const std::string& target, const std::string& source)
+  {
+    //Only ever summing files pairwise in a fixed order, keeping results
+    //reproducible despite the non-commutativity of floating point addition.
+    //
+    //The target is loaded fully, but the packed cell data of the source is
+    //streamed directly into it by Mesh::merge, so each merge thread holds at
+    //most one mesh in memory - no more than each process held while
+    //simulating:
+    Mesh::Mesh<3> mesh(target);
+    mesh.merge(source);
+    mesh.saveToFile(target);
+  }
+
+  void HeatMapMerger::finishMerge(const std::string& merged)
+  {
+    const std::string& fn = m_writer->outputFile();
+    printf("HeatMapWriter: Writing result to %s\n",fn.c_str());
+    if (std::rename(merged.c_str(),fn.c_str()))
+      throw std::runtime_error("HeatMapWriter: Could not move merged result into place");
     printf("HeatMapWriter: Done\n");
   }
 
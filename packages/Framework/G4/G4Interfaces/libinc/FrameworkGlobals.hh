@@ -8,9 +8,20 @@
 namespace FrameworkGlobals {
 
   //Random seed info for current event (might be useful to put in error
-  //messages, embed in output files, etc.):
+  //messages, embed in output files, etc.). In multi-threaded Geant4, each
+  //thread has its own current event:
   std::uint64_t currentEvtSeed();
 
+  //Index of the current event within the whole job, when events are
+  //distributed between several processes (not available otherwise):
+  bool hasCurrentEvtIndex();
+  std::uint64_t currentEvtIndex();
+
+  //Number of events in the earlier runs of the job. Event IDs of
+  //multi-threaded Geant4 restart at 0 in each run, so this is added to them to
+  //get the index of the event within the whole job:
+  std::uint64_t nEvtsEarlierRuns();
+
   //Multi-process info (mpID is useful for constructing uniquely named output
   //files, etc.):
   bool isForked();
@@ -18,6 +29,10 @@ namespace FrameworkGlobals {
   bool isChild();
   unsigned mpID();
   unsigned nProcs();
+  //Whether the job will be forked into several processes at its first event
+  //(for preparations which must happen before forking, as the generator init()
+  //is called before the fork):
+  bool forkScheduled();
 
   //Global print prefix for printing within the framework:
   const char * printPrefix();
@@ -28,6 +43,10 @@ namespace FrameworkGlobals {
   //Methods to be used only by the multi-process framework:
   void setMpID(unsigned);//0 for parent, 1 .. Nproc-1 for childs
   void setNProcs(unsigned);
+  void setForkScheduled();
+  void setCurrentEvtIndex(std::uint64_t);
+  //Method to be used only by the launcher (between runs):
+  void setNEvtsEarlierRuns(std::uint64_t);
   //Method to be used only by launcher/multi-process framework:
   void setPrintPrefix(const char*);
 }
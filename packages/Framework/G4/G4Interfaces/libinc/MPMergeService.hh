@@ -0,0 +1,49 @@
+#ifndef G4Interfaces_MPMergeService_hh
+#define G4Interfaces_MPMergeService_hh
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Service for merging per-process output files at the end of multi-process
+// jobs. Output components (heatmaps, MCPL files, ...) register an MPMerger in
+// the parent process, and after all children finished successfully the
+// launcher merges the files of all registered components together, using a
+// pairwise tree reduction on a pool of threads.
+//
+// The reduction is deterministic: in round k, the file of proc i is merged into
+// the file of proc i-2^k (for all i which are odd multiples of 2^k), and the
+// final result ends up in the file of proc0. Merges of different pairs (and of
+// different components) run concurrently, so mergeFiles must not touch state
+// shared with other invocations. Source files are removed after being merged.
+
+namespace G4Interfaces {
+
+  class MPMerger {
+  public:
+    MPMerger() = default;
+    virtual ~MPMerger() = default;
+    //Name used in printouts:
+    virtual const char* mergerName() const = 0;
+    //Called in the main thread before merging. Must finish writing the output
+    //of the parent process and return the names of the per-process files,
+    //ordered by mpID (empty to skip merging):
+    virtual std::vector<std::string> prepareMerge() = 0;
+    //Merge the contents of source into target (might be called concurrently
+    //for different files):
+    virtual void mergeFiles(const std::string& target, const std::string& source) = 0;
+    //Called in the main thread when all files were merged into merged:
+    virtual void finishMerge(const std::string& merged) { (void)merged; }
+  };
+
+  namespace MPMergeService {
+    void registerMerger(std::shared_ptr<MPMerger>);
+    //Forget about registered mergers without running them:
+    void clearMergers();
+    //Merge the files of all registered mergers and forget about them
+    //(nthreads=0 means one thread per hardware core):
+    void runMergers(unsigned nthreads = 0);
+  }
+}
+
+#endif
@@ -58,6 +58,20 @@ namespace G4Interfaces {
     //returns true if generator has signalled end of events:
     bool reachedLimit() const;
 
+    //Generators producing their events in batches of consecutive event indices
+    //(see FrameworkGlobals::currentEvtIndex) can return the batch size, so
+    //the framework distributes events between processes and threads in whole
+    //batches and no batch is generated by more than one of them:
+    virtual unsigned eventBatchSize() const { return 1; }
+
+    //Generators which can be used in multi-threaded Geant4 (where each worker
+    //thread needs its own generator instance) must reimplement createNew() to
+    //return a new default-constructed instance of the same class. The
+    //createWorkerInstance() method uses it to return a new instance with the
+    //same name and parameter values as this one (or null if not supported):
+    virtual ParticleGenBase * createNew() const { return 0; }
+    ParticleGenBase * createWorkerInstance() const;
+
   protected:
     //convenient access to random numbers:
     double rand();// flat in 0..1
@@ -27,6 +27,13 @@ namespace G4Interfaces {
     //reimplement if you need initialisation:
     virtual void initFilter() {};
 
+    //Filters which can be used in multi-threaded Geant4 must reimplement
+    //createNew() to return a new default-constructed instance of the same
+    //class. The createWorkerInstance() method uses it to return a new instance
+    //with the same parameter values as this one (or null if not supported):
+    virtual StepFilterBase * createNew() const { return 0; }
+    StepFilterBase * createWorkerInstance() const;
+
     bool negated() const {
       if (m_negated==-1)
         m_negated = getParameterBoolean("filter_negated") ? 1 : 0;
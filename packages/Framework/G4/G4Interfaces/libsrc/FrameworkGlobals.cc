@@ -4,10 +4,30 @@
 
 namespace FrameworkGlobals {
 
-  static std::uint64_t s_currentEvtSeed = 0;
+  //(per thread, since worker threads of multi-threaded Geant4 simulate
+  //different events concurrently):
+  static
+#ifdef G4MULTITHREADED //protect thread_local keyword to avoid potential headaches in ST builds
+  thread_local
+#endif
+    std::uint64_t s_currentEvtSeed = 0;
   std::uint64_t currentEvtSeed() { return s_currentEvtSeed; }
   void setCurrentEvtSeed(std::uint64_t& s) { s_currentEvtSeed = s; }
 
+  static
+#ifdef G4MULTITHREADED
+  thread_local
+#endif
+    std::uint64_t s_currentEvtIndex = UINT64_MAX;
+  bool hasCurrentEvtIndex() { return s_currentEvtIndex!=UINT64_MAX; }
+  std::uint64_t currentEvtIndex() { return s_currentEvtIndex; }
+  void setCurrentEvtIndex(std::uint64_t i) { s_currentEvtIndex = i; }
+
+  //(shared by all threads, only set by the master thread between runs):
+  static std::uint64_t s_nEvtsEarlierRuns = 0;
+  std::uint64_t nEvtsEarlierRuns() { return s_nEvtsEarlierRuns; }
+  void setNEvtsEarlierRuns(std::uint64_t n) { s_nEvtsEarlierRuns = n; }
+
   static int s_mpID = INT_MAX;
   void setMpID(unsigned mpid) { s_mpID = mpid; }
   bool isForked() { return s_mpID!=INT_MAX; }
@@ -19,6 +39,10 @@ namespace FrameworkGlobals {
   void setNProcs(unsigned n) { s_nprocs = n; }
   unsigned nProcs() { return s_nprocs; }
 
+  static bool s_forkScheduled = false;
+  void setForkScheduled() { s_forkScheduled = true; }
+  bool forkScheduled() { return s_forkScheduled; }
+
   //Global print prefix:
   static std::string s_printPrefix = "";
   const char * printPrefix() { return s_printPrefix.c_str(); }
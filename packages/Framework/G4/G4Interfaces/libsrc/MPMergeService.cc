@@ -0,0 +1,119 @@
+#include "G4Interfaces/MPMergeService.hh"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace G4Interfaces {
+  namespace MPMergeService {
+
+    static std::vector<std::shared_ptr<MPMerger>> s_mergers;
+
+    void registerMerger(std::shared_ptr<MPMerger> m)
+    {
+      if (!m)
+        throw std::runtime_error("MPMergeService::registerMerger called with null merger");
+      for (auto& e : s_mergers)
+        if (e==m)
+          throw std::runtime_error("MPMergeService::registerMerger: Attempting to register the same merger more than once");
+      s_mergers.push_back(m);
+    }
+
+    void clearMergers() { s_mergers.clear(); }
+
+    namespace {
+      struct MergeJob {
+        MPMerger * merger;
+        const std::string * target;
+        const std::string * source;
+      };
+
+      void runJobs(const std::vector<MergeJob>& jobs, unsigned nthreads)
+      {
+        std::atomic<std::size_t> nextJob(0);
+        std::atomic<bool> failed(false);
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+        auto worker = [&]()
+        {
+          try {
+            std::size_t ijob;
+            while (!failed && (ijob = nextJob++) < jobs.size()) {
+              const MergeJob& job = jobs[ijob];
+              job.merger->mergeFiles(*job.target,*job.source);
+              if (std::remove(job.source->c_str()))
+                printf("%s: WARNING - Could not remove file after merging: %s\n",job.merger->mergerName(),job.source->c_str());
+            }
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!firstError)
+              firstError = std::current_exception();
+            failed = true;
+          }
+        };
+        unsigned nworkers = std::min<std::size_t>(nthreads,jobs.size());
+        if (nworkers<=1) {
+          worker();
+        } else {
+          std::vector<std::thread> threads;
+          threads.reserve(nworkers);
+          for (unsigned i = 0; i < nworkers; ++i)
+            threads.emplace_back(worker);
+          for (auto& t : threads)
+            t.join();
+        }
+        if (firstError)
+          std::rethrow_exception(firstError);
+      }
+    }
+
+    void runMergers(unsigned nthreads)
+    {
+      std::vector<std::shared_ptr<MPMerger>> mergers;
+      mergers.swap(s_mergers);
+      if (mergers.empty())
+        return;
+      if (!nthreads)
+        nthreads = std::max<unsigned>(1,std::thread::hardware_concurrency());
+
+      auto t0 = std::chrono::steady_clock::now();
+
+      std::vector<std::vector<std::string>> files;
+      files.reserve(mergers.size());
+      std::size_t nmax(0);
+      for (auto& m : mergers) {
+        files.push_back(m->prepareMerge());
+        nmax = std::max(nmax,files.back().size());
+      }
+
+      //Pairwise tree reduction, pooling the jobs of all mergers in each round:
+      std::vector<MergeJob> jobs;
+      unsigned iround(0);
+      for (std::size_t stride = 1; stride < nmax; stride *= 2) {
+        jobs.clear();
+        for (std::size_t im = 0; im < mergers.size(); ++im) {
+          const auto& f = files.at(im);
+          for (std::size_t i = 0; i + stride < f.size(); i += 2*stride)
+            jobs.push_back({mergers[im].get(),&f[i],&f[i+stride]});
+        }
+        printf("MPMergeService: Merge round %i with %i file pairs\n",++iround,(int)jobs.size());
+        runJobs(jobs,nthreads);
+      }
+
+      for (std::size_t im = 0; im < mergers.size(); ++im) {
+        if (files.at(im).empty())
+          continue;
+        mergers[im]->finishMerge(files[im].front());
+        printf("%s: Done merging output from %i processes into %s\n",mergers[im]->mergerName(),
+               (int)files[im].size(),files[im].front().c_str());
+      }
+
+      double dt = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+      printf("MPMergeService: Merged output of %i components in %g seconds\n",(int)mergers.size(),dt);
+    }
+  }
+}
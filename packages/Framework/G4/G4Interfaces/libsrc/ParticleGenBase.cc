@@ -6,6 +6,10 @@
 #include "G4RunManager.hh"
 #include "G4Utils/Flush.hh"
 #include <stdexcept>
+#include <limits>
+#ifdef G4MULTITHREADED
+#  include "G4Threading.hh"
+#endif
 
 class ParticleGenBaseAction : public G4VUserPrimaryGeneratorAction
 {
@@ -21,6 +25,19 @@ public:
       m_first=false;
     }
 
+#ifdef G4MULTITHREADED
+    //Worker threads take events in whatever order they become free, so expose
+    //the index of the event within the job (for seeding). Event IDs restart in
+    //each run, so they are offset by the events of earlier runs to match:
+    if (G4Threading::IsWorkerThread()) {
+      std::uint64_t idx = FrameworkGlobals::nEvtsEarlierRuns() + (std::uint64_t)evt->GetEventID();
+      if (idx>(std::uint64_t)std::numeric_limits<G4int>::max())
+        throw std::runtime_error("Event index too large for G4 event ID");
+      evt->SetEventID((G4int)idx);
+      FrameworkGlobals::setCurrentEvtIndex(idx);
+    }
+#endif
+
     //Fire pre-generation callbacks:
     {
       auto cbIt = m_gen->m_pregencallbacks.begin();
@@ -176,3 +193,13 @@ bool G4Interfaces::ParticleGenBase::reachedLimit() const
 {
   return m_signalledEOE;
 }
+
+G4Interfaces::ParticleGenBase * G4Interfaces::ParticleGenBase::createWorkerInstance() const
+{
+  ParticleGenBase * g = createNew();
+  if (!g)
+    return 0;
+  g->setName(getName());
+  g->setParametersFrom(*this);
+  return g;
+}
@@ -24,3 +24,13 @@ void G4Interfaces::StepFilterBase::dump(const char * prefix) const
   p+="  ";
   Utils::ParametersBase::dump(p.c_str());
 }
+
+G4Interfaces::StepFilterBase * G4Interfaces::StepFilterBase::createWorkerInstance() const
+{
+  StepFilterBase * f = createNew();
+  if (!f)
+    return 0;
+  f->m_name = m_name;
+  f->setParametersFrom(*this);
+  return f;
+}
@@ -107,10 +107,24 @@ namespace G4Launcher {
     void setParticleGun(const char* particleName, double eKin, const G4ThreeVector& pos,const G4ThreeVector& momdir);
     //void setParticleGun(int pdgcode, const G4ThreeVector& pos,const G4ThreeVector& momdir);
 
-    //Target GRIFF file. Use "none" to disable GRIFF output (mode must be FULL, REDUCED or MINIMAL):
-    void setOutput(const char* filename, const char * mode = "FULL");
+    //Target GRIFF file. Use "none" to disable GRIFF output (mode must be FULL,
+    //REDUCED or MINIMAL and compression one of those in G4DataCollect.hh, like
+    //none, zlib, zlib-N, lz4, lz4-N, zstd or zstd-N):
+    void setOutput(const char* filename, const char * mode = "FULL", const char * compression = "zlib");
     void closeOutput();//Hook for expert users to close the Griff file early.
 
+    //Skip writing events for which the expression is true to the GRIFF file
+    //(see G4DataCollect::setEventVeto for the available variables):
+    void setOutputVeto(const char* expression);
+
+    //Keep full step data for segments in the listed volumes even in REDUCED
+    //and MINIMAL modes (see G4DataCollect::setFullStepVolumes):
+    void setOutputFullStepVolumes(const char* volumeList);
+
+    //Encoding of GRIFF step data, STANDARD (default) or COMPACT (see
+    //G4DataCollect::setStepEncoding):
+    void setOutputStepEncoding(const char* encoding);
+
     void noRandomSetup();
     void setSeed(std::uint64_t seed);
 
@@ -119,10 +133,16 @@ namespace G4Launcher {
     void setRndEvtMsgMode(const char * mode);
     const std::string& rndEvtMsgMode() const;//mode or empty if setRndEvtMsgMode never called
 
+    //Mode of the random engine ("STRICT" or "BATCHED", see G4Random/NCG4RngEngine.hh).
+    //The default STRICT mode reproduces the random numbers of earlier releases,
+    //while BATCHED mode generates numbers faster, but gives different events:
+    void setRndEngineMode(const char * mode);
+    const std::string& rndEngineMode() const;//mode or empty if setRndEngineMode never called
+
     //To avoid conflicts with the GRIFF file hooks, register custom stepping and
     //event actions here rather than with the run-manager. Note that you should
     //only construct your action class instances *after* calling init() on the
-    //launcher:
+    //launcher (in multi-threaded mode, from a worker init hook):
     void setUserSteppingAction(G4UserSteppingAction*);
     void setUserEventAction(G4UserEventAction*);
 
@@ -148,9 +168,49 @@ namespace G4Launcher {
     //Preliminary support for multi-process execution. Only use when both seed
     //and output are controlled by the standards above. Note that the final
     //result after calling startSimulation(nevts) will be nprocs outputfiles,
-    //each with nevts evts inside:
+    //sharing the nevts evts between them. Processes pull events dynamically, so
+    //how many end up in each file varies, but the seed of each event depends
+    //only on its index in the job:
     void setMultiProcessing(unsigned nprocs);
 
+    //Alternatively, simulate with nthreads Geant4 worker threads in a single
+    //process (requires Geant4 built with multi-threading support, and must be
+    //called before getRunManager()). Each worker thread gets its own copy of
+    //the generator and filters, so these must implement createNew() (their
+    //parameters are copied when the simulation starts). The seed of each event
+    //depends only on its event ID, and each worker thread writes its own GRIFF
+    //file (named like output.tN.griff), covering all its runs and closed when
+    //the worker threads stop (at shutdown or closeOutput()). Visualisation,
+    //interactive sessions and pre/post-generation hooks are not supported, and
+    //custom user actions must be set from worker init hooks (see below):
+    void setThreads(unsigned nthreads);
+
+    //Checkpoint long single-process jobs every nevents events and/or every
+    //minutes minutes (0 disables either). The GRIFF output is then written in
+    //segment files (output.seg0.griff, output.seg1.griff, ...), with a new
+    //segment started at each checkpoint, and a manifest (output.checkpoint)
+    //records the progress. The seed of each event depends only on its index in
+    //the job. Requires a generator with an unlimited number of events:
+    void setCheckpoint(unsigned nevents, double minutes = 0.0);
+    //Continue a killed checkpointed job from its manifest (with the same seed,
+    //generator, checkpoint settings and number of events). Segments started by
+    //event counts end up identical to those of an uninterrupted job:
+    void setResume(bool b = true);
+
+    //Derive the seed of each event in a single-process job from its index in
+    //the job (as is always done in multi-processing, multi-threaded and
+    //checkpointed jobs), rather than from the random stream at the end of the
+    //previous event. Results are then independent of how the job is split up,
+    //and any event can be rerun on its own by starting the job at its index
+    //with setFirstEvent (the G4 event ID of each event will be its index). Only
+    //events of generators without state carried between events are exactly
+    //reproduced this way:
+    void setIndexedSeeding(bool b = true);
+    //Index of the first event to simulate in a single-process job (implies
+    //setIndexedSeeding). Requires a generator with an unlimited number of events,
+    //and indices must fit in a G4int (the job fails at an event beyond that):
+    void setFirstEvent(std::uint64_t idx);
+
     //Register custom user data to be embedded in the output griff file:
     void setUserData(const char* key, const char* value);
 
@@ -160,10 +220,20 @@ namespace G4Launcher {
 
     //getters:
     unsigned getMultiProcessing() const;
+    unsigned getThreads() const;
+    unsigned getCheckpointEvents() const;
+    double getCheckpointMinutes() const;
+    bool getResume() const;
+    bool getIndexedSeeding() const;
+    std::uint64_t getFirstEvent() const;
     bool GetNoRandomSetup() const;
     std::uint64_t getSeed() const;
     const char* getOutputFile() const;
     const char* getOutputMode() const;
+    const char* getOutputCompression() const;
+    const char* getOutputVeto() const;//empty if not set
+    const char* getOutputFullStepVolumes() const;//empty if not set
+    const char* getOutputStepEncoding() const;
     const char* getVis() const;
     const char* getPhysicsList() const;
     G4Interfaces::GeoConstructBase* getGeo() const;
@@ -190,9 +260,15 @@ namespace G4Launcher {
     //hook called after simulation is done (will be called in all process in
     //case of multiprocessing):
     void addPostSimHook(HookFctPtr);
+    //hook called in each worker thread in multi-threaded mode, after the
+    //generator and GRIFF hooks of the thread are set up (the place to call
+    //setUserSteppingAction/setUserEventAction). Without worker threads, it is
+    //simply called once in init(), just before the post-init hooks:
+    void addWorkerInitHook(HookFctPtr);
     //hook called in parent process only, when multiprocessing only, and only
-    //after all children finished successfully (can be used to merge output
-    //files):
+    //after all children finished successfully (output components should
+    //rather merge their files by registering with G4Interfaces::MPMergeService,
+    //which runs just before these hooks):
     void addPostMPHook(HookFctPtr);
     //Hooks to be installed on the generator:
     void addPreGenHook(std::shared_ptr<G4Interfaces::PreGenCallBack>);
@@ -28,6 +28,7 @@ namespace G4Launcher {
     virtual ~SingleParticleGun();
     void init();
     void gen(G4Event*);
+    ParticleGenBase * createNew() const { return new SingleParticleGun; }
 
   protected:
     bool validateParameters();
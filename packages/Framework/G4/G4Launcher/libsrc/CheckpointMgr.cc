@@ -0,0 +1,190 @@
+#include "CheckpointMgr.hh"
+#include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4DataCollect/G4DataCollect.hh"
+#include "G4Utils/Flush.hh"
+#include "Core/String.hh"
+#include "G4Event.hh"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace G4Launcher {
+  namespace {
+    //Make sure the contents of a (closed) file actually reached the disk:
+    void syncFile(const std::string& fn)
+    {
+      int fd = ::open(fn.c_str(),O_RDONLY);
+      if (fd<0)
+        return;
+      ::fsync(fd);
+      ::close(fd);
+    }
+
+    //Events get the G4 event ID of their index in the job (which only makes a
+    //difference in resumed jobs). CheckpointMgr::beginSimulation ensures that
+    //all indices fit in a G4int:
+    class CheckpointEventIDs : public G4Interfaces::PostGenCallBack {
+    public:
+      virtual void postGen(G4Event* evt)
+      {
+        assert(FrameworkGlobals::currentEvtIndex()<=(std::uint64_t)std::numeric_limits<G4int>::max());
+        evt->SetEventID((G4int)FrameworkGlobals::currentEvtIndex());
+      }
+    };
+  }
+}
+
+G4Launcher::CheckpointMgr::CheckpointMgr(const std::string& outputFile, unsigned nevtsInterval, double minutesInterval,
+                                         std::uint64_t seed, const std::string& genName)
+  : m_base(outputFile),
+    m_nevtsInterval(nevtsInterval),
+    m_minutesInterval(minutesInterval),
+    m_seed(seed),
+    m_genName(genName),
+    m_nevents(0),
+    m_startEvt(0),
+    m_nextEvt(0),
+    m_segment(0),
+    m_resumed(false),
+    m_lastTime(std::chrono::steady_clock::now())
+{
+  if (Core::ends_with(m_base,".griff"))
+    m_base.resize(m_base.size()-6);
+  m_manifest = m_base + ".checkpoint";
+}
+
+G4Launcher::CheckpointMgr::~CheckpointMgr()
+{
+}
+
+std::string G4Launcher::CheckpointMgr::segmentFile(unsigned iseg) const
+{
+  std::ostringstream tmp;
+  tmp << m_base << ".seg" << iseg << ".griff";
+  return tmp.str();
+}
+
+void G4Launcher::CheckpointMgr::resume()
+{
+  std::ifstream fh(m_manifest);
+  if (!fh.good()) {
+    printf("%sERROR: Could not open checkpoint manifest %s\n",FrameworkGlobals::printPrefix(),m_manifest.c_str());
+    throw std::runtime_error("Missing checkpoint manifest");
+  }
+  std::map<std::string,std::string> entries;
+  std::string line;
+  while (std::getline(fh,line)) {
+    if (line.empty()||line[0]=='#')
+      continue;
+    auto i = line.find(' ');
+    if (i==std::string::npos)
+      throw std::runtime_error("Invalid line in checkpoint manifest");
+    entries[line.substr(0,i)] = line.substr(i+1);
+  }
+  auto get = [&entries](const char* key) {
+    auto it = entries.find(key);
+    if (it==entries.end())
+      throw std::runtime_error(std::string("Checkpoint manifest misses entry for ")+key);
+    return it->second;
+  };
+  std::uint64_t seed = std::stoull(get("seed"));
+  std::string genName = get("generator");
+  unsigned nevtsInterval = (unsigned)std::stoul(get("checkpointevents"));
+  m_nevents = std::stoull(get("nevents"));
+  m_nextEvt = m_startEvt = std::stoull(get("nextevent"));
+  m_segment = (unsigned)std::stoul(get("segment"));
+  if (seed!=m_seed||genName!=m_genName||nevtsInterval!=m_nevtsInterval) {
+    printf("%sERROR: Checkpoint manifest %s was written by a job with different seed, generator or checkpoint interval\n",
+           FrameworkGlobals::printPrefix(),m_manifest.c_str());
+    throw std::runtime_error("Inconsistent checkpoint manifest");
+  }
+  m_resumed = true;
+  std::cout << FrameworkGlobals::printPrefix() << "Resuming from checkpoint in " << m_manifest
+            << " with event " << m_nextEvt << " of " << m_nevents << " (segment " << m_segment << ")" << std::endl;
+}
+
+void G4Launcher::CheckpointMgr::installOn(G4Interfaces::ParticleGenBase* gen)
+{
+  assert(gen);
+  gen->installPreGenCallBack(shared_from_this());
+  gen->installPostGenCallBack(std::make_shared<CheckpointEventIDs>());
+}
+
+std::uint64_t G4Launcher::CheckpointMgr::beginSimulation(std::uint64_t nevents)
+{
+  if (m_resumed&&nevents!=m_nevents) {
+    printf("%sERROR: Resumed job must simulate the same number of events as the original job (%llu)\n",
+           FrameworkGlobals::printPrefix(),(long long unsigned)m_nevents);
+    throw std::runtime_error("Inconsistent number of events in resumed job");
+  }
+  if (nevents>(std::uint64_t)std::numeric_limits<G4int>::max()+1) {
+    printf("%sERROR: Checkpointed jobs can simulate at most %llu events (the G4 event ID of each event is its index in the job)\n",
+           FrameworkGlobals::printPrefix(),(long long unsigned)std::numeric_limits<G4int>::max()+1);
+    throw std::runtime_error("Too many events in checkpointed job");
+  }
+  m_nevents = nevents;
+  writeManifest();
+  m_lastTime = std::chrono::steady_clock::now();
+  return m_nevents > m_nextEvt ? m_nevents - m_nextEvt : 0;
+}
+
+void G4Launcher::CheckpointMgr::endSimulation()
+{
+  syncFile(griffFile());
+  writeManifest();
+  printf("%sJob complete, checkpoint manifest %s updated\n",FrameworkGlobals::printPrefix(),m_manifest.c_str());
+}
+
+void G4Launcher::CheckpointMgr::preGen()
+{
+  if (m_nextEvt!=m_startEvt) {
+    if ((m_nevtsInterval&&m_nextEvt%m_nevtsInterval==0)
+        ||(m_minutesInterval>0.0&&std::chrono::duration<double>(std::chrono::steady_clock::now()-m_lastTime).count()>=60.0*m_minutesInterval))
+      checkpoint();
+  }
+  FrameworkGlobals::setCurrentEvtIndex(m_nextEvt++);
+}
+
+void G4Launcher::CheckpointMgr::checkpoint()
+{
+  //Close the current segment and continue in the next, then record where to
+  //resume from:
+  std::string prevFile = griffFile();
+  ++m_segment;
+  G4DataCollect::startNewFile(griffFile().c_str());
+  syncFile(prevFile);
+  writeManifest();
+  m_lastTime = std::chrono::steady_clock::now();
+  G4Utils::flush();
+  std::cout << FrameworkGlobals::printPrefix() << "Checkpoint after " << m_nextEvt
+            << " events, continuing in " << griffFile() << std::endl;
+}
+
+void G4Launcher::CheckpointMgr::writeManifest() const
+{
+  //Write to a temporary file which replaces the manifest in one go, so the
+  //manifest is always complete:
+  std::string tmpfn = m_manifest + ".tmp";
+  {
+    std::ofstream fh(tmpfn);
+    fh << "# G4Launcher checkpoint manifest\n"
+       << "seed " << m_seed << "\n"
+       << "generator " << m_genName << "\n"
+       << "checkpointevents " << m_nevtsInterval << "\n"
+       << "nevents " << m_nevents << "\n"
+       << "nextevent " << m_nextEvt << "\n"
+       << "segment " << m_segment << "\n";
+    if (!fh.good())
+      throw std::runtime_error("Could not write checkpoint manifest");
+  }
+  syncFile(tmpfn);
+  if (std::rename(tmpfn.c_str(),m_manifest.c_str()))
+    throw std::runtime_error("Could not update checkpoint manifest");
+}
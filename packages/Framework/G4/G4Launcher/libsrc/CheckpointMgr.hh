@@ -0,0 +1,78 @@
+#ifndef G4Launcher_CheckpointMgr_hh
+#define G4Launcher_CheckpointMgr_hh
+
+#include "G4Interfaces/ParticleGenBase.hh"
+#include <chrono>
+#include <memory>
+#include <string>
+
+//Periodic checkpointing of long single-process jobs, scheduled during
+//initialisation like:
+//
+//  auto ckpt = std::make_shared<G4Launcher::CheckpointMgr>("output.griff",nevts,minutes,seed,mygen->getName());
+//  ckpt->installOn(mygen);
+//
+//Each event gets a global index, available through
+//FrameworkGlobals::currentEvtIndex() and used for seeding (as when events are
+//distributed between processes), so events do not depend on the events
+//simulated before them. Every N events (and/or T minutes), the GRIFF output is
+//continued in a new segment file (output.segN.griff), after the previous
+//segment was closed and synced to disk, and a small manifest file
+//(output.checkpoint) is updated with the index of the next event and segment.
+//
+//A job resumed from the manifest (with the same seed, generator and number of
+//events) starts over from the next event, rewriting the segment it was in when
+//interrupted, so the segment files end up identical to those of an
+//uninterrupted job (for segments started by event counts, not timers). Only
+//generators with an unlimited number of events and no state carried between
+//events are supported.
+
+namespace G4Launcher {
+
+  class CheckpointMgr : public G4Interfaces::PreGenCallBack {
+  public:
+    CheckpointMgr(const std::string& outputFile, unsigned nevtsInterval, double minutesInterval,
+                  std::uint64_t seed, const std::string& genName);
+    virtual ~CheckpointMgr();
+
+    //Continue from the manifest of an earlier job (must be called before
+    //installOn, throws if missing or inconsistent):
+    void resume();
+
+    //Install as pre-gen callback (must happen before the random manager is
+    //attached) and as post-gen callback (making G4 event IDs equal the indices):
+    void installOn(G4Interfaces::ParticleGenBase*);
+
+    //Name of the GRIFF file for the current segment:
+    std::string griffFile() const { return segmentFile(m_segment); }
+
+    //At start of simulation, returns the number of events left to simulate
+    //(and writes the initial manifest). Throws if the indices of the events
+    //would not fit in G4 event IDs. At the end, the manifest marks the job
+    //complete (call after closing the GRIFF output):
+    std::uint64_t beginSimulation(std::uint64_t nevents);
+    void endSimulation();
+
+    virtual void preGen();
+
+  private:
+    std::string segmentFile(unsigned iseg) const;
+    void checkpoint();
+    void writeManifest() const;
+    std::string m_base;//output file name without extension
+    std::string m_manifest;
+    unsigned m_nevtsInterval;
+    double m_minutesInterval;
+    std::uint64_t m_seed;
+    std::string m_genName;
+    std::uint64_t m_nevents;
+    std::uint64_t m_startEvt;
+    std::uint64_t m_nextEvt;
+    unsigned m_segment;
+    bool m_resumed;
+    std::chrono::steady_clock::time_point m_lastTime;
+  };
+
+}
+
+#endif
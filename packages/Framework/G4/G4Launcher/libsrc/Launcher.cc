@@ -13,15 +13,19 @@
 #include "G4Interfaces/StepFilterBase.hh"
 #include "G4Interfaces/PhysListProviderBase.hh"
 #include "G4DataCollect/G4DataCollect.hh"
+#include "EvtFile/Codec.hh"
 #include "G4Random/RandomManager.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/MPMergeService.hh"
 #include "G4NCrystalRel/G4NCInstall.hh"
 #include "G4NCrystalRel/G4NCManager.hh"
 #include "Core/FPE.hh"
 #include "Units/Units.hh"
 #include "MultiProcessingMgr.hh"
+#include "CheckpointMgr.hh"
 #include "G4Utils/Flush.hh"
 #include "G4RunManager.hh"
+#include "G4Run.hh"
 #include "G4UImanager.hh"
 #include "G4ParticleGun.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
@@ -38,7 +42,17 @@
 #endif
 #include <limits>
 #include <stdexcept>
+#include <functional>
 #include "launcher_impl_ts.hh"
+#ifdef G4MULTITHREADED
+#  include "G4MTRunManager.hh"
+#  include "G4Threading.hh"
+#  include "G4VUserActionInitialization.hh"
+#  include "G4UserWorkerInitialization.hh"
+#  include "G4UserWorkerThreadInitialization.hh"
+#  include "G4UserRunAction.hh"
+#  include "Randomize.hh"
+#endif
 
 
 struct G4Launcher::Launcher::Imp {
@@ -56,6 +70,8 @@ struct G4Launcher::Launcher::Imp {
       m_filter(0),
       m_killfilter(0),
       m_outputmode("FULL"),
+      m_outputcompression("zlib"),
+      m_outputstepencoding("STANDARD"),
       m_isinit_pre(false),
       m_isinit_vis_pre(false),
       m_isinit_rm(false),
@@ -63,6 +79,12 @@ struct G4Launcher::Launcher::Imp {
       m_norandom(false),
       m_seed(0),
       m_nprocs(0),
+      m_nthreads(0),
+      m_ckpt_nevts(0),
+      m_ckpt_minutes(0.0),
+      m_resume(false),
+      m_indexedseeds(false),
+      m_firstevt(0),
       m_allowMultipleSettings(false),
       m_physicsListProvider(0),
       m_dofpe(true),
@@ -74,8 +96,16 @@ struct G4Launcher::Launcher::Imp {
   ~Imp(){ closeGriff(); delete m_physicsListProvider; delete m_vis; delete m_rm; }
   void ensureCreateRM() {
     if (!m_rm) {
+#ifdef G4MULTITHREADED
+      if (m_nthreads) {
+        G4MTRunManager * mtrm = new G4MTRunManager;
+        mtrm->SetNumberOfThreads(m_nthreads);
+        m_rm = mtrm;
+      }
+#endif
       //this->print("Creating G4RunManager");
-      m_rm = new G4RunManager;
+      if (!m_rm)
+        m_rm = new G4RunManager;
       m_rm->SetVerboseLevel(0);
     }
   }
@@ -90,6 +120,10 @@ struct G4Launcher::Launcher::Imp {
   //griff output:
   std::string m_output;
   std::string m_outputmode;
+  std::string m_outputcompression;
+  std::string m_outputveto;
+  std::string m_outputfullstepvols;
+  std::string m_outputstepencoding;
   //Visualisation:
   std::string m_visengine;
 
@@ -109,6 +143,7 @@ struct G4Launcher::Launcher::Imp {
   std::vector<HookFctPtr> m_postinithooks;
   std::vector<HookFctPtr> m_postsimhooks;
   std::vector<HookFctPtr> m_postmphooks;
+  std::vector<HookFctPtr> m_workerinithooks;
   bool m_postmphooks_alreadyfired;
   std::vector<std::shared_ptr<G4Interfaces::PostGenCallBack>> m_postgenhooks;
   std::vector<std::shared_ptr<G4Interfaces::PreGenCallBack>> m_pregenhooks;
@@ -120,10 +155,27 @@ struct G4Launcher::Launcher::Imp {
   bool m_norandom;
   std::uint64_t m_seed;
   std::string m_rnd_evtmsg_mode;
+  std::string m_rnd_engine_mode;
 
   //mp:
   unsigned m_nprocs;
 
+  //mt (generator and filter instances for each worker thread):
+  unsigned m_nthreads;
+  std::vector<std::unique_ptr<G4Interfaces::ParticleGenBase>> m_workergens;
+  std::vector<std::unique_ptr<G4Interfaces::StepFilterBase>> m_workerfilters;
+  std::vector<std::unique_ptr<G4Interfaces::StepFilterBase>> m_workerkillfilters;
+
+  //checkpointing:
+  unsigned m_ckpt_nevts;
+  double m_ckpt_minutes;
+  bool m_resume;
+  std::shared_ptr<CheckpointMgr> m_ckptmgr;
+
+  //indexed seeding:
+  bool m_indexedseeds;
+  std::uint64_t m_firstevt;
+
   bool m_allowMultipleSettings;
   std::string m_physicsListName;
   G4Interfaces::PhysListProviderBase * m_physicsListProvider;
@@ -138,7 +190,18 @@ struct G4Launcher::Launcher::Imp {
   bool m_dofpe;
   bool m_closedGriff;
 
-  void closeGriff() { if (m_output!="none" && !m_closedGriff ) { G4DataCollect::finish(); m_closedGriff=true; } }
+  void closeGriff()
+  {
+    if (m_output=="none" || m_closedGriff)
+      return;
+#ifdef G4MULTITHREADED
+    //Worker threads write the output, and close it when they stop:
+    if (G4MTRunManager * mtrm = m_nthreads ? dynamic_cast<G4MTRunManager*>(m_rm) : nullptr)
+      mtrm->TerminateWorkers();
+#endif
+    G4DataCollect::finish();
+    m_closedGriff=true;
+  }
 
   const char * prefix() { return FrameworkGlobals::printPrefix(); }
 
@@ -159,11 +222,179 @@ struct G4Launcher::Launcher::Imp {
     std::cout.flush();
   }
 
+  RandomManager::EVTMSGLEVEL rndEvtMsgLevel() const
+  {
+    if (m_rnd_evtmsg_mode=="ALWAYS")
+      return RandomManager::EVTMSG_ALWAYS;
+    if (m_rnd_evtmsg_mode=="NEVER")
+      return RandomManager::EVTMSG_NEVER;
+    assert(m_rnd_evtmsg_mode.empty()||m_rnd_evtmsg_mode=="ADAPTABLE");
+    return RandomManager::EVTMSG_ADAPTABLE;
+  }
+
+  RandomManager::ENGINEMODE rndEngineMode() const
+  {
+    if (m_rnd_engine_mode=="BATCHED")
+      return RandomManager::ENGINE_BATCHED;
+    assert(m_rnd_engine_mode.empty()||m_rnd_engine_mode=="STRICT");
+    return RandomManager::ENGINE_STRICT;
+  }
+
   void preinit();
   void preinit_vis(Launcher *);
-  void finalMetadata();//just before launch, to catch the last user cmds
+  void installGriffHooks();
+  void preinitCheckpoint();
+  void preinitIndexedSeeding();
+  //just before launch, to catch the last user cmds (in multi-threaded mode,
+  //this happens in the worker threads with their own filter instances):
+  void finalMetadata();
+  void finalMetadata(G4Interfaces::StepFilterBase* filter, G4Interfaces::StepFilterBase* killfilter);
+#ifdef G4MULTITHREADED
+  void preinitMT();
+  void buildWorker();//called in each worker thread
+  void beginWorkerRun(unsigned i);//called in worker thread i at the start of its first run
+#endif
 };
 
+#ifdef G4MULTITHREADED
+namespace {
+  class G4Launcher_MTActionInitialization : public G4VUserActionInitialization {
+  public:
+    G4Launcher_MTActionInitialization(std::function<void()> build) : m_build(std::move(build)) {}
+    virtual ~G4Launcher_MTActionInitialization(){}
+    void Build() const override { m_build(); }
+  private:
+    std::function<void()> m_build;
+  };
+
+  class G4Launcher_MTWorkerInitialization : public G4UserWorkerInitialization {
+  public:
+    G4Launcher_MTWorkerInitialization(bool ncrystal) : m_ncrystal(ncrystal) {}
+    virtual ~G4Launcher_MTWorkerInitialization(){}
+    //Processes are per-thread, so NCrystal must be installed in each worker:
+    void WorkerRunStart() const override { if (m_ncrystal) G4NCrystalRel::installOnDemand(); }
+    //GRIFF output of a worker spans all its runs, and is closed when the
+    //worker thread stops (at the latest when the run manager is deleted):
+    void WorkerStop() const override { G4DataCollect::finish(); }
+  private:
+    bool m_ncrystal;
+  };
+
+  class G4Launcher_MTWorkerThreadInitialization : public G4UserWorkerThreadInitialization {
+  public:
+    //Geant4 does not know how to clone the engine installed by the
+    //RandomManager on the master, so just create a default engine here. It is
+    //replaced when the RandomManager is initialised in the worker:
+    void SetupRNGEngine(const CLHEP::HepRandomEngine*) const override { G4Random::getTheEngine(); }
+  };
+
+  //Completes the setup of a worker at the start of its first run (workers are
+  //built when the run manager is initialised, before the parameters of the
+  //generator and filters are final):
+  class G4Launcher_MTWorkerRunAction : public G4UserRunAction {
+  public:
+    G4Launcher_MTWorkerRunAction(std::function<void()> firstrun) : m_firstrun(std::move(firstrun)) {}
+    virtual ~G4Launcher_MTWorkerRunAction(){}
+    void BeginOfRunAction(const G4Run*) override
+    {
+      if (m_firstrun) {
+        m_firstrun();
+        m_firstrun = nullptr;
+      }
+    }
+  private:
+    std::function<void()> m_firstrun;
+  };
+}
+
+void G4Launcher::Launcher::Imp::preinitMT()
+{
+  //Called after the run manager and physics list were set up:
+  printf("%sMulti-threading requested with %i worker threads\n",prefix(),m_nthreads);
+  if (!m_visengine.empty())
+    error("Multi-threading (setThreads) can not be combined with visualisation");
+  if (!m_gen)
+    error("A particle generator must be registered with setGen(..) for multi-threading to work");
+  G4MTRunManager * mtrm = dynamic_cast<G4MTRunManager*>(m_rm);
+  if (!mtrm)
+    error("Multi-threading (setThreads) requires the launcher to create the run manager");
+
+  //Each worker thread gets its own copy of the generator and filters (G4 might
+  //override the number of threads, e.g. via G4FORCENUMBEROFTHREADS):
+  unsigned nworkers = mtrm->GetNumberOfThreads();
+  for (unsigned i = 0; i < nworkers; ++i) {
+    m_workergens.emplace_back(m_gen->createWorkerInstance());
+    if (!m_workergens.back()) {
+      printf("%sParticle generator %s does not support multi-threaded mode\n",prefix(),m_gen->getName());
+      error("Particle generator does not support multi-threaded mode (it must implement createNew())");
+    }
+    if (m_output=="none")
+      continue;
+    if (m_filter) {
+      m_workerfilters.emplace_back(m_filter->createWorkerInstance());
+      if (!m_workerfilters.back())
+        error("Step filter does not support multi-threaded mode (it must implement createNew())");
+    }
+    if (m_killfilter) {
+      m_workerkillfilters.emplace_back(m_killfilter->createWorkerInstance());
+      if (!m_workerkillfilters.back())
+        error("Step kill-filter does not support multi-threaded mode (it must implement createNew())");
+    }
+  }
+
+  //Worker threads take events in blocks of the event modulo, so let those
+  //hold whole batches of generators producing events in batches:
+  if (m_gen->eventBatchSize()>1)
+    mtrm->SetEventModulo(m_gen->eventBatchSize());
+
+  //The NCrystal manager must exist before the worker threads might need it:
+  G4NCrystalRel::Manager::getInstance();
+
+  if (!m_norandom)
+    m_rm->SetUserInitialization(new G4Launcher_MTWorkerThreadInitialization);
+  m_rm->SetUserInitialization(new G4Launcher_MTWorkerInitialization(m_physicsListName!="ESS_Empty"));
+  m_rm->SetUserInitialization(new G4Launcher_MTActionInitialization([this](){ buildWorker(); }));
+}
+
+void G4Launcher::Launcher::Imp::buildWorker()
+{
+  unsigned i = G4Threading::G4GetThreadId();
+  if (i>=m_workergens.size())
+    error("Unexpected worker thread ID");
+  G4Interfaces::ParticleGenBase * gen = m_workergens.at(i).get();
+  G4RunManager * rm = G4RunManager::GetRunManager();
+  if (!m_norandom) {
+    RandomManager::init(m_seed, rndEvtMsgLevel(), rndEngineMode());
+    RandomManager::attach(gen);
+  }
+  rm->SetUserAction(gen->getAction());
+  if (m_output!="none"&&!m_closedGriff)
+    installGriffHooks();
+  rm->SetUserAction(new G4Launcher_MTWorkerRunAction([this,i](){ beginWorkerRun(i); }));
+  for ( auto& e : m_workerinithooks )
+    (*e)();
+}
+
+void G4Launcher::Launcher::Imp::beginWorkerRun(unsigned i)
+{
+  //The master locked the generator and filters when the simulation started,
+  //so their parameters are final and can now be copied to the instances of
+  //the worker (unless these are already in use since an earlier run):
+  G4Interfaces::ParticleGenBase * gen = m_workergens.at(i).get();
+  if (!gen->isLocked())
+    gen->setParametersFrom(*m_gen);
+  if (m_output=="none"||m_closedGriff)
+    return;
+  G4Interfaces::StepFilterBase * filter = m_filter ? m_workerfilters.at(i).get() : nullptr;
+  G4Interfaces::StepFilterBase * killfilter = m_killfilter ? m_workerkillfilters.at(i).get() : nullptr;
+  if (filter&&!filter->isLocked())
+    filter->setParametersFrom(*m_filter);
+  if (killfilter&&!killfilter->isLocked())
+    killfilter->setParametersFrom(*m_killfilter);
+  finalMetadata(filter,killfilter);
+}
+#endif
+
 //G4Launcher::Launcher * G4Launcher::Launcher::Imp::s_theLauncher = nullptr;
 
 G4Launcher::Launcher * G4Launcher::Launcher::getTheLauncher()
@@ -194,6 +425,7 @@ void G4Launcher::Launcher::shutdown()
 {
   if (!m_imp)
     return;
+  G4Interfaces::MPMergeService::clearMergers();
   delete m_imp;
   m_imp = 0;
 }
@@ -216,6 +448,56 @@ void G4Launcher::Launcher::setMultiProcessing(unsigned nprocs)
   m_imp->m_nprocs = nprocs;
 }
 
+void G4Launcher::Launcher::setThreads(unsigned nthreads)
+{
+  if (m_imp->m_isinit_pre||m_imp->m_rm)
+    m_imp->error("setThreads called too late (it must be called before getRunManager() or any initialisation)");
+  if (m_imp->m_nthreads!=0&&!m_imp->m_allowMultipleSettings)
+    m_imp->error("attempt to call setThreads twice");
+  if (!nthreads&&!m_imp->m_allowMultipleSettings)
+    m_imp->error("argument to setThreads should be non-zero");
+#ifndef G4MULTITHREADED
+  if (nthreads)
+    m_imp->error("setThreads requires Geant4 to be built with multi-threading support");
+#endif
+  m_imp->m_nthreads = nthreads;
+}
+
+void G4Launcher::Launcher::setCheckpoint(unsigned nevents, double minutes)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setCheckpoint called too late");
+  if (minutes<0.0)
+    m_imp->error("argument minutes to setCheckpoint should not be negative");
+  m_imp->m_ckpt_nevts = nevents;
+  m_imp->m_ckpt_minutes = minutes;
+}
+
+void G4Launcher::Launcher::setResume(bool b)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setResume called too late");
+  m_imp->m_resume = b;
+}
+
+void G4Launcher::Launcher::setIndexedSeeding(bool b)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setIndexedSeeding called too late");
+  m_imp->m_indexedseeds = b;
+}
+
+void G4Launcher::Launcher::setFirstEvent(std::uint64_t idx)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setFirstEvent called too late");
+  if (idx>(std::uint64_t)std::numeric_limits<G4int>::max())
+    m_imp->error("setFirstEvent called with index which does not fit in a G4 event ID");
+  m_imp->m_firstevt = idx;
+  if (idx)
+    m_imp->m_indexedseeds = true;
+}
+
 void G4Launcher::Launcher::setGeo(G4Interfaces::GeoConstructBase* geo)
 {
   if (m_imp->m_isinit_pre)
@@ -264,7 +546,7 @@ void G4Launcher::Launcher::setKillFilter(G4Interfaces::StepFilterBase*f)
   m_imp->m_killfilter = f;
 }
 
-void G4Launcher::Launcher::setOutput(const char* filename,const char * mode)
+void G4Launcher::Launcher::setOutput(const char* filename,const char * mode,const char * compression)
 {
   if (m_imp->m_isinit_pre)
     m_imp->error("setOutput called too late");
@@ -276,6 +558,41 @@ void G4Launcher::Launcher::setOutput(const char* filename,const char * mode)
   m_imp->m_outputmode=mode;
   if (m_imp->m_outputmode!="FULL"&&m_imp->m_outputmode!="REDUCED"&&m_imp->m_outputmode!="MINIMAL")
     m_imp->error("setOutput called with invalid mode. Must be FULL, REDUCED or MINIMAL");
+  m_imp->m_outputcompression=compression;
+  try {
+    EvtFile::parseCompression(compression);
+  } catch (std::runtime_error&) {
+    m_imp->error("setOutput called with invalid or unavailable compression. Must be none, zlib, zlib-N (N=1..9), lz4, lz4-N (N=1..12),"
+                 " zstd or zstd-N (N=1..19), optionally followed by a chunk size (e.g. zlib/64k)");
+  }
+}
+
+void G4Launcher::Launcher::setOutputVeto(const char* expression)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setOutputVeto called too late");
+  if (!m_imp->m_outputveto.empty()&&!m_imp->m_allowMultipleSettings)
+    m_imp->error("attempt to call setOutputVeto twice");
+  m_imp->m_outputveto = expression;
+}
+
+void G4Launcher::Launcher::setOutputFullStepVolumes(const char* volumeList)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setOutputFullStepVolumes called too late");
+  if (!m_imp->m_outputfullstepvols.empty()&&!m_imp->m_allowMultipleSettings)
+    m_imp->error("attempt to call setOutputFullStepVolumes twice");
+  m_imp->m_outputfullstepvols = volumeList;
+}
+
+void G4Launcher::Launcher::setOutputStepEncoding(const char* encoding)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setOutputStepEncoding called too late");
+  std::string enc(encoding);
+  if (enc!="STANDARD"&&enc!="COMPACT")
+    m_imp->error("setOutputStepEncoding called with invalid encoding. Must be STANDARD or COMPACT");
+  m_imp->m_outputstepencoding = enc;
 }
 
 void G4Launcher::Launcher::closeOutput()
@@ -368,6 +685,9 @@ void G4Launcher::Launcher::Imp::preinit()
   if (m_output.empty())
     m_output = "output.griff";
 
+  if (m_nprocs>1&&m_nthreads)
+    error("Multi-threading (setThreads) can not be combined with multi-processing (setMultiProcessing)");
+
   if (m_nprocs>1) {
     printf("%sMulti-processing requested with %i processes\n",prefix(),m_nprocs);
     if (!m_gen)
@@ -382,6 +702,8 @@ void G4Launcher::Launcher::Imp::preinit()
       error("Calling both noRandomSetup() and setSeed() is consistent");
     if (!m_rnd_evtmsg_mode.empty())
       error("Calling both noRandomSetup() and setRndEvtMsgMode() is consistent");
+    if (!m_rnd_engine_mode.empty())
+      error("Calling both noRandomSetup() and setRndEngineMode() is consistent");
     print("Will not set up random engine");
   } else {
     if (!m_seed) {
@@ -389,15 +711,12 @@ void G4Launcher::Launcher::Imp::preinit()
       printf("%ssetSeed() not called, picking standard seed.\n",prefix());
       std::cout.flush();
     }
-    auto evtmsgmode = RandomManager::EVTMSG_ADAPTABLE;
-    if (m_rnd_evtmsg_mode=="ALWAYS") {
-      evtmsgmode = RandomManager::EVTMSG_ALWAYS;
-    } else if (m_rnd_evtmsg_mode=="NEVER") {
-      evtmsgmode = RandomManager::EVTMSG_NEVER;
-    } else { assert(m_rnd_evtmsg_mode.empty()||m_rnd_evtmsg_mode=="ADAPTABLE"); }
-    RandomManager::init(m_seed, evtmsgmode );
+    RandomManager::init(m_seed, rndEvtMsgLevel(), rndEngineMode() );
   }
 
+  preinitCheckpoint();
+  preinitIndexedSeeding();
+
   ensureCreateRM();
 
   //Physics list
@@ -492,8 +811,10 @@ void G4Launcher::Launcher::Imp::preinit()
     } else {
       print("Setting up particle generation:");
       m_gen->dump((std::string(Imp::prefix())+"  --> ").c_str());
-      RandomManager::attach(m_gen);
-      m_rm->SetUserAction(m_gen->getAction());
+      if (!m_nthreads) {
+        RandomManager::attach(m_gen);
+        m_rm->SetUserAction(m_gen->getAction());
+      }
     }
   }
 
@@ -507,8 +828,9 @@ void G4Launcher::Launcher::Imp::preinit()
     if (m_filter||m_killfilter)
       error("Filter registered but GRIFF file output disabled.");
   } else {
-    printf("%sInstalling hooks for capturing%s output in \"%s\" in mode %s\n",
-           Imp::prefix(),(m_filter||m_killfilter?" filtered":""),m_output.c_str(),m_outputmode.c_str());
+    printf("%sInstalling hooks for capturing%s output in \"%s\" in mode %s (compression: %s)\n",
+           Imp::prefix(),(m_filter||m_killfilter?" filtered":""),m_output.c_str(),m_outputmode.c_str(),
+           m_outputcompression.c_str());
     if (m_killfilter) {
       print("GRIFF output applies a kill-filter:");
       m_killfilter->dump((std::string(Imp::prefix())+"  --> ").c_str());
@@ -517,13 +839,121 @@ void G4Launcher::Launcher::Imp::preinit()
       print("GRIFF output is filtered by:");
       m_filter->dump((std::string(Imp::prefix())+"  --> ").c_str());
     }
+    if (!m_outputveto.empty())
+      printf("%sGRIFF output skips events for which \"%s\" is true\n",Imp::prefix(),m_outputveto.c_str());
+    if (m_outputstepencoding!="STANDARD")
+      printf("%sGRIFF output uses %s step encoding\n",Imp::prefix(),m_outputstepencoding.c_str());
+    if (!m_outputfullstepvols.empty()&&m_outputmode!="FULL")
+      printf("%sGRIFF output keeps full step data in volumes \"%s\"\n",Imp::prefix(),m_outputfullstepvols.c_str());
+    if (m_nthreads)
+      print("GRIFF output is written to a separate file by each worker thread");
     std::cout.flush();
-    G4DataCollect::installHooks(m_output.c_str(),m_outputmode.c_str());
+    if (!m_nthreads)
+      installGriffHooks();
   }
 
+#ifdef G4MULTITHREADED
+  if (m_nthreads)
+    preinitMT();
+#endif
+
   print("Pre-init done");
 }
 
+void G4Launcher::Launcher::Imp::preinitCheckpoint()
+{
+  if (!m_ckpt_nevts&&m_ckpt_minutes<=0.0) {
+    if (m_resume)
+      error("Resuming a job (setResume) requires checkpointing to be enabled (setCheckpoint)");
+    return;
+  }
+  if (m_nprocs>1||m_nthreads)
+    error("Checkpointing (setCheckpoint) can not be combined with multi-processing or multi-threading");
+  if (m_norandom)
+    error("Checkpointing (setCheckpoint) can not be combined with noRandomSetup()");
+  if (m_output=="none")
+    error("Checkpointing (setCheckpoint) requires GRIFF output");
+  if (!m_gen)
+    error("A particle generator must be registered with setGen(..) for checkpointing to work");
+  if (!m_gen->unlimited())
+    error("Checkpointing (setCheckpoint) requires a particle generator with an unlimited number of events");
+  m_ckptmgr = std::make_shared<CheckpointMgr>(m_output,m_ckpt_nevts,m_ckpt_minutes,m_seed,m_gen->getName());
+  if (m_resume)
+    m_ckptmgr->resume();
+  //Before the random manager is attached, so seeds follow the event indices:
+  m_ckptmgr->installOn(m_gen);
+  printf("%sCheckpointing GRIFF output in segment files like %s\n",prefix(),m_ckptmgr->griffFile().c_str());
+}
+
+namespace G4Launcher {
+  namespace {
+    //Gives each event of a single-process job an index, used for seeding. As
+    //the index also becomes the G4 event ID, it must fit in a G4int:
+    class EventIndexer : public G4Interfaces::PreGenCallBack {
+    public:
+      EventIndexer(std::uint64_t firstEvt) : m_nextEvt(firstEvt) {}
+      virtual void preGen()
+      {
+        if (m_nextEvt>(std::uint64_t)std::numeric_limits<G4int>::max()) {
+          printf("%sERROR: Event index %llu does not fit in a G4 event ID\n",
+                 FrameworkGlobals::printPrefix(),(long long unsigned)m_nextEvt);
+          throw std::runtime_error("Event index too large for G4 event ID");
+        }
+        FrameworkGlobals::setCurrentEvtIndex(m_nextEvt++);
+      }
+    private:
+      std::uint64_t m_nextEvt;
+    };
+    class EventIndexerIDs : public G4Interfaces::PostGenCallBack {
+    public:
+      virtual void postGen(G4Event* evt)
+      {
+        assert(FrameworkGlobals::currentEvtIndex()<=(std::uint64_t)std::numeric_limits<G4int>::max());
+        evt->SetEventID((G4int)FrameworkGlobals::currentEvtIndex());
+      }
+    };
+  }
+}
+
+void G4Launcher::Launcher::Imp::preinitIndexedSeeding()
+{
+  if (m_firstevt) {
+    if (m_nprocs>1||m_nthreads||m_ckptmgr)
+      error("Starting at a given event (setFirstEvent) can not be combined with multi-processing, multi-threading or checkpointing");
+    if (!m_gen)
+      error("A particle generator must be registered with setGen(..) to start at a given event (setFirstEvent)");
+    if (!m_gen->unlimited())
+      error("Starting at a given event (setFirstEvent) requires a particle generator with an unlimited number of events");
+  }
+  if (!m_indexedseeds)
+    return;
+  if (m_norandom)
+    error("Indexed seeding (setIndexedSeeding) can not be combined with noRandomSetup()");
+  if (m_nprocs>1||m_nthreads||m_ckptmgr)
+    return;//events are already indexed
+  if (!m_gen)
+    error("A particle generator must be registered with setGen(..) for indexed seeding to work");
+  //Before the random manager is attached, so seeds follow the event indices:
+  m_gen->installPreGenCallBack(std::make_shared<EventIndexer>(m_firstevt));
+  m_gen->installPostGenCallBack(std::make_shared<EventIndexerIDs>());
+  if (m_firstevt)
+    printf("%sSeeding events by their index, starting at event %llu\n",prefix(),(long long unsigned)m_firstevt);
+  else
+    print("Seeding events by their index");
+}
+
+void G4Launcher::Launcher::Imp::installGriffHooks()
+{
+  std::string output = m_ckptmgr ? m_ckptmgr->griffFile() : m_output;
+  G4DataCollect::installHooks(output.c_str(),m_outputmode.c_str(),m_outputcompression.c_str());
+  if (!m_outputveto.empty())
+    G4DataCollect::setEventVeto(m_outputveto);
+  if (!m_outputfullstepvols.empty())
+    G4DataCollect::setFullStepVolumes(m_outputfullstepvols);
+  if (m_outputstepencoding!="STANDARD")
+    G4DataCollect::setStepEncoding(m_outputstepencoding.c_str());
+}
+
 //hack to access protected method StoreHistory:
 struct G4Launcher_Launcher_G4UItcsh : public G4UItcsh {
   void PublicStoreHistory(G4String aCommand) { StoreHistory(aCommand); }
@@ -531,6 +961,8 @@ struct G4Launcher_Launcher_G4UItcsh : public G4UItcsh {
 
 void G4Launcher::Launcher::startSession()
 {
+  if (m_imp->m_nthreads)
+    m_imp->error("Interactive sessions are not supported in multi-threaded mode (setThreads)");
   m_imp->preinit();
   init();
   m_imp->preinit_vis(this);
@@ -600,31 +1032,38 @@ void G4Launcher::Launcher::startSession()
 }
 
 void G4Launcher::Launcher::Imp::finalMetadata()
+{
+  if (m_nthreads)
+    return;//done in the worker threads
+  finalMetadata(m_filter,m_killfilter);
+}
+
+void G4Launcher::Launcher::Imp::finalMetadata(G4Interfaces::StepFilterBase* filter, G4Interfaces::StepFilterBase* killfilter)
 {
   if (m_output=="none")
     return;
-  if (m_filter) {
+  if (filter) {
     //install griff step filter:
-    G4DataCollect::setStepFilter(m_filter);
+    G4DataCollect::setStepFilter(filter);
     //record meta-data
-    G4DataCollect::setMetaData("filterName",m_filter->getName());
+    G4DataCollect::setMetaData("filterName",filter->getName());
     char * dataS;
     unsigned lengthS;
     std::string tmpS;
-    m_filter->serialiseParameters(dataS,lengthS);
+    filter->serialiseParameters(dataS,lengthS);
     tmpS.assign(dataS,lengthS);//careful with null chars
     G4DataCollect::setMetaData("`filterSerialised",tmpS);//The leading '`' hints that this is binary data
     delete[] dataS;
   }
-  if (m_killfilter) {
+  if (killfilter) {
     //install griff step kill-filter:
-    G4DataCollect::setStepKillFilter(m_killfilter);
+    G4DataCollect::setStepKillFilter(killfilter);
     //record meta-data
-    G4DataCollect::setMetaData("killFilterName",m_killfilter->getName());
+    G4DataCollect::setMetaData("killFilterName",killfilter->getName());
     char * dataS;
     unsigned lengthS;
     std::string tmpS;
-    m_killfilter->serialiseParameters(dataS,lengthS);
+    killfilter->serialiseParameters(dataS,lengthS);
     tmpS.assign(dataS,lengthS);//careful with null chars
     G4DataCollect::setMetaData("`killFilterSerialised",tmpS);//The leading '`' hints that this is binary data
     delete[] dataS;
@@ -715,10 +1154,17 @@ void G4Launcher::Launcher::init()
 #endif
   }
 
-  //Install NCrystal if needed:
+  //Install NCrystal if needed (in multi-threaded mode, this happens in the
+  //worker threads as well):
   if (m_imp->m_physicsListName!="ESS_Empty")
     G4NCrystalRel::installOnDemand();
 
+  //Without worker threads, the worker init hooks are simply called here:
+  if (!m_imp->m_nthreads) {
+    for (auto& e : m_imp->m_workerinithooks )
+      (*e)();
+  }
+
   for (auto& e : m_imp->m_postinithooks )
     (*e)();
 
@@ -733,7 +1179,20 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
     init();
   if (!m_imp->m_gen)
     m_imp->error("No particle generation was set up before startSimulation(..) was called.!");
-  assert(m_imp->m_rm->GetUserPrimaryGeneratorAction());
+  assert(m_imp->m_nthreads||m_imp->m_rm->GetUserPrimaryGeneratorAction());
+  if (m_imp->m_nthreads) {
+    if (!m_imp->m_pregenhooks.empty()||!m_imp->m_postgenhooks.empty())
+      m_imp->error("Pre- and post-generation hooks are not supported in multi-threaded mode (setThreads)");
+    //Worker threads copy the parameters of these at the start of their first
+    //run, and read them when writing metadata:
+    m_imp->m_gen->lock();
+    if (m_imp->m_geo)
+      m_imp->m_geo->lock();
+    if (m_imp->m_filter)
+      m_imp->m_filter->lock();
+    if (m_imp->m_killfilter)
+      m_imp->m_killfilter->lock();
+  }
 
   m_imp->finalMetadata();
   if (nevents==0) {
@@ -746,6 +1205,12 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
   } else {
     printf("%sStarting simulation of %i events\n",m_imp->prefix(),nevents);
   }
+  if (m_imp->m_ckptmgr) {
+    //resumed jobs only simulate the remaining events:
+    nevents = (unsigned)m_imp->m_ckptmgr->beginSimulation(nevents);
+    if (!nevents)
+      m_imp->print("All events were already simulated in the checkpointed job");
+  }
   std::cout.flush();
 
   for (auto it = m_imp->m_pregenhooks.begin(); it!=m_imp->m_pregenhooks.end(); ++it)
@@ -755,7 +1220,14 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
     m_imp->m_gen->installPostGenCallBack(*it);
   m_imp->m_postgenhooks.clear();
 
-  m_imp->m_rm->BeamOn(nevents);
+  if (nevents||!m_imp->m_ckptmgr)
+    m_imp->m_rm->BeamOn(nevents);
+  if (m_imp->m_nthreads) {
+    //Events of any later run continue the indices (and event IDs) of this one:
+    const G4Run * run = m_imp->m_rm->GetCurrentRun();
+    if (run)
+      FrameworkGlobals::setNEvtsEarlierRuns(FrameworkGlobals::nEvtsEarlierRuns()+run->GetNumberOfEvent());
+  }
   if (m_imp->m_gen->reachedLimit()) {
     assert(!m_imp->m_gen->unlimited());
     printf("%sNo more events to process.\n",FrameworkGlobals::printPrefix());
@@ -763,12 +1235,21 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
 
   m_imp->print("Simulation done");
 
+  if (m_imp->m_ckptmgr) {
+    //the last segment must be complete before the job is marked as such:
+    m_imp->closeGriff();
+    m_imp->m_ckptmgr->endSimulation();
+  }
+
   for ( auto& e : m_imp->m_postsimhooks )
     (*e)();
 
   if (FrameworkGlobals::isForked()&&FrameworkGlobals::isParent()) {
     G4Launcher::MultiProcessingMgr::checkAnyChildren(true);
     m_imp->print("Simulation done in all processes");
+    //merge per-process output files of registered components (one merge
+    //thread per process, since that is what the user granted the job):
+    G4Interfaces::MPMergeService::runMergers(m_imp->m_nprocs);
     //fire post mp hooks (should be safe even if more are added from inside hooks):
     unsigned i = 0;
     while (i<m_imp->m_postmphooks.size()) {
@@ -952,6 +1433,23 @@ void G4Launcher::Launcher::setRndEvtMsgMode(const char * mode)
     m_imp->error("setRndEvtMsgMode called with invalid mode. Must be ALWAY, NEVER or ADAPTABLE");
 }
 
+const std::string& G4Launcher::Launcher::rndEngineMode() const
+{
+  return m_imp->m_rnd_engine_mode;
+}
+
+void G4Launcher::Launcher::setRndEngineMode(const char * mode)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setRndEngineMode called too late");
+  if (!mode)
+    m_imp->error("setRndEngineMode called with null string");
+  std::string smode(mode);
+  if ( smode!="STRICT" && smode!="BATCHED" )
+    m_imp->error("setRndEngineMode called with invalid mode. Must be STRICT or BATCHED");
+  m_imp->m_rnd_engine_mode = smode;
+}
+
 
 void G4Launcher::Launcher::setSeed(std::uint64_t seed)
 {
@@ -966,10 +1464,18 @@ void G4Launcher::Launcher::setUserSteppingAction(G4UserSteppingAction*ua)
     m_imp->error("setUserSteppingAction must only be called after init()");
   if (!ua)
     m_imp->error("Only call setUserSteppingAction with non-zero argument.");
+  G4RunManager * rm = m_imp->m_rm;
+#ifdef G4MULTITHREADED
+  if (m_imp->m_nthreads) {
+    if (!G4Threading::IsWorkerThread())
+      m_imp->error("setUserSteppingAction must be called from a worker init hook in multi-threaded mode");
+    rm = G4RunManager::GetRunManager();
+  }
+#endif
   if (m_imp->m_output!="none")
     G4DataCollect::installUserSteppingAction(ua);//via Griff
   else
-    m_imp->m_rm->SetUserAction(ua);//directly on the run manager
+    rm->SetUserAction(ua);//directly on the run manager
 }
 
 void G4Launcher::Launcher::setUserEventAction(G4UserEventAction*ua)
@@ -978,10 +1484,18 @@ void G4Launcher::Launcher::setUserEventAction(G4UserEventAction*ua)
     m_imp->error("setUserEventAction must only be called after init()");
   if (!ua)
     m_imp->error("Only call setUserEventAction with non-zero argument.");
+  G4RunManager * rm = m_imp->m_rm;
+#ifdef G4MULTITHREADED
+  if (m_imp->m_nthreads) {
+    if (!G4Threading::IsWorkerThread())
+      m_imp->error("setUserEventAction must be called from a worker init hook in multi-threaded mode");
+    rm = G4RunManager::GetRunManager();
+  }
+#endif
   if (m_imp->m_output!="none")
     G4DataCollect::installUserEventAction(ua);//via Griff
   else
-    m_imp->m_rm->SetUserAction(ua);//directly on the run manager
+    rm->SetUserAction(ua);//directly on the run manager
 }
 
 unsigned G4Launcher::Launcher::getMultiProcessing() const
@@ -989,6 +1503,36 @@ unsigned G4Launcher::Launcher::getMultiProcessing() const
   return m_imp->m_nprocs;
 }
 
+unsigned G4Launcher::Launcher::getThreads() const
+{
+  return m_imp->m_nthreads;
+}
+
+unsigned G4Launcher::Launcher::getCheckpointEvents() const
+{
+  return m_imp->m_ckpt_nevts;
+}
+
+double G4Launcher::Launcher::getCheckpointMinutes() const
+{
+  return m_imp->m_ckpt_minutes;
+}
+
+bool G4Launcher::Launcher::getResume() const
+{
+  return m_imp->m_resume;
+}
+
+bool G4Launcher::Launcher::getIndexedSeeding() const
+{
+  return m_imp->m_indexedseeds;
+}
+
+std::uint64_t G4Launcher::Launcher::getFirstEvent() const
+{
+  return m_imp->m_firstevt;
+}
+
 bool G4Launcher::Launcher::GetNoRandomSetup() const
 {
   return m_imp->m_norandom;
@@ -1009,6 +1553,26 @@ const char* G4Launcher::Launcher::getOutputMode() const
   return m_imp->m_outputmode.c_str();
 }
 
+const char* G4Launcher::Launcher::getOutputCompression() const
+{
+  return m_imp->m_outputcompression.c_str();
+}
+
+const char* G4Launcher::Launcher::getOutputVeto() const
+{
+  return m_imp->m_outputveto.c_str();
+}
+
+const char* G4Launcher::Launcher::getOutputFullStepVolumes() const
+{
+  return m_imp->m_outputfullstepvols.c_str();
+}
+
+const char* G4Launcher::Launcher::getOutputStepEncoding() const
+{
+  return m_imp->m_outputstepencoding.c_str();
+}
+
 const char* G4Launcher::Launcher::getVis() const
 {
   return m_imp->m_visengine.c_str();
@@ -1070,6 +1634,7 @@ void G4Launcher::Launcher::addPrePreInitHook(HookFctPtr hf) { m_imp->m_prepreini
 void G4Launcher::Launcher::addPreInitHook(HookFctPtr hf) { m_imp->m_preinithooks.push_back(std::move(hf)); }
 void G4Launcher::Launcher::addPostInitHook(HookFctPtr hf) { m_imp->m_postinithooks.push_back(std::move(hf)); }
 void G4Launcher::Launcher::addPostSimHook(HookFctPtr hf) { m_imp->m_postsimhooks.push_back(std::move(hf)); }
+void G4Launcher::Launcher::addWorkerInitHook(HookFctPtr hf) { m_imp->m_workerinithooks.push_back(std::move(hf)); }
 void G4Launcher::Launcher::addPreGenHook(std::shared_ptr<G4Interfaces::PreGenCallBack> hf) { m_imp->m_pregenhooks.push_back(std::move(hf)); }
 void G4Launcher::Launcher::addPostGenHook(std::shared_ptr<G4Interfaces::PostGenCallBack> hf) { m_imp->m_postgenhooks.push_back(std::move(hf)); }
 
@@ -10,17 +10,27 @@
 #include <signal.h>
 #include <stdexcept>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <new>
 
 void G4Launcher::MultiProcessingMgr::scheduleMP(G4Interfaces::ParticleGenBase*gen,unsigned nprocs)
 {
   assert(gen);
+  FrameworkGlobals::setForkScheduled();
   //Not using std::make_shared due to private constructor.
-  gen->installPreGenCallBack( std::shared_ptr<MultiProcessingMgr>(new MultiProcessingMgr(nprocs)) );
+  gen->installPreGenCallBack( std::shared_ptr<MultiProcessingMgr>(new MultiProcessingMgr(nprocs,gen->unlimited(),gen->eventBatchSize())) );
 }
 
-G4Launcher::MultiProcessingMgr::MultiProcessingMgr(unsigned nprocs)
+G4Launcher::MultiProcessingMgr::MultiProcessingMgr(unsigned nprocs, bool dynamic, unsigned batchSize)
   : m_nprocs(nprocs),
-    m_nevts_until_abort(0),
+    m_dynamic(dynamic),
+    m_batchSize(std::max(1u,batchSize)),
+    m_nevts(0),
+    m_chunkSize(0),
+    m_nextEvtIdx(0),
+    m_chunkEnd(0),
+    m_sharedNextChunk(0),
     m_first(true),
     m_parentPID(0),
     m_checklasttime(0),
@@ -30,6 +40,8 @@ G4Launcher::MultiProcessingMgr::MultiProcessingMgr(unsigned nprocs)
 
 G4Launcher::MultiProcessingMgr::~MultiProcessingMgr()
 {
+  if (m_sharedNextChunk)
+    munmap(m_sharedNextChunk,sizeof(*m_sharedNextChunk));
 }
 
 std::vector<pid_t> G4Launcher::MultiProcessingMgr::s_childPIDs;
@@ -44,7 +56,34 @@ void G4Launcher::MultiProcessingMgr::doFork()
     printf("%sWARNING Limiting number of processes to number of events.\n",FrameworkGlobals::printPrefix());
     m_nprocs=nevts;
   }
+  m_nevts = nevts;
+
+  //Unless the generator splits its own input, processes pull chunks of events
+  //from a shared counter, so they all keep working until the very end. Chunks
+  //are small enough to balance the load, but large enough that the counter is
+  //rarely touched. Initially each process gets one chunk (so each process has
+  //something to do, even if a sibling is slow to start up). Chunks hold whole
+  //batches of generators producing events in batches, since a process would
+  //otherwise generate the entire batch of each event it gets:
+  if (m_dynamic&&m_nprocs>1) {
+    m_chunkSize = std::max<std::uint64_t>(1,std::min<std::uint64_t>(1000,m_nevts/(64*m_nprocs)));
+    m_chunkSize = ((m_chunkSize+m_batchSize-1)/m_batchSize)*m_batchSize;
+    std::uint64_t nchunks = (m_nevts+m_chunkSize-1)/m_chunkSize;
+    if (nchunks<m_nprocs) {
+      printf("%sWARNING Limiting number of processes to number of event batches.\n",FrameworkGlobals::printPrefix());
+      m_nprocs = nchunks;
+    }
+  }
   printf("%sForking into %i processes.\n",FrameworkGlobals::printPrefix(),m_nprocs);
+  if (m_dynamic&&m_nprocs>1) {
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,"shared counter must be lock free");
+    void * shm = mmap(0,sizeof(std::atomic<std::uint64_t>),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+    if (shm==MAP_FAILED)
+      throw std::runtime_error("Could not allocate shared memory for distribution of events between processes");
+    m_sharedNextChunk = new(shm) std::atomic<std::uint64_t>(m_chunkSize*m_nprocs);
+    printf("%sDistributing events dynamically between processes in chunks of %llu events.\n",
+           FrameworkGlobals::printPrefix(),(long long unsigned)m_chunkSize);
+  }
 
   //Must spawn m_nprocs-1 child processes and register the results in
   //G4Interfaces::FrameworkGlobals. The tweaking of per-process stuff like seeds
@@ -96,10 +135,32 @@ void G4Launcher::MultiProcessingMgr::doFork()
 
   //Difficult to change number of events at this point, but we can make sure we
   //trigger soft aborts when it is time:
-  if (m_nprocs!=1)
-    m_nevts_until_abort = nevts/m_nprocs + (id_this_process<nevts%m_nprocs?1:0);
-  else
-    m_nevts_until_abort = std::numeric_limits<G4int>::max();
+  if (m_nprocs==1) {
+    m_nextEvtIdx = 0;
+    m_chunkEnd = std::numeric_limits<std::uint64_t>::max();
+  } else if (m_sharedNextChunk) {
+    m_nextEvtIdx = m_chunkSize*id_this_process;
+    m_chunkEnd = std::min(m_nextEvtIdx + m_chunkSize,m_nevts);
+  } else {
+    //static split with equal numbers of events in each process:
+    std::uint64_t n = m_nevts/m_nprocs;
+    std::uint64_t nextra = m_nevts%m_nprocs;
+    m_nextEvtIdx = n*id_this_process + std::min<std::uint64_t>(id_this_process,nextra);
+    m_chunkEnd = m_nextEvtIdx + n + (id_this_process<nextra?1:0);
+  }
+}
+
+void G4Launcher::MultiProcessingMgr::nextChunk()
+{
+  //Claim a new chunk of events, or end the run after the current event if all
+  //events are taken:
+  std::uint64_t start = m_sharedNextChunk ? m_sharedNextChunk->fetch_add(m_chunkSize) : m_nevts;
+  if (start<m_nevts) {
+    m_nextEvtIdx = start;
+    m_chunkEnd = std::min(start+m_chunkSize,m_nevts);
+  } else {
+    G4RunManager::GetRunManager()->AbortRun(true);
+  }
 }
 
 void G4Launcher::MultiProcessingMgr::preGen()
@@ -120,8 +181,10 @@ void G4Launcher::MultiProcessingMgr::preGen()
         checkAnyChildren();
     }
   }
-  if ( m_nevts_until_abort-- == 1 )
-    G4RunManager::GetRunManager()->AbortRun(true);
+  assert(m_nextEvtIdx<m_chunkEnd);
+  FrameworkGlobals::setCurrentEvtIndex(m_nextEvtIdx);
+  if ( ++m_nextEvtIdx == m_chunkEnd )
+    nextChunk();
 }
 
 void G4Launcher::MultiProcessingMgr::killAllChildren()
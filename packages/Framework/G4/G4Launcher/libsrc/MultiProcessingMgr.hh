@@ -5,6 +5,7 @@
 #include <sys/types.h>//pid_t
 #include "G4Types.hh"
 #include <memory>
+#include <atomic>
 
 //If your generator is mygen, then you schedule a fork into N processes by
 //performing a call like the following during initialisation:
@@ -13,6 +14,14 @@
 //
 //The actual fork() will happen after initialisation, thus ensuring a very
 //efficient memory sharing.
+//
+//Each process starts with its own chunk of events, after which the processes
+//pull further chunks from a counter in shared memory until all events are
+//done. Thus fast processes simply end up doing more events than slow ones.
+//Generators with a limited number of events (e.g. from input files) split
+//their inputs themselves, so for those the events are instead divided equally
+//between the processes. Either way each event gets a global index, available
+//through FrameworkGlobals::currentEvtIndex(), which is used for seeding.
 
 namespace G4Launcher {
 
@@ -29,12 +38,19 @@ namespace G4Launcher {
 
   private:
     virtual void preGen();
-    MultiProcessingMgr(unsigned nprocs);
+    MultiProcessingMgr(unsigned nprocs, bool dynamic, unsigned batchSize);
     static void killAllChildren();
     void checkParent();
     void doFork();
+    void nextChunk();
     unsigned m_nprocs;
-    G4int m_nevts_until_abort;
+    bool m_dynamic;
+    unsigned m_batchSize;
+    std::uint64_t m_nevts;
+    std::uint64_t m_chunkSize;
+    std::uint64_t m_nextEvtIdx;
+    std::uint64_t m_chunkEnd;
+    std::atomic<std::uint64_t> * m_sharedNextChunk;//in memory shared between processes
     bool m_first;
     pid_t m_parentPID;
     static std::vector<pid_t> s_childPIDs;
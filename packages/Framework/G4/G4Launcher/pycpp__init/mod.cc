@@ -30,6 +30,11 @@ namespace G4Launcher_py {
     return l.rndEvtMsgMode();
   }
 
+  std::string Launcher_rndEngineMode(G4Launcher::Launcher& l)
+  {
+    return l.rndEngineMode();
+  }
+
   G4ThreeVector pytuple2g4vect(const py::tuple&t)
   {
     if ( py::len(t) != 3 )
@@ -138,6 +143,7 @@ namespace G4Launcher_py {
   }
 
   void Launcher_setOutput_1arg(G4Launcher::Launcher& l,const char* filename) { l.setOutput(filename); }
+  void Launcher_setOutput_2args(G4Launcher::Launcher& l,const char* filename,const char* mode) { l.setOutput(filename,mode); }
   void Launcher_setVis_0args(G4Launcher::Launcher& l) { l.setVis(); }
   void Launcher_startSession_0args(G4Launcher::Launcher& l) { l.startSession(); }
 
@@ -199,6 +205,11 @@ PYTHON_MODULE( mod )
     .def("setFilter",&G4Launcher_py::Launcher_setFilter)
     .def("setKillFilter",&G4Launcher_py::Launcher_setKillFilter)
     .def("setMultiProcessing",&G4Launcher::Launcher::setMultiProcessing)
+    .def("setThreads",&G4Launcher::Launcher::setThreads)
+    .def("setCheckpoint",&G4Launcher::Launcher::setCheckpoint,py::arg("nevents"),py::arg("minutes")=0.0)
+    .def("setResume",&G4Launcher::Launcher::setResume,py::arg("b")=true)
+    .def("setIndexedSeeding",&G4Launcher::Launcher::setIndexedSeeding,py::arg("b")=true)
+    .def("setFirstEvent",&G4Launcher::Launcher::setFirstEvent)
     .def("getRunManager",&G4Launcher::Launcher::getRunManager,py::return_value_policy::reference)
     .def("setVis",&G4Launcher::Launcher::setVis)
     .def("setVis",&G4Launcher_py::Launcher_setVis_0args)
@@ -207,14 +218,20 @@ PYTHON_MODULE( mod )
     .def("startSimulation",&G4Launcher::Launcher::startSimulation)
     .def("setRndEvtMsgMode",&G4Launcher::Launcher::setRndEvtMsgMode)
     .def("rndEvtMsgMode",&G4Launcher_py::Launcher_rndEvtMsgMode)
+    .def("setRndEngineMode",&G4Launcher::Launcher::setRndEngineMode)
+    .def("rndEngineMode",&G4Launcher_py::Launcher_rndEngineMode)
     .def("setPhysicsList",&G4Launcher::Launcher::setPhysicsList)
     .def("setPhysicsListProvider",&G4Launcher::Launcher::setPhysicsListProvider)
     .def("hasPhysicsListProvider",&G4Launcher::Launcher::hasPhysicsListProvider)
     .def("setParticleGun",&G4Launcher_py::Launcher_setParticleGun1)
     .def("setParticleGun",&G4Launcher_py::Launcher_setParticleGun2)
     .def("setOutput",&G4Launcher::Launcher::setOutput)
+    .def("setOutput",&G4Launcher_py::Launcher_setOutput_2args)
     .def("setOutput",&G4Launcher_py::Launcher_setOutput_1arg)
     .def("closeOutput",&G4Launcher::Launcher::closeOutput)
+    .def("setOutputVeto",&G4Launcher::Launcher::setOutputVeto)
+    .def("setOutputFullStepVolumes",&G4Launcher::Launcher::setOutputFullStepVolumes)
+    .def("setOutputStepEncoding",&G4Launcher::Launcher::setOutputStepEncoding)
     .def("noRandomSetup",&G4Launcher::Launcher::noRandomSetup)
     .def("setSeed",&G4Launcher::Launcher::setSeed)
     .def("setUserSteppingAction",&G4Launcher::Launcher::setUserSteppingAction)
@@ -225,10 +242,20 @@ PYTHON_MODULE( mod )
     .def("init",&G4Launcher::Launcher::init)
     .def("initVis",&G4Launcher::Launcher::initVis)
     .def("getMultiProcessing",&G4Launcher::Launcher::getMultiProcessing)
+    .def("getThreads",&G4Launcher::Launcher::getThreads)
+    .def("getCheckpointEvents",&G4Launcher::Launcher::getCheckpointEvents)
+    .def("getCheckpointMinutes",&G4Launcher::Launcher::getCheckpointMinutes)
+    .def("getResume",&G4Launcher::Launcher::getResume)
+    .def("getIndexedSeeding",&G4Launcher::Launcher::getIndexedSeeding)
+    .def("getFirstEvent",&G4Launcher::Launcher::getFirstEvent)
     .def("GetNoRandomSetup",&G4Launcher::Launcher::GetNoRandomSetup)
     .def("getSeed",&G4Launcher::Launcher::getSeed)
     .def("getOutputFile",&G4Launcher::Launcher::getOutputFile)
     .def("getOutputMode",&G4Launcher::Launcher::getOutputMode)
+    .def("getOutputCompression",&G4Launcher::Launcher::getOutputCompression)
+    .def("getOutputVeto",&G4Launcher::Launcher::getOutputVeto)
+    .def("getOutputFullStepVolumes",&G4Launcher::Launcher::getOutputFullStepVolumes)
+    .def("getOutputStepEncoding",&G4Launcher::Launcher::getOutputStepEncoding)
     .def("getVis",&G4Launcher::Launcher::getVis)
     .def("getGeo",&G4Launcher::Launcher::getGeo,py::return_value_policy::reference)
     .def("getGen",&G4Launcher::Launcher::getGen,py::return_value_policy::reference)
@@ -264,6 +264,9 @@ def _swallowCmdLineAndLaunch(self):
     #default values:
     default_mp = self.getMultiProcessing()
     if default_mp<2: default_mp=1
+    default_threads = self.getThreads()
+    default_checkpoint = self.getCheckpointEvents()
+    default_checkpoint_minutes = self.getCheckpointMinutes()
     default_visengine = self.getVis()
     if default_visengine:
         default_dovis=True
@@ -272,6 +275,10 @@ def _swallowCmdLineAndLaunch(self):
         default_visengine='OGLSXm'
     default_mode=self.getOutputMode()
     default_outfile=self.getOutputFile()
+    default_compression=self.getOutputCompression()
+    default_veto=self.getOutputVeto()
+    default_fullstepvols=self.getOutputFullStepVolumes()
+    default_stepencoding=self.getOutputStepEncoding()
     if not default_mode: default_outfile='FULL'
     if not default_outfile: default_outfile='simresults'
 
@@ -347,6 +354,18 @@ def _swallowCmdLineAndLaunch(self):
                         help="Simulate N events",metavar="N")
     parser.add_argument("-j", "--jobs",type=int, dest="njobs", default=default_mp,
                         help="Launch N processes [default %i]"%default_mp,metavar="N")
+    parser.add_argument("--threads",type=int, dest="nthreads", default=default_threads,
+                        help="Simulate with N Geant4 worker threads in a single process, writing one output file per thread (not with --jobs)",metavar="N")
+    parser.add_argument("--checkpoint",type=int, dest="checkpoint", default=default_checkpoint,
+                        help="Checkpoint every N events, writing GRIFF output in segment files and progress in a manifest (not with --jobs or --threads)",metavar="N")
+    parser.add_argument("--checkpoint-minutes",type=float, dest="checkpoint_minutes", default=default_checkpoint_minutes,
+                        help="Checkpoint every T minutes (like --checkpoint)",metavar="T")
+    parser.add_argument("--resume", action='store_true',default=self.getResume(),dest="resume",
+                        help="Resume killed job from the manifest of its last checkpoint (other options must be the same as for the original job)")
+    parser.add_argument("--indexedseeds", action='store_true',default=self.getIndexedSeeding(),dest="indexedseeds",
+                        help="Derive the seed of each event from its index in the job, so results do not depend on how the job is split up")
+    parser.add_argument("--firstevent",type=int, dest="firstevent", default=self.getFirstEvent(),
+                        help="Start at event with index K (implies --indexedseeds). Use with -n1 to rerun a single event",metavar="K")
 
     parser.add_argument("-t", "--test", action='store_true',default=False,dest="test",
                         help='Test geometry consistency and exit')
@@ -359,6 +378,8 @@ def _swallowCmdLineAndLaunch(self):
     if not norandom:
         parser.add_argument("-s", "--seed",type=int, dest="seed", default=default_seed,
                             help="Use S as seed for generation of random numbers [default %i]"%default_seed,metavar='S')
+        parser.add_argument("--rndengine",type=str, dest="rndengine", default=None, choices=['STRICT','BATCHED'],
+                            help="Random engine mode. BATCHED is faster, but gives other events than the default STRICT",metavar='MODE')
     if default_dovis:
         parser.add_argument("-n", "--novisualise",action='store_false',default=True,dest="vis",
                             help='Do *not* drop to G4 interactive prompt and launch viewer')
@@ -375,6 +396,14 @@ def _swallowCmdLineAndLaunch(self):
                         help="Filename for GRIFF output [default %s]"%default_outfile,metavar='FN')
     parser.add_argument("-m", "--mode",type=str,choices=['FULL','REDUCED','MINIMAL'], dest="mode",default=default_mode,metavar='MODE',
                         help="GRIFF storage mode [default %s]"%default_mode)
+    parser.add_argument("--compression",type=str, dest="compression",default=default_compression,metavar='CODEC',
+                        help="GRIFF compression codec: none, zlib, zlib-N (N=1..9), lz4, lz4-N (N=1..12), zstd or zstd-N (N=1..19), optionally followed by a chunk size for partial reading like /64k [default %s]"%default_compression)
+    parser.add_argument("--veto",type=str, dest="veto",default=default_veto,metavar='EXPR',
+                        help="Do not write events for which EXPR is true to the GRIFF file, e.g. \"edep_in('Detector')<10keV\" (see G4DataCollect.hh for available variables)")
+    parser.add_argument("--fullstepvolumes",type=str, dest="fullstepvols",default=default_fullstepvols,metavar='VOLS',
+                        help="Comma separated list of volumes in which GRIFF keeps all steps even in REDUCED or MINIMAL mode")
+    parser.add_argument("--stepencoding",type=str, dest="stepencoding",default=default_stepencoding,metavar='ENC',
+                        help="GRIFF step data encoding: STANDARD or COMPACT (float deltas for smaller files) [default %s]"%default_stepencoding)
     #Don't feed custom args of the form name=val to the parser:
     args_custom=set([a for a in sys.argv[1:] if (not a.startswith('-') and '=' in a)])
     (opt, args) = parser.parse_known_args([a for a in sys.argv[1:] if not a in args_custom])
@@ -408,7 +437,31 @@ def _swallowCmdLineAndLaunch(self):
         if opt.seed<0: parser.error('Seed must be a positive number')
         if opt.seed!=default_seed:
             self.setSeed(opt.seed)
+        if opt.rndengine and opt.rndengine!=self.rndEngineMode():
+            self.setRndEngineMode(opt.rndengine)
     if opt.njobs<1: parser.error('Number of parallel processes must be at least 1')
+    if opt.nthreads<0: parser.error('Number of threads must not be negative')
+    if opt.nthreads and opt.njobs>1: parser.error('The --threads and --jobs options can not be combined')
+    if opt.nthreads and (opt.vis or opt.interactive or opt.osgviewer or opt.osgviewer_data or opt.osgviewer_data_aim):
+        parser.error('The --threads option is not supported with visualisation or interactive sessions')
+    if opt.nthreads and (opt.heatmap or opt.mcpl):
+        parser.error('The --threads option is not supported with --heatmap or --mcpl')
+    if opt.checkpoint<0 or opt.checkpoint_minutes<0: parser.error('Checkpoint intervals must not be negative')
+    checkpointing = bool(opt.checkpoint or opt.checkpoint_minutes)
+    if opt.resume and not checkpointing: parser.error('The --resume option requires --checkpoint or --checkpoint-minutes')
+    if checkpointing and (opt.nthreads or opt.njobs>1): parser.error('Checkpointing can not be combined with --jobs or --threads')
+    if checkpointing and (opt.heatmap or opt.mcpl):
+        parser.error('Checkpointing is not supported with --heatmap or --mcpl')
+    if checkpointing and not unlimited_src:
+        parser.error('Checkpointing requires a generator with an unlimited number of events')
+    if opt.firstevent<0: parser.error('Index of first event must not be negative')
+    if opt.firstevent>2147483647: parser.error('Index of first event must fit in a G4 event ID (at most 2147483647)')
+    if opt.firstevent and (checkpointing or opt.nthreads or opt.njobs>1):
+        parser.error('The --firstevent option can not be combined with checkpointing, --jobs or --threads')
+    if opt.firstevent and not unlimited_src:
+        parser.error('The --firstevent option requires a generator with an unlimited number of events')
+    if (opt.indexedseeds or opt.firstevent) and norandom:
+        parser.error('The --indexedseeds and --firstevent options require the standard random setup')
 
     if unlimited_src:
         if opt.nevts<1:
@@ -564,9 +617,24 @@ def _swallowCmdLineAndLaunch(self):
             #requested otherwise
             if not norandom and not self.rndEvtMsgMode():
                 self.setRndEvtMsgMode('ALWAYS')
-        self.setOutput(opt.outfile,opt.mode)
+        self.setOutput(opt.outfile,opt.mode,opt.compression)
+        if opt.veto:
+            self.setOutputVeto(opt.veto)
+        if opt.fullstepvols:
+            self.setOutputFullStepVolumes(opt.fullstepvols)
+        if opt.stepencoding!=self.getOutputStepEncoding():
+            self.setOutputStepEncoding(opt.stepencoding)
         if opt.njobs!=self.getMultiProcessing():
             self.setMultiProcessing(opt.njobs)
+        if opt.nthreads!=self.getThreads():
+            self.setThreads(opt.nthreads)
+        if checkpointing:
+            self.setCheckpoint(opt.checkpoint,opt.checkpoint_minutes)
+            self.setResume(opt.resume)
+        if opt.indexedseeds!=self.getIndexedSeeding():
+            self.setIndexedSeeding(opt.indexedseeds)
+        if opt.firstevent!=self.getFirstEvent():
+            self.setFirstEvent(opt.firstevent)
         self.startSimulation(opt.nevts)
         for c in call_post_sim:
             c()
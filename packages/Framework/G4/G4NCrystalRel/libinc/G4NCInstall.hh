@@ -43,6 +43,10 @@ namespace G4NCrystalRel {
 
   void installOnDemand();
 
+  //In multi-threaded Geant4, the processes are per-thread and the functions
+  //above must be called in each worker thread (e.g. from
+  //G4UserWorkerInitialization::WorkerRunStart).
+
 }
 
 #endif
@@ -32,14 +32,17 @@
 #include "G4Region.hh"
 #include "globals.hh"
 
-#ifdef G4MULTITHREADED
-#  include "G4MTRunManager.hh"
-#endif
 
 namespace G4NCrystalRel {
   class ProcWrapper;
 
-  static ProcWrapper * s_proc = 0;
+  //Processes are per-thread in multi-threaded Geant4, so installation must
+  //happen in each worker thread:
+  static
+#ifdef G4MULTITHREADED //protect thread_local keyword to avoid potential headaches in ST builds
+  thread_local
+#endif
+    ProcWrapper * s_proc = 0;
   void doInstall(bool onDemand) {
     if (s_proc)
       return;
@@ -74,18 +77,6 @@ namespace G4NCrystalRel {
     }
 
 
-#ifdef G4MULTITHREADED
-    if (dynamic_cast<G4MTRunManager*>(G4RunManager::GetRunManager())) {
-      G4cout<<G4endl;
-      G4cout<<G4endl;
-      G4cout<<G4endl;
-      G4cout<<"G4NCrystal WARNING :: Detected usage of G4MTRunManager - but NCrystal code is not currently supporting multi-threaded mode!!"<<G4endl;
-      G4cout<<G4endl;
-      G4cout<<G4endl;
-      G4cout<<G4endl;
-    }
-#endif
-
     G4ProcessManager* pmanager = G4Neutron::Neutron()->GetProcessManager();
     if (!pmanager) {
       G4Exception("G4NCrystalRel::doInstall","Error",FatalException,
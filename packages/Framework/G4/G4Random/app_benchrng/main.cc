@@ -0,0 +1,136 @@
+#include "G4Random/NCG4RngEngine.hh"
+#include "RandUtils/Rand.hh"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+//Benchmark the time per random number of NCG4RngEngine (in both modes, via
+//the virtual CLHEP interface used by Geant4) and of RandUtils::Rand.
+
+namespace {
+  double secondsSince(std::chrono::steady_clock::time_point t0)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  }
+  //Mean of (some of) the numbers is printed, so the compiler can not skip
+  //generating them:
+  void report(const char* what, double secs, std::uint64_t n, double sum, std::uint64_t nsum)
+  {
+    printf("  %-36s : %7.3f ns/number (mean %.4f)\n",what,1e9*secs/n,sum/nsum);
+  }
+  void benchEngine(NCG4RngEngine::Mode mode, const char* modename, std::uint64_t n, unsigned arraysize)
+  {
+    NCG4RngEngine engine(mode);
+    engine.dgcode_set64BitSeed(123456789);
+    //Hide the type of the engine from the compiler, so calls are virtual like
+    //in Geant4:
+    CLHEP::HepRandomEngine * volatile ve = &engine;
+    CLHEP::HepRandomEngine * e = ve;
+    std::string lbl;
+    {
+      double sum(0.0);
+      auto t0 = std::chrono::steady_clock::now();
+      for (std::uint64_t i = 0; i < n; ++i)
+        sum += e->flat();
+      lbl = std::string("NCG4RngEngine[") + modename + "]::flat()";
+      report(lbl.c_str(),secondsSince(t0),n,sum,n);
+    }
+    {
+      std::vector<double> v(arraysize);
+      double sum(0.0);
+      std::uint64_t nloop = n / arraysize;
+      auto t0 = std::chrono::steady_clock::now();
+      for (std::uint64_t i = 0; i < nloop; ++i) {
+        e->flatArray((int)arraysize,&v[0]);
+        sum += v[i%arraysize];
+      }
+      lbl = std::string("NCG4RngEngine[") + modename + "]::flatArray()";
+      report(lbl.c_str(),secondsSince(t0),nloop*arraysize,sum,nloop);
+    }
+  }
+  //Check that flat() and flatArray() give identical streams:
+  bool checkConsistency(NCG4RngEngine::Mode mode)
+  {
+    NCG4RngEngine e1(mode), e2(mode);
+    e1.dgcode_set64BitSeed(987654321);
+    e2.dgcode_set64BitSeed(987654321);
+    std::vector<double> v;
+    for (unsigned len : { 1, 7, 300, 256, 1000, 3, 5000 }) {
+      v.resize(len);
+      e2.flatArray((int)len,&v[0]);
+      for (auto x : v) {
+        double y = e1.flat();
+        if (x!=y||!(y>0.0&&y<1.0))
+          return false;
+      }
+    }
+    return true;
+  }
+  bool checkStrictStream()
+  {
+    NCG4RngEngine e;
+    e.dgcode_set64BitSeed(1234);
+    NCrystal::RandXRSRImpl rng(1234);
+    constexpr double lastvalbefore1 = 1.0 - std::numeric_limits<double>::epsilon();
+    for (unsigned i = 0; i < 100000; ++i)
+      if (e.flat()!=std::min<double>(rng.generate(),lastvalbefore1))
+        return false;
+    return true;
+  }
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> args(argv+1, argv+argc);
+  bool request_help( std::find(args.begin(), args.end(), "-h") != args.end()
+                     || std::find(args.begin(), args.end(), "--help") != args.end() );
+  if (request_help || args.size()>2 ) {
+    printf("\nUsage:\n\n  %s [NMILLION [ARRAYSIZE]]\n\n"
+           "Generates NMILLION million random numbers (default 100) with each method\n"
+           "and reports the time per number. Arrays passed to flatArray() have ARRAYSIZE\n"
+           "entries (default 1000).\n"
+           "\nExample:\n\n"
+           "  %s 500 64\n\n",
+           argv[0],argv[0]);
+    return request_help ? 0 : 1;
+  }
+  std::uint64_t nmillion = 100;
+  unsigned arraysize = 1000;
+  try {
+    if (args.size()>=1)
+      nmillion = std::stoull(args[0]);
+    if (args.size()>=2)
+      arraysize = (unsigned)std::stoul(args[1]);
+  } catch (std::exception&) {
+    nmillion = 0;
+  }
+  if (!nmillion||!arraysize) {
+    printf("ERROR: Invalid arguments!\n");
+    return 1;
+  }
+  if (!checkStrictStream()) {
+    printf("ERROR: STRICT mode does not reproduce the NCrystal stream!\n");
+    return 1;
+  }
+  if (!checkConsistency(NCG4RngEngine::Mode::STRICT)||!checkConsistency(NCG4RngEngine::Mode::BATCHED)) {
+    printf("ERROR: flat() and flatArray() give different streams!\n");
+    return 1;
+  }
+
+  const std::uint64_t n = nmillion * 1000000;
+  printf("Generating %llu random numbers per method (arrays of %u):\n",(long long unsigned)n,arraysize);
+  benchEngine(NCG4RngEngine::Mode::STRICT,"STRICT",n,arraysize);
+  benchEngine(NCG4RngEngine::Mode::BATCHED,"BATCHED",n,arraysize);
+  {
+    RandUtils::Rand rand(123456789);
+    double sum(0.0);
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < n; ++i)
+      sum += rand.shoot();
+    report("RandUtils::Rand::shoot()",secondsSince(t0),n,sum,n);
+  }
+  return 0;
+}
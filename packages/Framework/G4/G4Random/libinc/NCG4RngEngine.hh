@@ -0,0 +1,96 @@
+#ifndef G4Random_NCG4RngEngine_hh
+#define G4Random_NCG4RngEngine_hh
+
+//Implementation of Hep Random Engine interface, wrapping the NCrystal
+//Xoroshiro128+ RNG.
+//
+//In the default STRICT mode, the engine reproduces exactly the stream of the
+//NCrystal generator. In BATCHED mode, numbers are instead produced in blocks
+//from nlanes interleaved xoroshiro128+ streams (lanes), in a loop which the
+//compiler can vectorise, and handed out from a buffer. The lanes are seeded
+//from the state of the NCrystal generator whenever it is (re)seeded, so the
+//BATCHED stream is just as reproducible, but differs from the STRICT one. The
+//NCrystal generator itself is only used for dgcode_genHighQuality64bitUint in
+//BATCHED mode. Note that with the default chained seeding, where the seed of
+//each event is drawn from the engine after the previous event, seeds therefore
+//differ between the modes (in STRICT mode they even depend on how many numbers
+//the previous event used). Only with indexed seeding are the seeds of events
+//in a job the same in both modes.
+//The gain is mostly in flatArray and when compiling for wide vector units (see
+//the benchrng app), as calls to flat() are dominated by the virtual call.
+
+#include "CLHEP/Random/RandomEngine.h"
+#include "NCrystal/internal/NCRandUtils.hh"
+
+class NCG4RngEngine final : public CLHEP::HepRandomEngine  {
+public:
+  enum class Mode { STRICT, BATCHED };
+  NCG4RngEngine(Mode mode = Mode::STRICT);
+  virtual ~NCG4RngEngine();
+  Mode mode() const { return m_mode; }
+  std::string name() const override { return "NCrystalXoroshiroEngine"; }
+  double flat() override { return m_pos < m_nbuf ? m_buf[m_pos++] : flatSlow(); }
+  void flatArray(const int size, double* vect) override
+  {
+    if ( m_mode == Mode::BATCHED ) {
+      flatArrayBatched( size, vect );
+      return;
+    }
+    for ( int i = 0; i < size; ++ i )
+      vect[i] = doGenerate();
+  }
+  //Direct access to RNG:
+  void dgcode_set64BitSeed(std::uint64_t seed) { m_rng = NCrystal::RandXRSRImpl{ seed }; resetBatch(); }
+  std::uint64_t dgcode_genHighQuality64bitUint() { return m_rng.genUInt64(); }
+  //Implementing the full interface just to be safe, but the following functions
+  //are not really tested (in BATCHED mode, only the state of the NCrystal
+  //generator is saved, and restoring it restarts the lanes from that state):
+  void setSeed(long seed, int) override;
+  void setSeeds(const long * seeds, int) override;
+  void saveStatus( const char filename[] ) const override;
+  void restoreStatus( const char filename[] ) override;
+  void showStatus() const override;
+
+  std::ostream& put( std::ostream& ) const override;
+  std::istream& get( std::istream& ) override;
+
+  std::vector<unsigned long> put () const override;
+  bool get (const std::vector<unsigned long> &) override;
+
+  bool getState (const std::vector<unsigned long> & v) override;
+  std::istream & getState ( std::istream & is ) override;
+
+  static constexpr unsigned nlanes = 8;
+  static constexpr unsigned blocksize = 256;//numbers generated at a time in BATCHED mode
+
+private:
+  static constexpr double lastvalbefore1 = 1.0 - std::numeric_limits<double>::epsilon();
+  static_assert( lastvalbefore1 < 1.0, "");
+  static_assert( lastvalbefore1 > 1.0-1e-15, "");
+  static_assert( blocksize % nlanes == 0, "");
+  double doGenerate() {
+    //NCrystal rng shoots in (0,1] but we need to exclude 1 as well. We simply do:
+    return std::min<double>( m_rng.generate(), lastvalbefore1 );
+  }
+  double flatSlow()
+  {
+    if ( m_mode == Mode::STRICT )
+      return doGenerate();
+    fillBlock( m_buf );
+    m_nbuf = blocksize;
+    m_pos = 1;
+    return m_buf[0];
+  }
+  void flatArrayBatched( int size, double* vect );
+  void fillBlock( double* out );
+  void resetBatch();//seed lanes from m_rng and discard buffered numbers
+  NCrystal::RandXRSRImpl m_rng;
+  Mode m_mode;
+  unsigned m_pos = 0;
+  unsigned m_nbuf = 0;//always 0 in STRICT mode
+  std::uint64_t m_lanes0[nlanes];
+  std::uint64_t m_lanes1[nlanes];
+  alignas(64) double m_buf[blocksize];
+};
+
+#endif
@@ -11,6 +11,18 @@
 //
 //Note that it is too late to do step 2) in an G4UserEventAction::BeginEvent as
 //particle generation happens before.
+//
+//In multi-threaded Geant4, both steps must be carried out in each worker thread
+//(with the generator instance of that thread).
+//
+//By default, the seed of each event is drawn from the random stream at the end
+//of the previous event, so events can only be reproduced by replaying the
+//chain. When FrameworkGlobals::currentEvtIndex() is available (as set up by
+//the multi-processing framework, or by the launcher with indexed seeding), the
+//seed of each event is instead derived from the seed of the first event and
+//the index of the event alone (see seedForEvtIndex), so any event can be
+//regenerated on its own, and the way events are distributed between processes
+//or threads does not affect results.
 
 #include "Core/Types.hh"
 namespace G4Interfaces {
@@ -19,8 +31,21 @@ namespace G4Interfaces {
 
 struct RandomManager {
   enum EVTMSGLEVEL { EVTMSG_NEVER, EVTMSG_ADAPTABLE, EVTMSG_ALWAYS };
-  static void init(std::uint64_t seed_of_first_event, EVTMSGLEVEL lvl = EVTMSG_ADAPTABLE );
+  //Engine mode (see NCG4RngEngine.hh). ENGINE_BATCHED is faster, but gives
+  //other random numbers in events than the default ENGINE_STRICT:
+  enum ENGINEMODE { ENGINE_STRICT, ENGINE_BATCHED };
+  static void init(std::uint64_t seed_of_first_event, EVTMSGLEVEL lvl = EVTMSG_ADAPTABLE,
+                   ENGINEMODE mode = ENGINE_STRICT );
   static void attach(G4Interfaces::ParticleGenBase* the_particle_generator_of_the_job);
+  //Seed of the event with a given index in a job (counter-based, using the
+  //output of a splitmix64 generator at position idx):
+  static std::uint64_t seedForEvtIndex(std::uint64_t seed_of_first_event, std::uint64_t idx);
+  //For generators drawing random numbers for several events at once: the seed
+  //of the first event of the job and direct reseeding of the random engine
+  //(only when init was called in the current thread):
+  static bool isInitialised();
+  static std::uint64_t seedOfFirstEvent();
+  static void setEngineSeed(std::uint64_t seed);
 };
 
 #endif
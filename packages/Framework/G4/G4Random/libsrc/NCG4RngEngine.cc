@@ -1,11 +1,99 @@
-#include "NCG4RngEngine.hh"
+#include "G4Random/NCG4RngEngine.hh"
 
 #include "NCrystal/internal/NCString.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 namespace NC = NCrystal;
 
+namespace {
+  std::uint64_t splitmix64( std::uint64_t& x )
+  {
+    std::uint64_t z = ( x += UINT64_C(0x9E3779B97F4A7C15) );
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+  }
+}
+
+NCG4RngEngine::NCG4RngEngine( Mode mode )
+  : m_mode(mode)
+{
+  resetBatch();
+}
+
 NCG4RngEngine::~NCG4RngEngine() = default;
 
+void NCG4RngEngine::resetBatch()
+{
+  m_pos = m_nbuf = 0;
+  if ( m_mode == Mode::STRICT )
+    return;
+  //Lane states are the outputs of a splitmix64 generator, seeded by the state
+  //of the NCrystal generator (which is left untouched):
+  assert(m_rng.state().size()==2);
+  std::uint64_t x = m_rng.state()[0];
+  splitmix64( x );
+  x ^= m_rng.state()[1];
+  for ( unsigned j = 0; j < nlanes; ++j ) {
+    m_lanes0[j] = splitmix64( x );
+    m_lanes1[j] = splitmix64( x );
+    if ( !m_lanes0[j] && !m_lanes1[j] )
+      m_lanes0[j] = 1;//all-zero state is invalid
+  }
+}
+
+void NCG4RngEngine::fillBlock( double* out )
+{
+  //Work on local copies of the lane states, so they can stay in (vector)
+  //registers. The inner loop is a xoroshiro128+ step in each lane, followed by
+  //a mapping to (0,1):
+  std::uint64_t s0[nlanes], s1[nlanes];
+  std::copy( m_lanes0, m_lanes0 + nlanes, s0 );
+  std::copy( m_lanes1, m_lanes1 + nlanes, s1 );
+  for ( unsigned i = 0; i < blocksize; i += nlanes ) {
+    for ( unsigned j = 0; j < nlanes; ++j ) {
+      const std::uint64_t a = s0[j];
+      const std::uint64_t b = s1[j] ^ a;
+      const std::uint64_t r = a + s1[j];
+      s0[j] = ( ( a << 24 ) | ( a >> 40 ) ) ^ b ^ ( b << 16 );
+      s1[j] = ( b << 37 ) | ( b >> 27 );
+      //Upper 52 bits as mantissa of a double in [1,2), shifted to the centres
+      //of the 2^52 bins in (0,1) (both operations are exact, and no clamping
+      //is needed to exclude 0 and 1):
+      const std::uint64_t bits = ( r >> 12 ) | UINT64_C(0x3FF0000000000000);
+      double d;
+      std::memcpy( &d, &bits, sizeof(d) );
+      out[i+j] = ( d - 1.0 ) + 0x1p-53;
+    }
+  }
+  std::copy( s0, s0 + nlanes, m_lanes0 );
+  std::copy( s1, s1 + nlanes, m_lanes1 );
+}
+
+void NCG4RngEngine::flatArrayBatched( int size, double* vect )
+{
+  //Gives the same numbers as repeated calls to flat(), but full blocks are
+  //generated directly into the output:
+  if ( size <= 0 )
+    return;
+  unsigned n = static_cast<unsigned>( size );
+  unsigned ncopy = std::min<unsigned>( n, m_nbuf - m_pos );
+  std::copy( m_buf + m_pos, m_buf + m_pos + ncopy, vect );
+  m_pos += ncopy;
+  vect += ncopy;
+  n -= ncopy;
+  for ( ; n >= blocksize; n -= blocksize, vect += blocksize )
+    fillBlock( vect );
+  if ( n ) {
+    fillBlock( m_buf );
+    m_nbuf = blocksize;
+    std::copy( m_buf, m_buf + n, vect );
+    m_pos = n;
+  }
+}
+
 void NCG4RngEngine::setSeed( long seed, int )
 {
   long tmp[2] = { seed, 0 };
@@ -122,6 +210,7 @@ bool NCG4RngEngine::get( const std::vector<unsigned long> & v )
     state[1] = y;
   }
   m_rng = NC::RandXRSRImpl( state );
+  resetBatch();
   return true;
 }
 
@@ -174,6 +263,7 @@ std::istream& NCG4RngEngine::get ( std::istream& is )
   if ( tmp != "NCrystalXoroshiroEngine-end" )
     return endBad();
   m_rng = NC::RandXRSRImpl( state );
+  resetBatch();
 
   return is;
   //  return getState(is);
@@ -4,24 +4,32 @@
 #include "G4Utils/Flush.hh"
 #include "CLHEP/Random/Random.h"
 #include "G4Interfaces/FrameworkGlobals.hh"
-#include "NCG4RngEngine.hh"
+#include "G4Random/NCG4RngEngine.hh"
 
 class RndmSeedCB;
-static std::shared_ptr<RndmSeedCB> s_theRndmSeedCB = nullptr;
+//(one per thread in multi-threaded Geant4, where each worker thread has its own
+//engine and generator):
+static
+#ifdef G4MULTITHREADED //protect thread_local keyword to avoid potential headaches in ST builds
+thread_local
+#endif
+  std::shared_ptr<RndmSeedCB> s_theRndmSeedCB = nullptr;
 class RndmSeedCB : public G4Interfaces::PreGenCallBack {
 public:
 
   //Will set the seed at the beginning of each event and print it (occasionally)
   //along with the event number. First event will start with the seed passed in
   //through the variable "firstseed".
-  RndmSeedCB(std::uint64_t firstseed,RandomManager::EVTMSGLEVEL l)
+  RndmSeedCB(std::uint64_t firstseed,RandomManager::EVTMSGLEVEL l,RandomManager::ENGINEMODE mode)
     : PreGenCallBack(),
+      m_firstseed(firstseed),
       m_nextseed(firstseed),
       m_evtcount(0),
       m_evtMsgLvl(l)
   {
-    printf("%sInstalling xoroshiro128+ random generator (via NCrystal)\n",FrameworkGlobals::printPrefix());
-    m_engine = new NCG4RngEngine;
+    printf("%sInstalling xoroshiro128+ random generator (via NCrystal%s)\n",FrameworkGlobals::printPrefix(),
+           mode==RandomManager::ENGINE_BATCHED?", batched mode":"");
+    m_engine = new NCG4RngEngine(mode==RandomManager::ENGINE_BATCHED?NCG4RngEngine::Mode::BATCHED:NCG4RngEngine::Mode::STRICT);
     CLHEP::HepRandom::setTheEngine(m_engine);
     m_engine->dgcode_set64BitSeed(23487653);//This seed will be used only during
                                             //initialisation, so silently having it be the
@@ -32,22 +40,13 @@ public:
   virtual void preGen()
   {
     std::uint64_t seed_to_use;
-    if (m_nextseed) {
-      //1st event...
-      if (FrameworkGlobals::isForked()&&FrameworkGlobals::isChild()) {
-        //...in a forked off child.
-
-        //TODO: We should have a separate stream to generate evt seeds. That way
-        //we can ensure to get the same distributions irrespective of number of
-        //processes (also, we should fix the evt/run numbers).
-
-        const std::uint64_t large_prime = UINT64_C(541234505579);//something larger than 4 billion
-                                                            //=> should hopefully avoid
-                                                            //clashes with multiple seeds
-                                                            //specified by the user
-        m_nextseed += large_prime*FrameworkGlobals::mpID();
-        assert(m_nextseed);
-      }
+    if (FrameworkGlobals::hasCurrentEvtIndex()) {
+      //Events are distributed between processes or threads, so the seed must
+      //only depend on the index of the event within the job (and not on which
+      //process or thread happens to simulate it):
+      seed_to_use = RandomManager::seedForEvtIndex(m_firstseed,FrameworkGlobals::currentEvtIndex());
+    } else if (m_nextseed) {
+      //1st event:
       seed_to_use = m_nextseed;
       m_nextseed=0;
     } else {
@@ -76,25 +75,64 @@ public:
         }
     }
   }
+  std::uint64_t firstSeed() const { return m_firstseed; }
+  void setEngineSeed(std::uint64_t seed) { m_engine->dgcode_set64BitSeed(seed); }
   virtual ~RndmSeedCB()
   {
     assert(s_theRndmSeedCB.get()==this);
     s_theRndmSeedCB = nullptr;
   }
 private:
+  std::uint64_t m_firstseed;
   std::uint64_t m_nextseed;
   NCG4RngEngine * m_engine = nullptr;
   unsigned m_evtcount;
   RandomManager::EVTMSGLEVEL m_evtMsgLvl;
 };
 
-void RandomManager::init(std::uint64_t seed_of_first_event,EVTMSGLEVEL lvl)
+namespace {
+  std::uint64_t mix64(std::uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+  }
+}
+
+std::uint64_t RandomManager::seedForEvtIndex(std::uint64_t seed_of_first_event, std::uint64_t idx)
+{
+  //First event of the job uses the first seed as usual, the rest the output
+  //of a splitmix64 generator (seeded by the first seed) at position idx:
+  if (!idx)
+    return seed_of_first_event;
+  std::uint64_t z = mix64(seed_of_first_event) + idx * UINT64_C(0x9E3779B97F4A7C15);
+  return mix64(z);
+}
+
+void RandomManager::init(std::uint64_t seed_of_first_event,EVTMSGLEVEL lvl,ENGINEMODE mode)
 {
   assert(!s_theRndmSeedCB);
-  s_theRndmSeedCB = std::make_shared<RndmSeedCB>(seed_of_first_event,lvl);
+  s_theRndmSeedCB = std::make_shared<RndmSeedCB>(seed_of_first_event,lvl,mode);
 }
 
 void RandomManager::attach(G4Interfaces::ParticleGenBase* pg)
 {
   pg->installPreGenCallBack(s_theRndmSeedCB);
 }
+
+bool RandomManager::isInitialised()
+{
+  return s_theRndmSeedCB != nullptr;
+}
+
+std::uint64_t RandomManager::seedOfFirstEvent()
+{
+  assert(s_theRndmSeedCB);
+  return s_theRndmSeedCB->firstSeed();
+}
+
+void RandomManager::setEngineSeed(std::uint64_t seed)
+{
+  assert(s_theRndmSeedCB);
+  s_theRndmSeedCB->setEngineSeed(seed);
+}
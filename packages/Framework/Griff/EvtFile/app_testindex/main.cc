@@ -0,0 +1,167 @@
+#include "EvtFile/FileWriter.hh"
+#include "EvtFile/FileReader.hh"
+#include "Utils/ProgressiveHash.hh"
+#include "ZLibUtils/Compress.hh"
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+//Test writing and reading of files with and without the event index footer,
+//including files in format version 3 (before the codec word was added to the
+//full data section), which are written by hand here. All files are read both
+//through a stream and through a memory mapping.
+
+namespace {
+
+  class TestFormat : public EvtFile::IFormat {
+  public:
+    virtual std::uint32_t magicWord() const { return 0x7e57f11e; }
+    virtual const char* fileExtension() const { return ".evttest"; }
+    virtual const char* eventBriefDataName() const { return "brief"; }
+    virtual const char* eventFullDataName() const { return "full"; }
+    virtual bool compressFullData() const { return true; }
+  };
+
+  const TestFormat s_format;
+  const unsigned s_nevts = 45;
+
+  //Content of the sections of event i (a new database entry every 10 events):
+  std::string dbData(unsigned i) { return i%10 ? std::string() : "db"+std::to_string(i); }
+  std::string briefData(unsigned i) { return "brief"+std::to_string(i); }
+  std::string fullData(unsigned i)
+  {
+    std::string s(100+7*i,'\0');
+    for (unsigned j = 0; j < s.size(); ++j)
+      s[j] = 'a'+(i+j/13)%26;
+    return s;
+  }
+
+  class DBListener : public EvtFile::EvtFileDB {
+  public:
+    virtual void newInfoAvailable(const char*data, unsigned nbytes) { m_entries += std::string(data,nbytes)+" "; }
+    virtual void clearInfo() { m_entries.clear(); }
+    const std::string& entries() const { return m_entries; }
+  private:
+    std::string m_entries;
+  };
+
+  void writeFile(const char * fn, bool writeIndex, const char * compression)
+  {
+    EvtFile::FileWriter fw(&s_format,fn);
+    fw.setWriteEventIndex(writeIndex);
+    fw.setCompression(EvtFile::parseCompression(compression));
+    for (unsigned i = 0; i < s_nevts; ++i) {
+      std::string db(dbData(i)), brief(briefData(i)), full(fullData(i));
+      if (!db.empty())
+        fw.writeDataDBSection(db.data(),db.size());
+      fw.writeDataBriefSection(brief.data(),brief.size());
+      fw.writeDataFullSection(full.data(),full.size());
+      fw.flushEventToDisk(1,1000+i);
+    }
+    fw.close();
+  }
+
+  //Files of version 3 had the full data compressed with zlib, without a
+  //codec word in front:
+  void writeVersion3File(const char * fn)
+  {
+    std::ofstream os(fn,std::ios::out|std::ios::binary);
+    std::uint64_t pos(0);
+    auto write = [&os,&pos](const void * data, unsigned nbytes)
+    {
+      os.write(static_cast<const char*>(data),nbytes);
+      pos += nbytes;
+    };
+    std::int32_t fileheader[2] = { (std::int32_t)s_format.magicWord(), 3 };
+    write(fileheader,sizeof(fileheader));
+    std::vector<char> index, compressed;
+    for (unsigned i = 0; i < s_nevts; ++i) {
+      std::string db(dbData(i)), brief(briefData(i)), full(fullData(i));
+      unsigned ncompressed;
+      ZLibUtils::compressToBuffer(full.data(),full.size(),compressed,ncompressed);
+      std::uint32_t eventheader[6] = { 0, 1, 1000+i, (std::uint32_t)db.size(),
+                                       (std::uint32_t)brief.size(), ncompressed };
+      ProgressiveHash hash;
+      hash.addData((const char*)&(eventheader[1]),5*sizeof(std::uint32_t));
+      hash.addData(db.data(),db.size());
+      hash.addData(brief.data(),brief.size());
+      hash.addData(full.data(),full.size());
+      eventheader[0] = hash.getHash();
+      index.insert(index.end(),(const char*)&pos,(const char*)&pos+sizeof(pos));
+      index.insert(index.end(),(const char*)eventheader,(const char*)eventheader+sizeof(eventheader));
+      write(eventheader,sizeof(eventheader));
+      write(db.data(),db.size());
+      write(brief.data(),brief.size());
+      write(compressed.data(),ncompressed);
+    }
+    std::uint64_t footerpos(pos);
+    std::uint32_t trailer[2] = { s_nevts, 0x1de7f00e };
+    write(index.data(),index.size());
+    write(&footerpos,sizeof(footerpos));
+    write(trailer,sizeof(trailer));
+  }
+
+  bool eventOK(EvtFile::FileReader& fr)
+  {
+    unsigned i = fr.eventNumber()-1000;
+    std::string full(fullData(i)), brief(briefData(i));
+    return fr.eventIndex()==i
+      && fr.verifyEventDataIntegrity()
+      && std::string(fr.getBriefData(),fr.nBytesBriefData())==brief
+      && std::string(fr.getFullData(),fr.nBytesFullData())==full;
+  }
+
+  void readFile(const char * fn, EvtFile::FileReader::ReadMode readmode)
+  {
+    DBListener db;
+    EvtFile::FileReader fr(&s_format,fn,&db);
+    fr.setReadMode(readmode);
+    if (!fr.init())
+      throw std::runtime_error(std::string("Could not open file: ")+fr.bad_reason());
+    printf("  %s (%s): version=%i index=%s nEvents=%u\n",fn,
+           readmode==EvtFile::FileReader::READ_MMAP?"mmap":"stream",
+           (int)fr.version(),fr.hasEventIndex()?"yes":"no",fr.nEvents());
+    //Database sections of skipped events must still be delivered:
+    if (!fr.seekEventByIndex(37))
+      throw std::runtime_error("Could not seek to event");
+    printf("    seek to index 37: event=%u ok=%s db=[ %s]\n",fr.eventNumber(),
+           eventOK(fr)?"yes":"no",db.entries().c_str());
+    if (!fr.goToEvent(1,1012))
+      throw std::runtime_error("Could not go to event by number");
+    printf("    go to event 1012: index=%u ok=%s\n",fr.eventIndex(),eventOK(fr)?"yes":"no");
+    if (!fr.skipEvents(-3))
+      throw std::runtime_error("Could not skip backwards");
+    printf("    skip back 3: index=%u ok=%s db=[ %s]\n",fr.eventIndex(),
+           eventOK(fr)?"yes":"no",db.entries().c_str());
+    printf("    seek beyond last event: %s\n",fr.seekEventByIndex(s_nevts)?"succeeded":"failed");
+    unsigned nevts(0), nok(0);
+    fr.goToFirstEvent();
+    while (fr.eventActive()) {
+      ++nevts;
+      if (eventOK(fr))
+        ++nok;
+      fr.goToNextEvent();
+    }
+    printf("    looped over %u events of which %u were ok (bad=%s)\n",nevts,nok,fr.bad()?"yes":"no");
+  }
+
+}
+
+int main(int,char**) {
+  printf("Writing files\n");
+  writeFile("indexed.evttest",true,"zlib");
+  writeFile("noindex.evttest",false,"zlib");
+  writeFile("indexed_none.evttest",true,"none");
+  writeVersion3File("indexed_v3.evttest");
+  printf("Reading files\n");
+  const char * files[] = { "indexed.evttest", "noindex.evttest", "indexed_none.evttest", "indexed_v3.evttest" };
+  for (auto fn : files) {
+    readFile(fn,EvtFile::FileReader::READ_STREAM);
+    readFile(fn,EvtFile::FileReader::READ_MMAP);
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef EvtFile_Codec_hh
+#define EvtFile_Codec_hh
+
+//Codecs available for the full data section of events, for formats where
+//IFormat::compressFullData() is true. From EVTFILE_VERSION 4, the codec is
+//recorded in the first word of each non-empty full data section on disk, so
+//readers need no configuration and files might even mix codecs. Files of
+//earlier versions always used zlib at the default level.
+//
+//Codecs are selected with strings like "none", "zlib" (default level) or
+//"zlib-1" (fastest) through "zlib-9" (best compression). Likewise "lz4" or
+//"lz4-N" (N=1..12, where levels above 2 use the slower LZ4HC compressor, but
+//decompression is equally fast), and "zstd" or "zstd-N" (N=1..19). The lz4
+//and zstd codecs use the liblz4 and libzstd shared libraries of the system (or
+//conda environment), which are loaded at runtime when first needed, so they
+//are optional: codecAvailable() tells whether they could be loaded.
+//
+//Compressed data can optionally be split in independently compressed chunks
+//of a fixed (uncompressed) size, by appending "/<size>" or "/<size>k" to the
+//codec string (e.g. "zlib/64k"). Readers then only have to inflate the chunks
+//holding the parts of the data actually accessed (see
+//FileReader::getFullData(offset,nbytes)), at the cost of slightly larger files.
+
+#include "Core/Types.hh"
+#include <string>
+
+namespace EvtFile {
+
+  enum Codec {
+    CODEC_NONE = 0,
+    CODEC_ZLIB = 1,
+    CODEC_LZ4 = 2,
+    CODEC_ZSTD = 3
+  };
+
+  struct Compression {
+    Compression() : codec(CODEC_ZLIB), level(-1), chunkSize(0) {}
+    Compression(Codec c, int l = -1, unsigned cs = 0) : codec(c), level(l), chunkSize(cs) {}
+    Codec codec;
+    int level;//codec specific, -1 means default of the codec
+    unsigned chunkSize;//bytes of uncompressed data per chunk, 0 means no chunking
+  };
+
+  //Allowed range of Compression::chunkSize (unless 0):
+  const unsigned COMPRESSION_MIN_CHUNKSIZE = 1024;
+  const unsigned COMPRESSION_MAX_CHUNKSIZE = 64*1024*1024;
+
+  //Parse compression strings as described above (throws std::runtime_error in
+  //case of invalid or unsupported input):
+  Compression parseCompression(const char*);
+
+  //Inverse of parseCompression:
+  std::string compressionName(const Compression&);
+
+  //Name of codec or "unknown":
+  const char* codecName(std::uint32_t codec);
+
+  //Whether or not data encoded with the codec can be written and read:
+  bool codecAvailable(std::uint32_t codec);
+
+  //Highest level supported by the codec (0 if levels are not supported):
+  int codecMaxLevel(std::uint32_t codec);
+
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "Core/Types.hh"
 #include "EvtFile/IFormat.hh"
+#include "EvtFile/Codec.hh"
 #include "EvtFile/IDBSubSectionReader.hh"
 #include <vector>
 #include <fstream>
@@ -43,6 +44,26 @@ namespace EvtFile {
 
     bool isInit() const;//returns true after init() has been called.
 
+    //Data can be read through a std::ifstream (READ_STREAM), or from a
+    //read-only memory mapping of the file (READ_MMAP), in which case
+    //getBriefData() and uncompressed getFullData() return pointers directly
+    //into the mapping (when 32bit aligned) and compressed data is inflated
+    //straight from it.
+    //READ_AUTO selects memory mapping only for regular files on local file
+    //systems. If the mapping fails, the reader silently falls back to
+    //READ_STREAM. Must be called before init():
+    enum ReadMode { READ_STREAM, READ_MMAP, READ_AUTO };
+    void setReadMode(ReadMode rm) { assert(!isInit()); m_readMode = rm; }
+    bool isMemoryMapped() const { return m_mapData!=0; }
+
+    //Optionally let nthreads worker threads read (and decompress) the brief and
+    //full data of the next depth events (default 2*nthreads) ahead of the
+    //current one, so sequential access rarely has to wait for the data. It is
+    //fine to navigate the file arbitrarily, but only events following the
+    //current one are prefetched. Set nthreads=0 to disable again:
+    void setPrefetch(unsigned nthreads, unsigned depth = 0);
+    unsigned prefetchThreads() const { return m_prefetchThreads; }
+
     bool init();//Actually opens file and seeks to the first event if
                 //any. Returns true if all ok. NB: Even returns true on a file
                 //with zero events as there can be valid use-cases for files
@@ -81,6 +102,15 @@ namespace EvtFile {
     bool seekEventByIndex(unsigned idx);//event idx in the file [0=first evt in file, 1=second, etc.]
     bool goToEvent(std::uint32_t run_number,std::uint32_t evt_number);
 
+    //Files written with an event index footer allow instant random access to
+    //all events. Without it, navigation to unvisited events implies a scan
+    //through the event headers of the file:
+    bool hasEventIndex() const { return m_hasIndex; }
+
+    //Total number of events in the file (note that without an event index, the
+    //first call implies a scan through the remainder of the file):
+    unsigned nEvents();
+
     /////////////////////////
     //  Event data access  //
     /////////////////////////
@@ -95,10 +125,17 @@ namespace EvtFile {
     unsigned eventNumber() const { return m_currentEventInfo->evtNumber; }
     unsigned eventIndex() const { return m_currentEventInfo->evtIndex; }
     unsigned nBytesBriefData() const { return m_currentEventInfo->sectionSize_briefdata; }
-    unsigned nBytesFullData() { if (!m_fulldata_isloaded) getFullData(); return m_fulldata_size; }
+    unsigned nBytesFullData() { if (!m_fulldata_isloaded&&!m_fulldata_ispartial) getFullData(0,0); return m_fulldata_size; }
     unsigned nBytesFullDataOnDisk() const { return m_currentEventInfo->sectionSize_fulldata; }
+    //Codec used for the full data section on disk (an EvtFile::Codec value):
+    std::uint32_t fullDataCodec() { if (!m_fulldata_isloaded&&!m_fulldata_ispartial) getFullData(0,0); return m_fulldata_codec; }
     const char* getBriefData();//on demand loading => not const (we could consider mutable, but...)
     const char* getFullData();//on demand loading => not const (we could consider mutable, but...)
+    //Access to nbytes of the full data starting at offset. The returned
+    //pointer is to the full data as returned by getFullData(), but when the
+    //data was compressed in chunks (see Codec.hh), only chunks overlapping the
+    //requested range are guaranteed to be inflated:
+    const char* getFullData(unsigned offset, unsigned nbytes);
 
     //Special methods for data hashing / integrity
     std::uint32_t eventCheckSum() const;//Checksum stored in file
@@ -139,8 +176,46 @@ namespace EvtFile {
     std::vector<char> m_section_fulldata_compressed;
     bool m_briefdata_isloaded;
     bool m_fulldata_isloaded;
+    bool m_fulldata_ispartial;//chunked data not yet fully inflated
+    std::uint32_t m_fulldata_codec;
+    //Chunked full data is inflated into m_section_fulldata as needed:
+    const char * m_fulldata_ondisk;//chunk table (points into m_section_fulldata_compressed or the mapping)
+    unsigned m_fulldata_chunksize;
+    unsigned m_fulldata_chunksleft;
+    std::vector<std::uint32_t> m_fulldata_chunkpos;//offset of each chunk (and the end) in m_fulldata_ondisk
+    std::vector<bool> m_fulldata_chunkdone;
+    const char * m_briefdata;//points into m_section_briefdata or the mapping
+    const char * m_fulldata;//points into m_section_fulldata or the mapping
+    const char * readFullDataOnDisk();
+    bool decodeFullDataOnDisk(const char*);
+    void inflateChunks(unsigned offset, unsigned nbytes);
+
+    //Memory mapping:
+    ReadMode m_readMode;
+    const char * m_mapData;
+    std::uint64_t m_mapSize;
+    unsigned m_lastAdvisedIdx;
+    bool m_mapSequential;
+    void mapFile();
+    void unmapFile();
+    const char * mappedData(std::streampos pos, std::uint64_t nbytes) const;
+    void adviseAccess(unsigned idx);
+
+    //Prefetching:
+    struct Prefetcher;
+    Prefetcher * m_prefetch;
+    unsigned m_prefetchThreads;
+    unsigned m_prefetchDepth;
+    void startPrefetch();
+    bool usePrefetchedData();
 
     void initEventAtIndex(unsigned idx);
+    bool loadEventIndex();
+    bool loadDBSectionsUpTo(unsigned idx);
+    bool scanNextEventHeader(bool lookahead);
+    bool m_hasIndex;
+    bool m_allEvtsKnown;//true when the index was loaded or the end of file was reached
+    unsigned m_nDBSectionsLoaded;//number of events whose DB section was passed on to m_db_listener
     struct EventInfo {
       std::uint32_t checkSum;
       std::uint32_t runNumber;
@@ -155,7 +230,7 @@ namespace EvtFile {
     EventInfo * m_currentEventInfo;
     std::vector<EventInfo> m_evts;
     ////The next map is only populated on demand when goToEvent is called!
-    std::map<std::pair<std::uint32_t,std::uint32_t>,EventInfo* > m_evtMap; //(runNbr,evtNbr) -> EventInfo*
+    std::map<std::pair<std::uint32_t,std::uint32_t>,unsigned > m_evtMap; //(runNbr,evtNbr) -> evtIndex
     std::string m_fileName;
     std::map<unsigned,IDBSubSectionReader*> m_dbsubsects;
 
@@ -5,6 +5,7 @@
 //not have a need to use this file.
 
 #include "EvtFile/IFormat.hh"
+#include "EvtFile/Codec.hh"
 #include "Core/Types.hh"
 #include <cassert>
 #include <vector>
@@ -39,11 +40,34 @@ namespace EvtFile {
     //Register callbacks to be notified just before events are flush to disk:
     void registerPreFlushCallback(IFWPreFlushCB&);
 
+    //By default, close() appends an index of all events to the file, allowing
+    //readers random access to the events without scanning through the file
+    //header-by-header. Call this before close() (and not while in async mode)
+    //to omit the index:
+    void setWriteEventIndex(bool b) { assert(!m_async); m_writeIndex = b; }
+    bool writeEventIndex() const { return m_writeIndex; }
+
+    //Codec used for the full data section when the format has
+    //compressFullData() (default is zlib at the default level). It can be
+    //changed at any time and takes effect from the next event flushed:
+    void setCompression(const Compression& c);
+    const Compression& compression() const { return m_compression; }
+
+    //In async mode, hashing, compression and writing of each event happens in a
+    //background thread, while the calling thread moves on to the next
+    //event. Up to nbuffers events can be pending (blocking flushEventToDisk
+    //when all are in use), and their section buffers are recycled. Errors in
+    //the background thread are rethrown by the next call to flushEventToDisk
+    //or close(). Disabling async mode waits for all pending events to be
+    //written:
+    void setAsync(bool, unsigned nbuffers = 2);
+    bool isAsync() const { return m_async!=0; }
+
     //File should be open after the constructor was run unless an error
     //occured. It will also cease to be considered open after a call to close():
     bool is_open() const { return m_os.is_open(); }
 
-    bool bad() const { return m_os.bad(); }
+    bool bad() const;
 
     bool ok() const { return is_open() && !bad(); }
 
@@ -89,6 +113,19 @@ namespace EvtFile {
     std::vector<char> m_section_fulldata_compressed;
     std::vector<IFWPreFlushCB*> m_preFlushCBs;
     std::string m_filename;
+    bool m_writeIndex;
+    Compression m_compression;
+    std::uint64_t m_nbytesWritten;
+    std::vector<char> m_index;//entries of the event index footer
+    void writeEventIndex();
+    void writeEvent(int32_t runnumber, int32_t eventnumber, const Compression&,
+                    const std::vector<char>& section_database,
+                    const std::vector<char>& section_briefdata,
+                    const std::vector<char>& section_fulldata,
+                    std::vector<char>& encodebuf);
+    struct AsyncWriter;
+    AsyncWriter * m_async;
+    void endAsync();
     void write(const char*data,unsigned nbytes) { m_os.write( data, nbytes); }
     template<class T>
     void write(const T&t) { m_os.write( (char*)&t, sizeof(t)); }
@@ -0,0 +1,322 @@
+#include "EvtFile/Codec.hh"
+#include "CodecImpl.hh"
+#include "ZLibUtils/Compress.hh"
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <dlfcn.h>
+
+namespace EvtFile {
+
+  const char* codecName(std::uint32_t codec)
+  {
+    switch (codec) {
+    case CODEC_NONE: return "none";
+    case CODEC_ZLIB: return "zlib";
+    case CODEC_LZ4: return "lz4";
+    case CODEC_ZSTD: return "zstd";
+    default: return "unknown";
+    }
+  }
+
+  namespace {
+
+    //The lz4 and zstd libraries are loaded with dlopen when first needed, so
+    //they are not required at build time and files using other codecs can be
+    //read and written when they are absent. Only the few functions of their
+    //stable API which we use are declared here. Libraries are never unloaded.
+
+    void * dlopenLib(const char * basename)
+    {
+      const std::string b(basename);
+      const std::string names[] = { b+".so.1", b+".so", b+".1.dylib", b+".dylib" };
+      for (auto& n : names)
+        if (void * h = dlopen(n.c_str(),RTLD_NOW|RTLD_LOCAL))
+          return h;
+      if (const char * prefix = std::getenv("CONDA_PREFIX")) {
+        for (auto& n : names)
+          if (void * h = dlopen((std::string(prefix)+"/lib/"+n).c_str(),RTLD_NOW|RTLD_LOCAL))
+            return h;
+      }
+      return nullptr;
+    }
+
+    template <class TFct>
+    bool dlsymFct(void * handle, const char * name, TFct& fct)
+    {
+      fct = reinterpret_cast<TFct>(dlsym(handle,name));
+      return fct!=nullptr;
+    }
+
+    struct LZ4Lib {
+      int (*compressBound)(int);
+      int (*compress_default)(const char*, char*, int, int);
+      int (*compress_HC)(const char*, char*, int, int, int);
+      int (*decompress_safe)(const char*, char*, int, int);
+      bool ok;
+      LZ4Lib() : ok(false)
+      {
+        void * h = dlopenLib("liblz4");
+        ok = h && dlsymFct(h,"LZ4_compressBound",compressBound)
+          && dlsymFct(h,"LZ4_compress_default",compress_default)
+          && dlsymFct(h,"LZ4_compress_HC",compress_HC)
+          && dlsymFct(h,"LZ4_decompress_safe",decompress_safe);
+      }
+    };
+
+    struct ZSTDLib {
+      std::size_t (*compressBound)(std::size_t);
+      void* (*createCCtx)();
+      std::size_t (*freeCCtx)(void*);
+      std::size_t (*compressCCtx)(void*, void*, std::size_t, const void*, std::size_t, int);
+      void* (*createDCtx)();
+      std::size_t (*freeDCtx)(void*);
+      std::size_t (*decompressDCtx)(void*, void*, std::size_t, const void*, std::size_t);
+      unsigned (*isError)(std::size_t);
+      const char* (*getErrorName)(std::size_t);
+      bool ok;
+      ZSTDLib() : ok(false)
+      {
+        void * h = dlopenLib("libzstd");
+        ok = h && dlsymFct(h,"ZSTD_compressBound",compressBound)
+          && dlsymFct(h,"ZSTD_createCCtx",createCCtx)
+          && dlsymFct(h,"ZSTD_freeCCtx",freeCCtx)
+          && dlsymFct(h,"ZSTD_compressCCtx",compressCCtx)
+          && dlsymFct(h,"ZSTD_createDCtx",createDCtx)
+          && dlsymFct(h,"ZSTD_freeDCtx",freeDCtx)
+          && dlsymFct(h,"ZSTD_decompressDCtx",decompressDCtx)
+          && dlsymFct(h,"ZSTD_isError",isError)
+          && dlsymFct(h,"ZSTD_getErrorName",getErrorName);
+      }
+    };
+
+    //Thread-safe loading on first use:
+    const LZ4Lib& lz4Lib() { static const LZ4Lib lib; return lib; }
+    const ZSTDLib& zstdLib() { static const ZSTDLib lib; return lib; }
+
+    //Contexts are expensive to create, so each thread keeps one of each:
+    struct ZSTDContexts {
+      void * cctx = nullptr;
+      void * dctx = nullptr;
+      ~ZSTDContexts()
+      {
+        if (cctx) zstdLib().freeCCtx(cctx);
+        if (dctx) zstdLib().freeDCtx(dctx);
+      }
+    };
+    ZSTDContexts& zstdContexts() { thread_local ZSTDContexts ctxs; return ctxs; }
+
+    const int LZ4_DEFAULT_LEVEL = 1;
+    const int LZ4HC_MIN_LEVEL = 3;
+    const int ZSTD_DEFAULT_LEVEL = 3;
+  }
+
+  bool codecAvailable(std::uint32_t codec)
+  {
+    switch (codec) {
+    case CODEC_NONE: return true;
+    case CODEC_ZLIB: return true;
+    case CODEC_LZ4: return lz4Lib().ok;
+    case CODEC_ZSTD: return zstdLib().ok;
+    default: return false;
+    }
+  }
+
+  int codecMaxLevel(std::uint32_t codec)
+  {
+    switch (codec) {
+    case CODEC_ZLIB: return 9;
+    case CODEC_LZ4: return 12;
+    case CODEC_ZSTD: return 19;
+    default: return 0;
+    }
+  }
+
+  void codecCompress(const Compression& c, const char* indata, unsigned indataLength,
+                     std::vector<char>& output, unsigned& outdataLength)
+  {
+    if (c.codec==CODEC_ZLIB) {
+      ZLibUtils::compressToBuffer(indata,indataLength,output,outdataLength,c.level);
+      return;
+    }
+    const std::uint32_t n32(indataLength);
+    outdataLength = 0;
+    std::size_t nout(0);
+    if (c.codec==CODEC_LZ4) {
+      const LZ4Lib& lib = lz4Lib();
+      assert(lib.ok);
+      const int bound = lib.compressBound(static_cast<int>(indataLength));
+      output.resize(sizeof(n32)+bound);
+      const int level = (c.level==-1 ? LZ4_DEFAULT_LEVEL : c.level);
+      int res = (level>=LZ4HC_MIN_LEVEL
+                 ? lib.compress_HC(indata,&(output[sizeof(n32)]),indataLength,bound,level)
+                 : lib.compress_default(indata,&(output[sizeof(n32)]),indataLength,bound));
+      if (res<=0&&indataLength>0) {
+        printf("EvtFile ERROR: LZ4 compression failed\n");
+        throw std::runtime_error("LZ4 compression failed");
+      }
+      nout = static_cast<std::size_t>(res);
+    } else if (c.codec==CODEC_ZSTD) {
+      const ZSTDLib& lib = zstdLib();
+      assert(lib.ok);
+      ZSTDContexts& ctxs = zstdContexts();
+      if (!ctxs.cctx)
+        ctxs.cctx = lib.createCCtx();
+      const std::size_t bound = lib.compressBound(indataLength);
+      output.resize(sizeof(n32)+bound);
+      nout = lib.compressCCtx(ctxs.cctx,&(output[sizeof(n32)]),bound,indata,indataLength,
+                              c.level==-1 ? ZSTD_DEFAULT_LEVEL : c.level);
+      if (lib.isError(nout)) {
+        printf("EvtFile ERROR: zstd compression failed: %s\n",lib.getErrorName(nout));
+        throw std::runtime_error("zstd compression failed");
+      }
+    } else {
+      printf("EvtFile ERROR: Can not compress with codec \"%s\"\n",codecName(c.codec));
+      throw std::runtime_error("Unsupported compression codec");
+    }
+    std::memcpy(&(output[0]),&n32,sizeof(n32));
+    outdataLength = static_cast<unsigned>(sizeof(n32)+nout);
+  }
+
+  std::uint32_t codecUncompressedSize(const char* indata, unsigned indataLength)
+  {
+    std::uint32_t n(0);
+    if (indataLength>=sizeof(n))
+      std::memcpy(&n,indata,sizeof(n));//indata might not be aligned
+    return n;
+  }
+
+  void codecDecompress(std::uint32_t codec, const char* indata, unsigned indataLength,
+                       char* output, unsigned outdataLength)
+  {
+    if (codec==CODEC_ZLIB) {
+      ZLibUtils::decompressToRawBuffer(indata,indataLength,output,outdataLength);
+      return;
+    }
+    if (indataLength<sizeof(std::uint32_t)||codecUncompressedSize(indata,indataLength)!=outdataLength) {
+      printf("EvtFile ERROR: Unexpected size of compressed data. Data might be corrupted.\n");
+      throw std::runtime_error("Decompression failed");
+    }
+    if (outdataLength==0)
+      return;
+    const char * payload = indata + sizeof(std::uint32_t);
+    const unsigned npayload = indataLength - sizeof(std::uint32_t);
+    if (codec==CODEC_LZ4) {
+      const LZ4Lib& lib = lz4Lib();
+      assert(lib.ok);
+      int res = lib.decompress_safe(payload,output,npayload,outdataLength);
+      if (res<0||static_cast<unsigned>(res)!=outdataLength) {
+        printf("EvtFile ERROR: LZ4 decompression failed. Data might be incomplete or corrupted.\n");
+        throw std::runtime_error("LZ4 decompression failed");
+      }
+    } else if (codec==CODEC_ZSTD) {
+      const ZSTDLib& lib = zstdLib();
+      assert(lib.ok);
+      ZSTDContexts& ctxs = zstdContexts();
+      if (!ctxs.dctx)
+        ctxs.dctx = lib.createDCtx();
+      std::size_t res = lib.decompressDCtx(ctxs.dctx,output,outdataLength,payload,npayload);
+      if (lib.isError(res)||res!=outdataLength) {
+        printf("EvtFile ERROR: zstd decompression failed (%s). Data might be incomplete or corrupted.\n",
+               lib.isError(res)?lib.getErrorName(res):"unexpected size");
+        throw std::runtime_error("zstd decompression failed");
+      }
+    } else {
+      printf("EvtFile ERROR: Can not decompress data with codec \"%s\"\n",codecName(codec));
+      throw std::runtime_error("Unsupported compression codec");
+    }
+  }
+
+  namespace {
+    //Parse chunk size strings like "65536" or "64k", returning 0 if invalid:
+    unsigned parseChunkSize(const char* s)
+    {
+      unsigned long v(0);
+      for (;*s>='0'&&*s<='9';++s) {
+        v = v*10 + (*s-'0');
+        if (v>(1ul<<30))
+          return 0;
+      }
+      if (*s=='k') {
+        v *= 1024;
+        ++s;
+      }
+      return (*s=='\0'&&v<=COMPRESSION_MAX_CHUNKSIZE) ? static_cast<unsigned>(v) : 0;
+    }
+  }
+
+  Compression parseCompression(const char* s_full)
+  {
+    //Split off any chunk size:
+    std::string s_codec(s_full);
+    unsigned chunkSize(0);
+    std::string::size_type islash = s_codec.find('/');
+    if (islash!=std::string::npos) {
+      chunkSize = parseChunkSize(s_codec.c_str()+islash+1);
+      s_codec.resize(islash);
+      if (chunkSize<COMPRESSION_MIN_CHUNKSIZE||chunkSize>COMPRESSION_MAX_CHUNKSIZE) {
+        printf("EvtFile ERROR: Invalid chunk size in compression \"%s\" (must be %uk..%uk)\n",
+               s_full,COMPRESSION_MIN_CHUNKSIZE/1024,COMPRESSION_MAX_CHUNKSIZE/1024);
+        throw std::runtime_error("Invalid compression chunk size");
+      }
+    }
+    const char * s = s_codec.c_str();
+    for (std::uint32_t codec = CODEC_NONE; codec <= CODEC_ZSTD; ++codec) {
+      const char * name = codecName(codec);
+      size_t l = std::strlen(name);
+      if (std::strncmp(s,name,l)!=0)
+        continue;
+      Compression c(static_cast<Codec>(codec));
+      if (s[l]=='-' && codecMaxLevel(codec)>0) {
+        //Level must be 1..codecMaxLevel(codec) without leading zeros:
+        const char * sl = s+l+1;
+        int level(0);
+        for (;*sl>='0'&&*sl<='9'&&level<=codecMaxLevel(codec);++sl)
+          level = level*10 + (*sl-'0');
+        if (*sl!='\0'||level<1||level>codecMaxLevel(codec)||s[l+1]=='0')
+          break;
+        c.level = level;
+      } else if (s[l]!='\0') {
+        break;
+      }
+      if (!codecAvailable(codec)) {
+        printf("EvtFile ERROR: Compression codec \"%s\" is not available (the %s library could not be loaded)\n",
+               s_full,codec==CODEC_LZ4?"liblz4":"libzstd");
+        throw std::runtime_error("Unsupported compression codec");
+      }
+      if (chunkSize&&codec==CODEC_NONE) {
+        printf("EvtFile ERROR: Chunk size can not be specified without compression (\"%s\")\n",s_full);
+        throw std::runtime_error("Invalid compression chunk size");
+      }
+      c.chunkSize = chunkSize;
+      return c;
+    }
+    printf("EvtFile ERROR: Invalid compression \"%s\" (must be \"none\", \"zlib\", \"zlib-N\" with N=1..9,"
+           " \"lz4\", \"lz4-N\" with N=1..12, \"zstd\" or \"zstd-N\" with N=1..19, optionally followed"
+           " by a chunk size like \"/64k\")\n",s_full);
+    throw std::runtime_error("Invalid compression codec");
+  }
+
+  std::string compressionName(const Compression& c)
+  {
+    std::string s(codecName(c.codec));
+    if (c.level>=0) {
+      s += '-';
+      s += std::to_string(c.level);
+    }
+    if (c.chunkSize) {
+      s += '/';
+      if (c.chunkSize%1024==0) {
+        s += std::to_string(c.chunkSize/1024);
+        s += 'k';
+      } else {
+        s += std::to_string(c.chunkSize);
+      }
+    }
+    return s;
+  }
+
+}
@@ -0,0 +1,32 @@
+#ifndef EvtFile_CodecImpl_hh
+#define EvtFile_CodecImpl_hh
+
+//Compression and decompression with the codecs of Codec.hh, for use by the
+//FileWriter and FileReader. Compressed data of all codecs is framed like the
+//output of ZLibUtils::compressToBuffer, with the uncompressed size in the
+//first 4 bytes.
+
+#include "EvtFile/Codec.hh"
+#include <vector>
+
+namespace EvtFile {
+
+  //Compress indata with c.codec (not CODEC_NONE) at c.level. As with
+  //ZLibUtils::compressToBuffer, the output buffer can be recycled between calls
+  //and only outdataLength (not output.size()) holds the size of the result:
+  void codecCompress(const Compression& c, const char* indata, unsigned indataLength,
+                     std::vector<char>& output, unsigned& outdataLength);
+
+  //Uncompressed size of data from codecCompress (0 if indataLength is too
+  //short to hold it):
+  std::uint32_t codecUncompressedSize(const char* indata, unsigned indataLength);
+
+  //Decompress data from codecCompress directly into output, which must have
+  //room for exactly outdataLength bytes (throws if the data does not
+  //decompress to that size):
+  void codecDecompress(std::uint32_t codec, const char* indata, unsigned indataLength,
+                       char* output, unsigned outdataLength);
+
+}
+
+#endif
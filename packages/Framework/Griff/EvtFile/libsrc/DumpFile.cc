@@ -60,10 +60,13 @@ namespace EvtFile {
         return false;
       }
     printf("  File format version: %i\n",f.version());
+    printf("  Event index: %s\n",f.hasEventIndex()?"yes":"no");
     if (!f.eventActive()) {
       printf("  No events in file.\n");
       return true;//not an error!
     }
+    if (format->compressFullData())
+      printf("  Full data codec (first event): %s\n",codecName(f.fullDataCodec()));
 
     unsigned nevts(0);
 
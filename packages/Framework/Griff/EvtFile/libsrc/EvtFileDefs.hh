@@ -3,10 +3,30 @@
 
 //The file format version we are currently writing (the container version, not
 //the version of the contained data):
-#define EVTFILE_VERSION ((int32_t)2)
+#define EVTFILE_VERSION ((int32_t)4)
 
-//Sizes in EVTFILE__VERSION 0,1,2:
+//Sizes in EVTFILE__VERSION 0,1,2,3,4:
 #define EVTFILE_FILE_HEADER_BYTES (2*sizeof(int32_t))
 #define EVTFILE_EVENT_HEADER_BYTES (6*sizeof(std::uint32_t))
 
+//From EVTFILE_VERSION 3, files might end with an event index footer, holding
+//one entry per event (file offset followed by the 6 words of the event header),
+//and a trailer (file offset of the footer, number of events, magic word):
+#define EVTFILE_INDEX_ENTRY_BYTES (sizeof(std::uint64_t)+6*sizeof(std::uint32_t))
+#define EVTFILE_INDEX_TRAILER_BYTES (sizeof(std::uint64_t)+2*sizeof(std::uint32_t))
+#define EVTFILE_INDEX_MAGIC ((std::uint32_t)0x1de7f00e)
+
+//From EVTFILE_VERSION 4, non-empty full data sections of formats with
+//compressFullData() start with a word holding the EvtFile::Codec of the data:
+#define EVTFILE_CODEC_WORD_BYTES (sizeof(std::uint32_t))
+
+//The codec word might have this flag set in addition to the codec, in which
+//case the data was compressed in independent chunks of a fixed uncompressed
+//size. The codec word is then followed by a table of 32bit words: the chunk
+//size, the total uncompressed size, the number of chunks and the compressed
+//size of each chunk. The compressed chunks follow the table:
+#define EVTFILE_CODEC_CHUNKED ((std::uint32_t)0x100)
+#define EVTFILE_CODEC_MASK ((std::uint32_t)0xFF)
+#define EVTFILE_CHUNKTABLE_HEADER_BYTES (3*sizeof(std::uint32_t))
+
 #endif
@@ -3,11 +3,364 @@
 #include "EvtFile/FileWriter.hh"
 #include "EvtFileDefs.hh"
 #include "Utils/ProgressiveHash.hh"
-#include "ZLibUtils/Compress.hh"
+#include "Utils/ByteStream.hh"
+#include "CodecImpl.hh"
+#include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#  include <sys/vfs.h>
+#endif
 
 namespace EvtFile {
 
+  namespace {
+    bool isLocalRegularFile(const std::string& filename)
+    {
+      struct stat st;
+      if (stat(filename.c_str(),&st)!=0||!S_ISREG(st.st_mode))
+        return false;
+#ifdef __linux__
+      //Avoid mapping files on network file systems, where page faults are
+      //expensive and the file might change under our feet:
+      struct statfs sfs;
+      if (statfs(filename.c_str(),&sfs)!=0)
+        return false;
+      switch (static_cast<std::uint32_t>(sfs.f_type)) {
+      case 0x6969://NFS
+      case 0x5346414F://AFS
+      case 0x517B://SMB
+      case 0xFF534D42://CIFS
+      case 0xFE534D42://SMB2
+      case 0x65735546://FUSE
+        return false;
+      default:
+        break;
+      }
+#endif
+      return true;
+    }
+
+    //Section data is interpreted in 32bit words, so it is only handed out
+    //directly from the mapping when suitably aligned:
+    bool isWordAligned(const char * p)
+    {
+      return reinterpret_cast<std::uintptr_t>(p) % sizeof(std::uint32_t) == 0;
+    }
+
+    //Read and check the table at the start of chunked full data (following the
+    //codec word, see EVTFILE_CODEC_CHUNKED):
+    bool parseChunkTable(const char * data, unsigned n, std::uint32_t (&table)[3])
+    {
+      if (n<EVTFILE_CHUNKTABLE_HEADER_BYTES)
+        return false;
+      std::memcpy(table,data,EVTFILE_CHUNKTABLE_HEADER_BYTES);
+      if (!table[0]||table[2]!=(std::uint64_t(table[1])+table[0]-1)/table[0])
+        return false;
+      std::uint64_t ntot = EVTFILE_CHUNKTABLE_HEADER_BYTES + std::uint64_t(table[2])*sizeof(std::uint32_t);
+      if (ntot>n)
+        return false;
+      for (std::uint32_t i = 0; i < table[2]; ++i) {
+        std::uint32_t nchunk;
+        std::memcpy(&nchunk,data+EVTFILE_CHUNKTABLE_HEADER_BYTES+i*sizeof(std::uint32_t),sizeof(nchunk));
+        if (nchunk<sizeof(std::uint32_t))
+          return false;
+        ntot += nchunk;
+      }
+      return ntot==n;
+    }
+
+    //Decode an encoded full data section as found on disk, into outbuf unless
+    //the data can be used in place. Returns 0 and sets reason on errors:
+    const char * decodeFullData(int32_t version, const char * ondisk, unsigned n,
+                                std::vector<char>& outbuf, unsigned& outsize,
+                                std::uint32_t& codec, const char*& reason)
+    {
+      //Files before version 4 always used zlib and had no codec word:
+      codec = CODEC_ZLIB;
+      if (version>=4) {
+        if (n<EVTFILE_CODEC_WORD_BYTES) {
+          reason = "Full data section too short to hold codec";
+          return 0;
+        }
+        std::memcpy(&codec,ondisk,EVTFILE_CODEC_WORD_BYTES);
+        ondisk += EVTFILE_CODEC_WORD_BYTES;
+        n -= EVTFILE_CODEC_WORD_BYTES;
+      }
+      const bool chunked = (codec&EVTFILE_CODEC_CHUNKED);
+      codec &= ~EVTFILE_CODEC_CHUNKED;
+      if (codec>CODEC_ZSTD||(chunked&&codec==CODEC_NONE)) {
+        reason = "Unknown codec in full data section";
+        return 0;
+      }
+      if (!codecAvailable(codec)) {
+        reason = codec==CODEC_LZ4 ? "Codec of full data section not available (liblz4 could not be loaded)"
+          : "Codec of full data section not available (libzstd could not be loaded)";
+        return 0;
+      }
+      if (chunked) {
+        std::uint32_t table[3];//chunk size, uncompressed size, number of chunks
+        if (!parseChunkTable(ondisk,n,table)) {
+          reason = "Chunk table of full data section is corrupted";
+          return 0;
+        }
+        outsize = table[1];
+        outbuf.reserve(outsize);
+        const char * chunk = ondisk + EVTFILE_CHUNKTABLE_HEADER_BYTES + table[2]*sizeof(std::uint32_t);
+        for (std::uint32_t i = 0; i < table[2]; ++i) {
+          std::uint32_t nchunk;
+          std::memcpy(&nchunk,ondisk+EVTFILE_CHUNKTABLE_HEADER_BYTES+i*sizeof(std::uint32_t),sizeof(nchunk));
+          codecDecompress(codec,chunk,nchunk,&(outbuf[0])+i*table[0],
+                          std::min(table[0],outsize-i*table[0]));
+          chunk += nchunk;
+        }
+        return &(outbuf[0]);
+      }
+      if (codec!=CODEC_NONE) {
+        if (n<sizeof(std::uint32_t)) {
+          reason = "Full data section too short to hold compressed data";
+          return 0;
+        }
+        outsize = codecUncompressedSize(ondisk,n);
+        outbuf.reserve(outsize);
+        codecDecompress(codec,ondisk,n,outbuf.data(),outsize);
+        return outbuf.data();
+      }
+      //Uncompressed:
+      outsize = n;
+      if (isWordAligned(ondisk))
+        return ondisk;
+      outbuf.reserve(n);
+      std::memcpy(&(outbuf[0]),ondisk,n);
+      return &(outbuf[0]);
+    }
+  }
+
+  //Worker threads reading and decoding the brief and full data sections of
+  //upcoming events into per-slot buffers, ahead of the thread navigating the
+  //file. The workers never touch the navigation state of the FileReader: they
+  //read through their own file descriptor (or the mapping) and are told where
+  //the event data is when events are scheduled. If the consumer reaches an
+  //event still waiting in the queue, it simply processes it itself:
+  struct FileReader::Prefetcher {
+    struct Slot {
+      enum State { FREE, QUEUED, BUSY, READY, FAILED };
+      Slot() : state(FREE), evtIndex(0), briefPos(0), nBrief(0), nFullOnDisk(0),
+               briefdata(0), fulldata(0), fullsize(0), codec(CODEC_NONE) {}
+      State state;
+      unsigned evtIndex;
+      std::uint64_t briefPos;//full data section follows right after
+      std::uint32_t nBrief;
+      std::uint32_t nFullOnDisk;
+      std::vector<char> brief;
+      std::vector<char> raw;
+      std::vector<char> full;
+      const char * briefdata;
+      const char * fulldata;
+      unsigned fullsize;
+      std::uint32_t codec;
+    };
+
+    Prefetcher(const FileReader& fr, int fd, unsigned nthreads, unsigned depth)
+      : m_fd(fd), m_mapData(fr.m_mapData), m_mapSize(fr.m_mapSize),
+        m_version(fr.m_version), m_compressed(fr.m_fulldata_compressed),
+        m_depth(depth), m_slots(depth+1), m_stop(false)
+    {
+      assert(nthreads>0&&depth>0);
+      for (unsigned i=0;i<nthreads;++i)
+        m_threads.emplace_back(&Prefetcher::run,this);
+    }
+
+    ~Prefetcher()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_cv_work.notify_all();
+      for (auto& t : m_threads)
+        t.join();
+      if (m_fd>=0)
+        ::close(m_fd);
+    }
+
+    //Called when event idx becomes the current event. Slots of events outside
+    //the window [idx,idx+depth] are recycled and the known events in the
+    //window are queued:
+    void schedule(unsigned idx, const std::vector<EventInfo>& evts)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& slot : m_slots) {
+          if (slot.state==Slot::FREE||slot.state==Slot::BUSY)
+            continue;
+          if (slot.evtIndex>=idx&&slot.evtIndex<=idx+m_depth)
+            continue;
+          if (slot.state==Slot::QUEUED)
+            m_queue.erase(std::find(m_queue.begin(),m_queue.end(),&slot));
+          slot.state = Slot::FREE;
+        }
+        for (unsigned i=idx+1;i<=idx+m_depth&&i<evts.size();++i) {
+          Slot * freeslot = 0;
+          bool scheduled = false;
+          for (auto& slot : m_slots) {
+            if (slot.state==Slot::FREE) {
+              if (!freeslot)
+                freeslot = &slot;
+            } else if (slot.evtIndex==i) {
+              scheduled = true;
+              break;
+            }
+          }
+          if (scheduled)
+            continue;
+          if (!freeslot)
+            break;//all slots taken (some workers must still be busy with old events)
+          const EventInfo& evt = evts[i];
+          freeslot->state = Slot::QUEUED;
+          freeslot->evtIndex = i;
+          freeslot->briefPos = std::streamoff(evt.evtPosInFile) + EVTFILE_EVENT_HEADER_BYTES + evt.sectionSize_database;
+          freeslot->nBrief = evt.sectionSize_briefdata;
+          freeslot->nFullOnDisk = evt.sectionSize_fulldata;
+          m_queue.push_back(freeslot);
+        }
+      }
+      m_cv_work.notify_all();
+    }
+
+    //Returns prefetched data of event idx, waiting for it to become ready if
+    //needed. Returns 0 if the event was not scheduled or could not be
+    //prefetched:
+    const Slot * acquire(unsigned idx)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      Slot * slot = 0;
+      for (auto& s : m_slots) {
+        if (s.state!=Slot::FREE&&s.evtIndex==idx) {
+          slot = &s;
+          break;
+        }
+      }
+      if (!slot)
+        return 0;
+      if (slot->state==Slot::QUEUED) {
+        //Rather than waiting for a worker, do the job right away:
+        m_queue.erase(std::find(m_queue.begin(),m_queue.end(),slot));
+        slot->state = Slot::BUSY;
+        lock.unlock();
+        bool ok = process(*slot);
+        lock.lock();
+        slot->state = ok ? Slot::READY : Slot::FAILED;
+      }
+      m_cv_done.wait(lock,[slot]{ return slot->state!=Slot::BUSY; });
+      return slot->state==Slot::READY ? slot : 0;
+    }
+
+  private:
+    int m_fd;
+    const char * m_mapData;
+    std::uint64_t m_mapSize;
+    int32_t m_version;
+    bool m_compressed;
+    unsigned m_depth;
+    std::vector<Slot> m_slots;
+    std::deque<Slot*> m_queue;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    bool m_stop;
+
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (true) {
+        m_cv_work.wait(lock,[this]{ return m_stop || !m_queue.empty(); });
+        if (m_stop)
+          return;
+        Slot * slot = m_queue.front();
+        m_queue.pop_front();
+        slot->state = Slot::BUSY;
+        lock.unlock();
+        bool ok = process(*slot);
+        lock.lock();
+        slot->state = ok ? Slot::READY : Slot::FAILED;
+        m_cv_done.notify_all();
+      }
+    }
+
+    const char * readData(std::uint64_t pos, unsigned n, std::vector<char>& buf, bool needsAlignment)
+    {
+      if (m_mapData&&pos+n<=m_mapSize) {
+        const char * p = m_mapData + pos;
+        if (!needsAlignment||isWordAligned(p))
+          return p;
+        buf.reserve(n);
+        std::memcpy(&(buf[0]),p,n);
+        return &(buf[0]);
+      }
+      if (m_fd<0)
+        return 0;
+      buf.reserve(n);
+      char * out = &(buf[0]);
+      while (n) {
+        ssize_t nr = ::pread(m_fd,out,n,pos);
+        if (nr<=0)
+          return 0;
+        out += nr;
+        pos += nr;
+        n -= nr;
+      }
+      return &(buf[0]);
+    }
+
+    bool process(Slot& slot)
+    {
+      try {
+        return processImpl(slot);
+      } catch (std::exception&) {
+        return false;//leave it to the consumer to encounter (and report) the problem
+      }
+    }
+
+    bool processImpl(Slot& slot)
+    {
+      //Called without the lock held, only for slots in state BUSY:
+      slot.briefdata = slot.fulldata = 0;
+      slot.fullsize = 0;
+      slot.codec = CODEC_NONE;
+      if (slot.nBrief) {
+        slot.briefdata = readData(slot.briefPos,slot.nBrief,slot.brief,true);
+        if (!slot.briefdata)
+          return false;
+      }
+      if (slot.nFullOnDisk) {
+        const char * ondisk = readData(slot.briefPos+slot.nBrief,slot.nFullOnDisk,slot.raw,!m_compressed);
+        if (!ondisk)
+          return false;
+        if (m_compressed) {
+          const char * reason = 0;
+          slot.fulldata = decodeFullData(m_version,ondisk,slot.nFullOnDisk,slot.full,slot.fullsize,slot.codec,reason);
+          if (!slot.fulldata)
+            return false;
+        } else {
+          slot.fulldata = ondisk;
+          slot.fullsize = slot.nFullOnDisk;
+        }
+      }
+      return true;
+    }
+  };
+
   FileReader::FileReader( const IFormat* format,
                           const char* filename,
                           EvtFileDB* db_listener,
@@ -23,6 +376,24 @@ namespace EvtFile {
       m_fulldata_compressed(format->compressFullData()),
       m_briefdata_isloaded(false),
       m_fulldata_isloaded(false),
+      m_fulldata_ispartial(false),
+      m_fulldata_codec(CODEC_NONE),
+      m_fulldata_ondisk(0),
+      m_fulldata_chunksize(0),
+      m_fulldata_chunksleft(0),
+      m_briefdata(0),
+      m_fulldata(0),
+      m_readMode(READ_STREAM),
+      m_mapData(0),
+      m_mapSize(0),
+      m_lastAdvisedIdx(UINT_MAX),
+      m_mapSequential(false),
+      m_prefetch(0),
+      m_prefetchThreads(0),
+      m_prefetchDepth(0),
+      m_hasIndex(false),
+      m_allEvtsKnown(false),
+      m_nDBSectionsLoaded(0),
       m_currentEventInfo(0),
       m_fileName(filename)
   {
@@ -84,11 +455,192 @@ namespace EvtFile {
     m_version=fileversion;
     m_section_briefdata.reserve(4096);
     m_section_fulldata.reserve(4096);
-    m_evts.reserve(1000);
+    if (m_readMode!=READ_STREAM)
+      mapFile();
+    if (m_prefetchThreads)
+      startPrefetch();
+    if (m_version>=3&&!loadEventIndex()&&m_bad) {
+      close();
+      return false;
+    }
+    if (!m_hasIndex)
+      m_evts.reserve(1000);
     initEventAtIndex(0);
     return ok();
   }
 
+  void FileReader::setPrefetch(unsigned nthreads, unsigned depth)
+  {
+    m_prefetchThreads = nthreads;
+    m_prefetchDepth = nthreads ? (depth ? depth : 2*nthreads) : 0;
+    if (!isInit()||!is_open())
+      return;//done in init()
+    delete m_prefetch;
+    m_prefetch = 0;
+    if (m_prefetchThreads) {
+      startPrefetch();
+      if (m_prefetch&&m_currentEventInfo) {
+        unsigned idx = m_currentEventInfo->evtIndex;
+        while (!m_allEvtsKnown&&m_evts.size()<=idx+m_prefetchDepth&&scanNextEventHeader(true)) {}
+        m_currentEventInfo = &(m_evts[idx]);//vector might have grown
+        m_prefetch->schedule(idx,m_evts);
+      }
+    }
+  }
+
+  void FileReader::startPrefetch()
+  {
+    assert(!m_prefetch&&m_prefetchThreads&&m_prefetchDepth);
+    //Workers need their own file descriptor (only used with pread), unless all
+    //data is in the mapping:
+    int fd = -1;
+    if (!m_mapData) {
+      fd = ::open(m_fileName.c_str(),O_RDONLY);
+      if (fd<0)
+        return;//just read without prefetching
+    }
+    m_prefetch = new Prefetcher(*this,fd,m_prefetchThreads,m_prefetchDepth);
+  }
+
+  bool FileReader::usePrefetchedData()
+  {
+    assert(m_prefetch&&m_currentEventInfo);
+    const Prefetcher::Slot * slot = m_prefetch->acquire(m_currentEventInfo->evtIndex);
+    if (!slot)
+      return false;
+    m_briefdata = slot->nBrief ? slot->briefdata : &(m_section_briefdata[0]);
+    m_fulldata = slot->nFullOnDisk ? slot->fulldata : &(m_section_fulldata[0]);
+    m_fulldata_size = slot->fullsize;
+    m_fulldata_codec = slot->codec;
+    m_briefdata_isloaded = true;
+    m_fulldata_isloaded = true;
+    return true;
+  }
+
+  bool FileReader::loadEventIndex()
+  {
+    assert(!m_hasIndex&&m_evts.empty());
+    //Look for the trailer of an event index footer at the end of the file:
+    m_is.seekg(0,std::ios::end);
+    std::streamoff fileEnd = m_is.tellg();
+    if (m_is.fail()||fileEnd<std::streamoff(EVTFILE_FILE_HEADER_BYTES+EVTFILE_INDEX_TRAILER_BYTES)) {
+      m_is.clear();
+      return false;
+    }
+    m_is.seekg(fileEnd-std::streamoff(EVTFILE_INDEX_TRAILER_BYTES));
+    std::uint64_t indexPos;
+    std::uint32_t nevts, magic;
+    read(indexPos);
+    read(nevts);
+    read(magic);
+    static_assert(EVTFILE_INDEX_TRAILER_BYTES==sizeof(indexPos)+sizeof(nevts)+sizeof(magic));
+    if (m_is.fail()||magic!=EVTFILE_INDEX_MAGIC) {
+      //No index, most likely the writing of the file was never completed:
+      m_is.clear();
+      return false;
+    }
+    if (indexPos<EVTFILE_FILE_HEADER_BYTES
+        ||indexPos+std::uint64_t(nevts)*EVTFILE_INDEX_ENTRY_BYTES+EVTFILE_INDEX_TRAILER_BYTES!=std::uint64_t(fileEnd)) {
+      m_bad=true;
+      m_reason="Event index in file is corrupted";
+      return false;
+    }
+
+    //Read and decode the entries:
+    std::vector<char> buf(std::size_t(nevts)*EVTFILE_INDEX_ENTRY_BYTES);
+    m_is.seekg(std::streamoff(indexPos));
+    if (!buf.empty())
+      read(&(buf[0]),buf.size());
+    if (m_is.fail()) {
+      m_bad=true;
+      m_reason="Errors encountered while reading event index";
+      return false;
+    }
+    m_evts.resize(nevts);
+    const char * data = buf.empty() ? 0 : &(buf[0]);
+    std::uint64_t expectedPos = EVTFILE_FILE_HEADER_BYTES;
+    for (unsigned i=0;i<nevts;++i) {
+      EventInfo& evt = m_evts[i];
+      std::uint64_t pos;
+      ByteStream::read(data,pos);
+      ByteStream::read(data,evt.checkSum);
+      ByteStream::read(data,evt.runNumber);
+      ByteStream::read(data,evt.evtNumber);
+      ByteStream::read(data,evt.sectionSize_database);
+      ByteStream::read(data,evt.sectionSize_briefdata);
+      ByteStream::read(data,evt.sectionSize_fulldata);
+      static_assert(EVTFILE_INDEX_ENTRY_BYTES==sizeof(std::uint64_t)+6*sizeof(std::uint32_t));
+      //Events are stored back-to-back, so the index is easily sanity checked:
+      if (pos!=expectedPos) {
+        m_evts.clear();
+        m_bad=true;
+        m_reason="Event index in file is inconsistent with event data";
+        return false;
+      }
+      expectedPos += EVTFILE_EVENT_HEADER_BYTES;
+      expectedPos += evt.sectionSize_database;
+      expectedPos += evt.sectionSize_briefdata;
+      expectedPos += evt.sectionSize_fulldata;
+      evt.evtPosInFile = std::streamoff(pos);
+      evt.evtIndex = i;
+      evt.dummy = 0;
+    }
+    if (expectedPos!=indexPos) {
+      m_evts.clear();
+      m_bad=true;
+      m_reason="Event index in file is inconsistent with event data";
+      return false;
+    }
+    m_hasIndex = true;
+    m_allEvtsKnown = true;
+    return true;
+  }
+
+  bool FileReader::loadDBSectionsUpTo(unsigned idx)
+  {
+    //When events have been skipped by use of the index, their database
+    //sections must still be passed on (in order) before accessing event idx:
+    assert(idx<m_evts.size());
+    assert(!m_briefdata_isloaded);
+    for (;m_nDBSectionsLoaded<=idx;++m_nDBSectionsLoaded) {
+      const EventInfo& evt = m_evts[m_nDBSectionsLoaded];
+      if (!m_db_listener||!evt.sectionSize_database)
+        continue;
+      std::streampos pos = evt.evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES);
+      const char * data = mappedData(pos,evt.sectionSize_database);
+      if (!data) {
+        //For economical reasons we temporarily use the m_section_briefdata for this.
+        clearEOF();
+        m_is.seekg(pos);
+        m_section_briefdata.reserve(evt.sectionSize_database);
+        read(&(m_section_briefdata[0]),evt.sectionSize_database);
+        if (m_is.fail()) {
+          m_bad=true;
+          m_reason="Errors encountered while reading database section of event";
+          return false;
+        }
+        data = &(m_section_briefdata[0]);
+      }
+      m_db_listener->newInfoAvailable(data,evt.sectionSize_database);
+    }
+    return true;
+  }
+
+  unsigned FileReader::nEvents()
+  {
+    assert(isInit());
+    if (!m_allEvtsKnown&&!m_bad&&!m_evts.empty()) {
+      //No index, so we must scan through the remaining event headers and
+      //afterwards return to the current event:
+      unsigned idx = m_currentEventInfo ? m_currentEventInfo->evtIndex : UINT_MAX;
+      while (!m_allEvtsKnown&&!m_bad)
+        initEventAtIndex(m_evts.size());
+      if (idx!=UINT_MAX&&!m_bad)
+        initEventAtIndex(idx);
+    }
+    return m_evts.size();
+  }
+
   FileReader::~FileReader()
   {
     if (m_db_listener)
@@ -99,11 +651,81 @@ namespace EvtFile {
 
   void FileReader::close()
   {
+    delete m_prefetch;//must stop before the mapping goes away
+    m_prefetch = 0;
+    unmapFile();
     m_is.close();
     delete[] m_buf;
     m_buf = 0;
   }
 
+  void FileReader::mapFile()
+  {
+    assert(!m_mapData);
+    if (m_readMode==READ_AUTO&&!isLocalRegularFile(m_fileName))
+      return;
+    int fd = ::open(m_fileName.c_str(),O_RDONLY);
+    if (fd<0)
+      return;
+    struct stat st;
+    if (fstat(fd,&st)!=0||!S_ISREG(st.st_mode)||st.st_size<=0) {
+      ::close(fd);
+      return;
+    }
+    void * p = mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    ::close(fd);//the mapping stays valid
+    if (p==MAP_FAILED)
+      return;
+    m_mapData = static_cast<const char*>(p);
+    m_mapSize = st.st_size;
+  }
+
+  void FileReader::unmapFile()
+  {
+    if (!m_mapData)
+      return;
+    munmap(const_cast<char*>(m_mapData),m_mapSize);
+    m_mapData = 0;
+    m_mapSize = 0;
+  }
+
+  const char * FileReader::mappedData(std::streampos pos, std::uint64_t nbytes) const
+  {
+    //Returns 0 if not mapped, or if the data lies beyond the mapped region
+    //(possible if the file grew after it was opened):
+    std::uint64_t p = std::streamoff(pos);
+    return m_mapData && p+nbytes<=m_mapSize ? m_mapData + p : 0;
+  }
+
+  void FileReader::adviseAccess(unsigned idx)
+  {
+    //Keep the kernel read-ahead in line with the navigation pattern: sequential
+    //while events are visited in order (as in loopEvents()), normal otherwise.
+    assert(m_mapData&&idx<m_evts.size());
+    bool sequential = (idx==m_lastAdvisedIdx+1);
+    m_lastAdvisedIdx = idx;
+    if (sequential!=m_mapSequential) {
+      madvise(const_cast<char*>(m_mapData),m_mapSize,sequential?MADV_SEQUENTIAL:MADV_NORMAL);
+      m_mapSequential = sequential;
+    }
+    //Ask for the pages of the current event when jumping around, or for those
+    //of the next event when looping (guessing its size if not yet known):
+    const EventInfo& evt = m_evts[std::min<std::size_t>(sequential?idx+1:idx,m_evts.size()-1)];
+    std::uint64_t evtsize = EVTFILE_EVENT_HEADER_BYTES;
+    evtsize += evt.sectionSize_database;
+    evtsize += evt.sectionSize_briefdata;
+    evtsize += evt.sectionSize_fulldata;
+    std::uint64_t begin = std::streamoff(evt.evtPosInFile);
+    if (sequential&&idx+1==m_evts.size())
+      begin += evtsize;
+    std::uint64_t end = std::min<std::uint64_t>(begin+evtsize,m_mapSize);
+    if (begin>=end)
+      return;
+    static const std::uint64_t pagesize = sysconf(_SC_PAGESIZE);
+    begin -= begin % pagesize;
+    madvise(const_cast<char*>(m_mapData+begin),end-begin,MADV_WILLNEED);
+  }
+
   bool FileReader::skipEvents(int n)
   {
     assert(isInit());
@@ -124,9 +746,13 @@ namespace EvtFile {
 
     unsigned targetidx=idx+n;
     if (targetidx<m_evts.size()) {
-      initEventAtIndex(targetidx);//Already read it, jump directly there
+      initEventAtIndex(targetidx);//Already read it (or have it in the index), jump directly there
       return m_currentEventInfo!=0;
     }
+    if (m_allEvtsKnown) {
+      initEventAtIndex(m_evts.size());//no such event
+      return false;
+    }
 
     //Ok, targetidx lies beyond the events already read. Jump to the first
     //unread event and step forward from there.
@@ -148,12 +774,13 @@ namespace EvtFile {
 
     if (idx<m_evts.size()) {
       clearEOF();
-      m_currentEventInfo=&(m_evts[idx]);
-      m_briefdata_isloaded = false;
-      m_fulldata_isloaded = false;
-      return true;//we previously read the event so can jump right to it
+      initEventAtIndex(idx);//we previously read the event (or have it in the index) so can jump right to it
+      return m_currentEventInfo!=0;
     }
 
+    if (m_allEvtsKnown)
+      return false;
+
     //We are left with no current event and the target index must be in some unread event if anywhere:
     if (!seekEventByIndex(m_evts.size()-1))
       return false;
@@ -177,73 +804,86 @@ namespace EvtFile {
     m_currentEventInfo=0;
     m_briefdata_isloaded = false;
     m_fulldata_isloaded = false;
+    m_fulldata_ispartial = false;
 
     assert(idx<=m_evts.size());
-    if (idx==m_evts.size()) {
-      //Read the next event!
-      assert(!m_bad);
-      std::streampos newEvtPos;
-      if (idx!=0) {
-        //Seek to end of last read event in file:
-        EventInfo& lastEvt = m_evts.back();
-        newEvtPos = lastEvt.evtPosInFile;
-        newEvtPos +=EVTFILE_EVENT_HEADER_BYTES;
-        static_assert(EVTFILE_EVENT_HEADER_BYTES==6*sizeof(std::uint32_t));
-        newEvtPos+=lastEvt.sectionSize_database;
-        newEvtPos+=lastEvt.sectionSize_briefdata;
-        newEvtPos+=lastEvt.sectionSize_fulldata;
-      } else {
-        //We got called from our own constructor so we are already here
-        newEvtPos =m_is.tellg();
-      }
-      clearEOF();
+    if (idx==m_evts.size()&&(m_allEvtsKnown||!scanNextEventHeader(false)))
+      return;//no more events in file (or errors)
+
+    if (m_prefetch) {
+      //Upcoming events must be known before they can be prefetched:
+      while (!m_allEvtsKnown&&m_evts.size()<=idx+m_prefetchDepth&&scanNextEventHeader(true)) {}
+    }
+
+    //Database sections of the event and any events skipped on the way must be
+    //passed on (in order) before accessing the event:
+    if (idx>=m_nDBSectionsLoaded&&!loadDBSectionsUpTo(idx))
+      return;
+    m_currentEventInfo=&(m_evts[idx]);
+    if (m_mapData)
+      adviseAccess(idx);
+    if (m_prefetch)
+      m_prefetch->schedule(idx,m_evts);
+  }
+
+  bool FileReader::scanNextEventHeader(bool lookahead)
+  {
+    //Read the header of the first event not yet in m_evts and append it. At
+    //the end of the file, m_allEvtsKnown is set. Problems are only flagged when
+    //not looking ahead, since in that case they will be encountered (and
+    //reported) when navigating to the event.
+    assert(!m_allEvtsKnown&&!m_bad);
+    std::streampos newEvtPos;
+    if (!m_evts.empty()) {
+      //Seek to end of last read event in file:
+      EventInfo& lastEvt = m_evts.back();
+      newEvtPos = lastEvt.evtPosInFile;
+      newEvtPos +=EVTFILE_EVENT_HEADER_BYTES;
+      static_assert(EVTFILE_EVENT_HEADER_BYTES==6*sizeof(std::uint32_t));
+      newEvtPos+=lastEvt.sectionSize_database;
+      newEvtPos+=lastEvt.sectionSize_briefdata;
+      newEvtPos+=lastEvt.sectionSize_fulldata;
+    } else {
+      //First event follows the file header:
+      newEvtPos = std::streampos(EVTFILE_FILE_HEADER_BYTES);
+    }
+    clearEOF();
+    std::uint32_t header[6];
+    static_assert(EVTFILE_EVENT_HEADER_BYTES==sizeof(header));//make sure we are consistent with EvtFileDefs.hh
+    const char * mappedHeader = mappedData(newEvtPos,EVTFILE_EVENT_HEADER_BYTES);
+    if (mappedHeader) {
+      std::memcpy(header,mappedHeader,EVTFILE_EVENT_HEADER_BYTES);
+    } else {
       m_is.seekg(newEvtPos);
       m_is.peek();//always peek before checking eof!
       if (m_is.eof()) {
         //This is not an error condition - we simply reached the end of the file.
-        return;
+        m_allEvtsKnown = true;
+        return false;
       }
+      if (!m_is.fail())
+        read(reinterpret_cast<char*>(header),EVTFILE_EVENT_HEADER_BYTES);
       if (m_is.fail()) {
+        if (lookahead) {
+          m_is.clear();
+          return false;
+        }
         m_bad=true;
-        m_reason="Error while seeking to next event";
-        return;
-      }
-      if (m_evts.capacity()==m_evts.size())
-        m_evts.reserve(m_evts.size()*2);
-      m_evts.resize(m_evts.size()+1);
-      EventInfo& newEvt = m_evts.back();
-      newEvt.evtPosInFile = newEvtPos;
-      newEvt.evtIndex = m_evts.size()-1;
-      read(reinterpret_cast<char*>(&newEvt.checkSum),sizeof(std::uint32_t)*6);//Trick to read all 6 variables with one call
-      static_assert(sizeof(EventInfo)==sizeof(std::uint32_t)*8+sizeof(std::streampos));//make sure there is no padding => our trick would fail
-      static_assert(EVTFILE_EVENT_HEADER_BYTES==sizeof(std::uint32_t)*6);//make sure we are consistent with EvtFileDefs.hh
-      if (m_is.fail()) {
-        m_bad=true;
-        m_evts.resize(m_evts.size()-1);
         m_reason="Errors encountered while reading event header";
-        return;
+        return false;
       }
-      m_currentEventInfo=&newEvt;
-      if (m_db_listener && newEvt.sectionSize_database) {
-        //Read the database info and pass it on to any derived class.
-        //For economical reasons we temporarily use the m_section_briefdata for this.
-        assert(!m_briefdata_isloaded);
-        m_section_briefdata.reserve(newEvt.sectionSize_database);
-        read(&(m_section_briefdata[0]),newEvt.sectionSize_database);
-        if (m_is.fail()) {
-          m_bad=true;
-          m_evts.resize(m_evts.size()-1);
-          m_reason="Errors encountered while reading database section of event";
-          return;
-        }
-        m_db_listener->newInfoAvailable(&(m_section_briefdata[0]),newEvt.sectionSize_database);
-      }
-      //All ok it seems:
-      m_currentEventInfo=&newEvt;
-    } else {
-      //Event has been read previously:
-      m_currentEventInfo=&(m_evts[idx]);
     }
+    if (m_evts.capacity()==m_evts.size())
+      m_evts.reserve(m_evts.size()*2);
+    m_evts.resize(m_evts.size()+1);
+    EventInfo& newEvt = m_evts.back();
+    newEvt.evtPosInFile = newEvtPos;
+    newEvt.evtIndex = m_evts.size()-1;
+    newEvt.dummy = 0;
+    //Trick to fill all 6 variables with one call:
+    std::memcpy(reinterpret_cast<char*>(&newEvt.checkSum),header,EVTFILE_EVENT_HEADER_BYTES);
+    static_assert(sizeof(EventInfo)==sizeof(std::uint32_t)*8+sizeof(std::streampos));//make sure there is no padding => our trick would fail
+    return true;
   }
 
   bool FileReader::goToEvent(std::uint32_t run_number,std::uint32_t evt_number)
@@ -256,18 +896,20 @@ namespace EvtFile {
     m_currentEventInfo=0;
     m_briefdata_isloaded = false;
     m_fulldata_isloaded = false;
+    m_fulldata_ispartial = false;
 
     if (m_evtMap.size()<m_evts.size()) {
-      //update m_evtMap
+      //update m_evtMap (with an index, this covers all events in the file)
       for (unsigned i=m_evtMap.size();i<m_evts.size();++i) {
-        m_evtMap[std::make_pair(m_evts[i].runNumber,m_evts[i].evtNumber)]=&m_evts[i];
+        m_evtMap[std::make_pair(m_evts[i].runNumber,m_evts[i].evtNumber)]=i;
       }
       assert(m_evtMap.size()==m_evts.size() && "Error: (runNbr,evtNbr) was not unique in file!");
     }
     auto it = m_evtMap.find(std::make_pair(run_number,evt_number));
     if (it!=m_evtMap.end()) {
-      m_currentEventInfo=it->second;
-      return true;
+      clearEOF();
+      initEventAtIndex(it->second);
+      return m_currentEventInfo!=0;
     }
     return false;
   }
@@ -279,8 +921,14 @@ namespace EvtFile {
     if (!m_currentEventInfo->sectionSize_database)
       return;
 
-    m_is.seekg(m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
-    assert(m_is.tellg()==m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
+    std::streampos pos = m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES);
+    const char * mapped = mappedData(pos,m_currentEventInfo->sectionSize_database);
+    if (mapped) {
+      std::memcpy(&data[0],mapped,m_currentEventInfo->sectionSize_database);
+      return;
+    }
+    m_is.seekg(pos);
+    assert(m_is.tellg()==pos);
     char * tmp = &data[0];
     assert(tmp);
     read(tmp,m_currentEventInfo->sectionSize_database);
@@ -290,70 +938,194 @@ namespace EvtFile {
   const char* FileReader::getBriefData() {
     assert(isInit());
     if (m_briefdata_isloaded)
-      return &(m_section_briefdata[0]);
+      return m_briefdata;
     assert(eventActive() && "getBriefData() called when not eventActive()");
+    if (m_prefetch&&usePrefetchedData())
+      return m_briefdata;
     unsigned n(nBytesBriefData());
+    m_briefdata = &(m_section_briefdata[0]);
     if (n) {
-      m_section_briefdata.reserve(nBytesBriefData());
       std::streampos pos = m_currentEventInfo->evtPosInFile;
       pos+=EVTFILE_EVENT_HEADER_BYTES;
       pos+=m_currentEventInfo->sectionSize_database;
+      const char * mapped = mappedData(pos,n);
+      if (mapped&&isWordAligned(mapped)) {
+        //zero-copy:
+        m_briefdata = mapped;
+      } else {
+        m_section_briefdata.reserve(n);
+        m_briefdata = &(m_section_briefdata[0]);
+        m_is.seekg(pos);
+        if (m_is.fail()) {
+          m_bad=true;
+          return 0;
+        }
+        read(&(m_section_briefdata[0]),n);
+        if (m_is.fail()) {
+          m_bad=true;
+          return 0;
+        }
+      }
+    }
+    m_briefdata_isloaded=true;
+    return m_briefdata;
+  }
+
+  const char* FileReader::readFullDataOnDisk()
+  {
+    //Access the full data section as found on disk, reading it in if needed:
+    unsigned n(nBytesFullDataOnDisk());
+    assert(n);
+    std::streampos pos = m_currentEventInfo->evtPosInFile;
+    pos+=EVTFILE_EVENT_HEADER_BYTES;
+    pos+=m_currentEventInfo->sectionSize_database;
+    pos+=m_currentEventInfo->sectionSize_briefdata;
+    //With a memory mapped file, compressed data is inflated directly from
+    //the mapping, and uncompressed data is not copied at all:
+    const char * ondisk = mappedData(pos,n);
+    if (ondisk&&!m_fulldata_compressed&&!isWordAligned(ondisk))
+      ondisk = 0;//needs copy for aligned word access
+    if (!ondisk) {
+      //read (compressed) data:
+      std::vector<char>& buf = m_fulldata_compressed ? m_section_fulldata_compressed : m_section_fulldata;
+      buf.reserve(n);
       m_is.seekg(pos);
       if (m_is.fail()) {
         m_bad=true;
         return 0;
       }
-      read(&(m_section_briefdata[0]),n);
+      read(&(buf[0]),n);
       if (m_is.fail()) {
         m_bad=true;
         return 0;
       }
+      ondisk = &(buf[0]);
     }
-    m_briefdata_isloaded=true;
-    return &(m_section_briefdata[0]);
+    return ondisk;
+  }
+
+  bool FileReader::decodeFullDataOnDisk(const char * ondisk)
+  {
+    unsigned n(nBytesFullDataOnDisk());
+    if (m_fulldata_compressed) {
+      const char * reason = 0;
+      m_fulldata = decodeFullData(m_version,ondisk,n,m_section_fulldata,m_fulldata_size,m_fulldata_codec,reason);
+      if (!m_fulldata) {
+        m_bad=true;
+        m_reason=reason;
+        return false;
+      }
+    } else {
+      m_fulldata = ondisk;
+      m_fulldata_size = n;
+    }
+    m_fulldata_isloaded=true;
+    return true;
   }
 
   const char* FileReader::getFullData() {
     assert(isInit());
 
     if (m_fulldata_isloaded)
-      return &(m_section_fulldata[0]);
+      return m_fulldata;
 
     assert(eventActive() && "getFullData() called when not eventActive()");
 
-    unsigned n(nBytesFullDataOnDisk());
-    m_fulldata_size = n;
-    if (n) {
-      //read compressed data:
-      if (m_fulldata_compressed)
-        m_section_fulldata_compressed.reserve(n);
-      else
-        m_section_fulldata.reserve(n);
-      std::streampos pos = m_currentEventInfo->evtPosInFile;
-      pos+=EVTFILE_EVENT_HEADER_BYTES;
-      pos+=m_currentEventInfo->sectionSize_database;
-      pos+=m_currentEventInfo->sectionSize_briefdata;
-      m_is.seekg(pos);
-      if (m_is.fail()) {
-        m_bad=true;
+    if (m_fulldata_ispartial) {
+      inflateChunks(0,m_fulldata_size);
+      assert(m_fulldata_isloaded);
+      return m_fulldata;
+    }
+
+    if (m_prefetch&&usePrefetchedData())
+      return m_fulldata;
+
+    m_fulldata_size = 0;
+    m_fulldata = &(m_section_fulldata[0]);
+    m_fulldata_codec = CODEC_NONE;
+    if (nBytesFullDataOnDisk()) {
+      const char * ondisk = readFullDataOnDisk();
+      if (!ondisk||!decodeFullDataOnDisk(ondisk))
         return 0;
-      }
-      if (m_fulldata_compressed)
-        read(&(m_section_fulldata_compressed[0]),n);
-      else
-        read(&(m_section_fulldata[0]),n);
-      if (m_is.fail()) {
+    }
+    m_fulldata_isloaded=true;
+    return m_fulldata;
+  }
+
+  const char* FileReader::getFullData(unsigned offset, unsigned nbytes) {
+    assert(isInit());
+
+    if (!m_fulldata_isloaded&&!m_fulldata_ispartial) {
+      assert(eventActive() && "getFullData() called when not eventActive()");
+      unsigned n(nBytesFullDataOnDisk());
+      if (m_prefetch&&usePrefetchedData())
+        return m_fulldata + offset;
+      if (!m_fulldata_compressed||m_version<4||n<=EVTFILE_CODEC_WORD_BYTES)
+        return getFullData() ? m_fulldata + offset : 0;//nothing to gain from partial decoding
+      const char * ondisk = readFullDataOnDisk();
+      if (!ondisk)
+        return 0;
+      std::uint32_t codecword;
+      std::memcpy(&codecword,ondisk,EVTFILE_CODEC_WORD_BYTES);
+      const std::uint32_t codec = codecword&~EVTFILE_CODEC_CHUNKED;
+      if (!(codecword&EVTFILE_CODEC_CHUNKED)||codec==CODEC_NONE||codec>CODEC_ZSTD||!codecAvailable(codec))
+        return decodeFullDataOnDisk(ondisk) ? m_fulldata + offset : 0;//also sets any error
+      //Chunked data, set up for inflating chunks as needed:
+      ondisk += EVTFILE_CODEC_WORD_BYTES;
+      n -= EVTFILE_CODEC_WORD_BYTES;
+      std::uint32_t table[3];//chunk size, uncompressed size, number of chunks
+      if (!parseChunkTable(ondisk,n,table)) {
         m_bad=true;
+        m_reason="Chunk table of full data section is corrupted";
         return 0;
       }
-      if (m_fulldata_compressed) {
-        //uncompress:
-        assert(n>sizeof(std::uint32_t));
-        ZLibUtils::decompressToBuffer(&(m_section_fulldata_compressed[0]), n, m_section_fulldata,m_fulldata_size);
+      m_fulldata_codec = codec;
+      m_fulldata_ondisk = ondisk;
+      m_fulldata_chunksize = table[0];
+      m_fulldata_size = table[1];
+      m_section_fulldata.reserve(m_fulldata_size);
+      m_fulldata = &(m_section_fulldata[0]);
+      m_fulldata_chunkpos.resize(table[2]+1);
+      m_fulldata_chunkpos[0] = EVTFILE_CHUNKTABLE_HEADER_BYTES + table[2]*sizeof(std::uint32_t);
+      for (std::uint32_t i = 0; i < table[2]; ++i) {
+        std::uint32_t nchunk;
+        std::memcpy(&nchunk,ondisk+EVTFILE_CHUNKTABLE_HEADER_BYTES+i*sizeof(std::uint32_t),sizeof(nchunk));
+        m_fulldata_chunkpos[i+1] = m_fulldata_chunkpos[i] + nchunk;
+      }
+      m_fulldata_chunkdone.assign(table[2],false);
+      m_fulldata_chunksleft = table[2];
+      if (m_fulldata_chunksleft)
+        m_fulldata_ispartial = true;
+      else
+        m_fulldata_isloaded = true;
+    }
+
+    assert(std::uint64_t(offset)+nbytes<=m_fulldata_size);
+    if (m_fulldata_ispartial)
+      inflateChunks(offset,nbytes);
+    return m_fulldata + offset;
+  }
+
+  void FileReader::inflateChunks(unsigned offset, unsigned nbytes)
+  {
+    assert(m_fulldata_ispartial&&std::uint64_t(offset)+nbytes<=m_fulldata_size);
+    if (!nbytes)
+      return;
+    const unsigned cs = m_fulldata_chunksize;
+    const unsigned iend = (offset+nbytes-1)/cs + 1;
+    char * out = &(m_section_fulldata[0]);
+    for (unsigned i = offset/cs; i < iend; ++i) {
+      if (m_fulldata_chunkdone[i])
+        continue;
+      codecDecompress(m_fulldata_codec,m_fulldata_ondisk + m_fulldata_chunkpos[i],
+                      m_fulldata_chunkpos[i+1]-m_fulldata_chunkpos[i],
+                      out+i*cs,std::min(cs,m_fulldata_size-i*cs));
+      m_fulldata_chunkdone[i] = true;
+      if (!--m_fulldata_chunksleft) {
+        m_fulldata_ispartial = false;
+        m_fulldata_isloaded = true;
       }
     }
-    m_fulldata_isloaded=true;
-    return &(m_section_fulldata[0]);
   }
 
   bool FileReader::verifyEventDataIntegrity()
@@ -367,7 +1139,11 @@ namespace EvtFile {
     ProgressiveHash hash;
     hash.addData(reinterpret_cast<char*>(&(m_currentEventInfo->runNumber)),5*sizeof(std::uint32_t));
 
-    if (m_currentEventInfo->sectionSize_database>0) {
+    const char * mappedDB = m_currentEventInfo->sectionSize_database>0
+      ? mappedData(m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES),m_currentEventInfo->sectionSize_database) : 0;
+    if (mappedDB) {
+      hash.addData(mappedDB,m_currentEventInfo->sectionSize_database);
+    } else if (m_currentEventInfo->sectionSize_database>0) {
       m_is.seekg(m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
       assert(m_is.tellg()==m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
       char * tmp = new char[m_currentEventInfo->sectionSize_database];//we could cache this, but normally we don't verify integrity...
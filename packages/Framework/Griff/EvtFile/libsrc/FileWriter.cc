@@ -2,17 +2,177 @@
 #include "Core/String.hh"
 #include "EvtFileDefs.hh"
 #include "Utils/ProgressiveHash.hh"
-#include "ZLibUtils/Compress.hh"
+#include "CodecImpl.hh"
 #include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include <cstring>
 
 namespace EvtFile {
 
+  namespace {
+    //Compress data in independent chunks of compression.chunkSize bytes,
+    //preceded by the chunk table (see EVTFILE_CODEC_CHUNKED):
+    void compressChunked(const std::vector<char>& indata, const Compression& compression,
+                         std::vector<char>& output, unsigned& outdataLength)
+    {
+      assert(compression.chunkSize>0&&!indata.empty());
+      const unsigned n = indata.size();
+      const unsigned cs = compression.chunkSize;
+      std::uint32_t table[3] = { cs, n, (n+cs-1)/cs };
+      static_assert(EVTFILE_CHUNKTABLE_HEADER_BYTES==sizeof(table));
+      output.clear();
+      output.resize(EVTFILE_CHUNKTABLE_HEADER_BYTES+table[2]*sizeof(std::uint32_t));
+      std::memcpy(&(output[0]),table,sizeof(table));
+      std::vector<char> chunkbuf;
+      for (std::uint32_t i = 0; i < table[2]; ++i) {
+        unsigned nchunk;
+        codecCompress(compression,&(indata[i*cs]),std::min(cs,n-i*cs),chunkbuf,nchunk);
+        std::uint32_t nchunk32(nchunk);
+        std::memcpy(&(output[EVTFILE_CHUNKTABLE_HEADER_BYTES+i*sizeof(std::uint32_t)]),&nchunk32,sizeof(nchunk32));
+        output.insert(output.end(),&(chunkbuf[0]),&(chunkbuf[0])+nchunk);
+      }
+      outdataLength = output.size();
+    }
+  }
+
+  //Background thread which hashes, encodes and writes out events in the order
+  //they are submitted. Section buffers are swapped rather than copied between
+  //the caller and the thread, and are recycled through a fixed number of slots,
+  //which puts a bound on both the memory usage and on how far the writing can
+  //lag behind:
+  struct FileWriter::AsyncWriter {
+    struct Slot {
+      int32_t runnumber;
+      int32_t eventnumber;
+      Compression compression;
+      std::vector<char> database;
+      std::vector<char> briefdata;
+      std::vector<char> fulldata;
+      std::vector<char> encodebuf;
+    };
+
+    AsyncWriter(FileWriter& fw, unsigned nslots)
+      : m_fw(fw), m_stop(false), m_failed(false)
+    {
+      assert(nslots>0);
+      m_slots.resize(nslots);
+      for (auto& slot : m_slots) {
+        slot.reset(new Slot);
+        m_free.push_back(slot.get());
+      }
+      m_thread = std::thread(&AsyncWriter::run,this);
+    }
+
+    ~AsyncWriter() { finish(); }
+
+    void submit(int32_t runnumber, int32_t eventnumber, const Compression& compression,
+                std::vector<char>& database, std::vector<char>& briefdata, std::vector<char>& fulldata)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv_free.wait(lock,[this]{ return !m_free.empty(); });
+      Slot * slot = m_free.back();
+      m_free.pop_back();
+      lock.unlock();
+      slot->runnumber = runnumber;
+      slot->eventnumber = eventnumber;
+      slot->compression = compression;
+      slot->database.swap(database);
+      slot->briefdata.swap(briefdata);
+      slot->fulldata.swap(fulldata);
+      lock.lock();
+      m_pending.push_back(slot);
+      lock.unlock();
+      m_cv_work.notify_one();
+    }
+
+    //Wait for the thread to write all pending events and end it:
+    void finish()
+    {
+      if (!m_thread.joinable())
+        return;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_cv_work.notify_one();
+      m_thread.join();
+    }
+
+    bool failed() const { return m_failed; }
+
+    //Rethrow the error encountered by the thread, if any:
+    void rethrowError()
+    {
+      if (!m_failed)
+        return;
+      std::exception_ptr e;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        e = m_error;
+      }
+      std::rethrow_exception(e);
+    }
+
+  private:
+    FileWriter& m_fw;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::vector<Slot*> m_free;
+    std::deque<Slot*> m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_free;
+    bool m_stop;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_error;
+    std::thread m_thread;
+
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (true) {
+        m_cv_work.wait(lock,[this]{ return m_stop || !m_pending.empty(); });
+        if (m_pending.empty())
+          return;//stopped and drained
+        Slot * slot = m_pending.front();
+        m_pending.pop_front();
+        lock.unlock();
+        if (!m_failed) {
+          try {
+            m_fw.writeEvent(slot->runnumber,slot->eventnumber,slot->compression,
+                            slot->database,slot->briefdata,slot->fulldata,slot->encodebuf);
+          } catch (...) {
+            //Events after a failure are discarded, since the file is corrupted anyway:
+            std::lock_guard<std::mutex> elock(m_mutex);
+            m_error = std::current_exception();
+            m_failed = true;
+          }
+        }
+        slot->database.clear();
+        slot->briefdata.clear();
+        slot->fulldata.clear();
+        lock.lock();
+        m_free.push_back(slot);
+        m_cv_free.notify_one();
+      }
+    }
+  };
+
   FileWriter::FileWriter( const IFormat* format,
                           const char* filename,
                           int buffer_len )
     : m_format(format),
       m_buf(buffer_len ? new char[buffer_len] : 0),
-      m_filename(filename)
+      m_filename(filename),
+      m_writeIndex(true),
+      m_nbytesWritten(0),
+      m_async(0)
   {
     m_os.rdbuf()->pubsetbuf(m_buf, buffer_len );
 
@@ -23,6 +183,7 @@ namespace EvtFile {
 
     write(format->magicWord());
     write(EVTFILE_VERSION);
+    m_nbytesWritten = EVTFILE_FILE_HEADER_BYTES;
 
     m_section_database.reserve(4096);
     m_section_briefdata.reserve(4096);
@@ -30,20 +191,109 @@ namespace EvtFile {
 
   }
 
+  void FileWriter::setCompression(const Compression& c)
+  {
+    if (!codecAvailable(c.codec)) {
+      printf("EvtFile ERROR: Compression codec \"%s\" is not available (library could not be loaded)\n",codecName(c.codec));
+      throw std::runtime_error("Unsupported compression codec");
+    }
+    if (c.level!=-1&&(c.level<1||c.level>codecMaxLevel(c.codec))) {
+      printf("EvtFile ERROR: Invalid level %i for compression codec \"%s\"\n",c.level,codecName(c.codec));
+      throw std::runtime_error("Invalid compression level");
+    }
+    if (c.chunkSize&&(c.codec==CODEC_NONE||c.chunkSize<COMPRESSION_MIN_CHUNKSIZE||c.chunkSize>COMPRESSION_MAX_CHUNKSIZE)) {
+      printf("EvtFile ERROR: Invalid chunk size %u for compression codec \"%s\"\n",c.chunkSize,codecName(c.codec));
+      throw std::runtime_error("Invalid compression chunk size");
+    }
+    m_compression = c;
+  }
+
+  void FileWriter::setAsync(bool b, unsigned nbuffers)
+  {
+    if (b==(m_async!=0))
+      return;
+    if (b) {
+      assert(nbuffers>0);
+      assert(is_open() && "Attempt to enable async mode for a file which is not open");
+      m_async = new AsyncWriter(*this,nbuffers);
+    } else {
+      endAsync();
+    }
+  }
+
+  void FileWriter::endAsync()
+  {
+    if (!m_async)
+      return;
+    m_async->finish();
+    AsyncWriter * a = m_async;
+    m_async = 0;
+    std::unique_ptr<AsyncWriter> guard(a);
+    a->rethrowError();
+  }
+
+  bool FileWriter::bad() const
+  {
+    //The stream is only touched by the background thread in async mode:
+    return m_async ? m_async->failed() : m_os.bad();
+  }
+
   FileWriter::~FileWriter()
   {
-    if (is_open())
-      close();
+    if (is_open()) {
+      try {
+        close();
+      } catch (std::exception& e) {
+        printf("EvtFile ERROR: Problems while closing file %s: %s\n",m_filename.c_str(),e.what());
+      }
+    }
   }
 
   void FileWriter::close()
   {
+    //Pending events must be written (and problems reported) before the index:
+    std::exception_ptr asyncError;
+    try {
+      endAsync();
+    } catch (...) {
+      asyncError = std::current_exception();
+    }
+    if (m_writeIndex && ok() && !asyncError)
+      writeEventIndex();
     m_os.close();
     delete[] m_buf;
+    m_buf = 0;
+    if (asyncError)
+      std::rethrow_exception(asyncError);
+  }
+
+  void FileWriter::writeEventIndex()
+  {
+    //Footer with all collected index entries, followed by a trailer which
+    //readers will look for at the end of the file:
+    assert(m_index.size()%EVTFILE_INDEX_ENTRY_BYTES==0);
+    std::uint64_t nevts = m_index.size()/EVTFILE_INDEX_ENTRY_BYTES;
+    assert(nevts<UINT32_MAX);
+    if (!m_index.empty())
+      write(&(m_index[0]),m_index.size());
+    write(m_nbytesWritten);//position of footer
+    write((std::uint32_t)nevts);
+    write(EVTFILE_INDEX_MAGIC);
+    static_assert(EVTFILE_INDEX_TRAILER_BYTES==sizeof(std::uint64_t)+2*sizeof(std::uint32_t));
+    m_nbytesWritten += m_index.size() + EVTFILE_INDEX_TRAILER_BYTES;
+    m_index.clear();
+    if (!m_os.good()) {
+      printf("EvtFile ERROR: Troubles encountered while writing event index to file %s\n",m_filename.c_str());
+      printf("               => File might be corrupted!\n");
+      throw std::runtime_error("Data file write failed");
+    }
   }
 
   void FileWriter::flushEventToDisk(int32_t runnumber, int32_t eventnumber)
   {
+    if (m_async)
+      m_async->rethrowError();//report problems in earlier events
+
     assert(is_open() && "Attempt to write to a file which is not open");
     assert(!bad() && "Attempt to write to a file with bad status");
 
@@ -51,13 +301,42 @@ namespace EvtFile {
     for( auto it=m_preFlushCBs.begin(), itE=m_preFlushCBs.end(); it!=itE; ++it )
       (*it)->aboutToFlushEventToDisk(*this);
 
-    bool compress_full_data(m_format->compressFullData());
+    if (m_async) {
+      //Hand over the sections to the background thread (in exchange for
+      //recycled buffers):
+      m_async->submit(runnumber,eventnumber,m_compression,
+                      m_section_database,m_section_briefdata,m_section_fulldata);
+      return;
+    }
 
-    //Compress the full data section:
-    unsigned fulldata_compressed_size(0);
-    if (compress_full_data&&!m_section_fulldata.empty()) {
-      ZLibUtils::compressToBuffer(&(m_section_fulldata[0]), m_section_fulldata.size(),
-                                  m_section_fulldata_compressed,fulldata_compressed_size);
+    writeEvent(runnumber,eventnumber,m_compression,m_section_database,
+               m_section_briefdata,m_section_fulldata,m_section_fulldata_compressed);
+    m_section_database.clear();
+    m_section_briefdata.clear();
+    m_section_fulldata.clear();
+  }
+
+  void FileWriter::writeEvent(int32_t runnumber, int32_t eventnumber,
+                              const Compression& compression,
+                              const std::vector<char>& section_database,
+                              const std::vector<char>& section_briefdata,
+                              const std::vector<char>& section_fulldata,
+                              std::vector<char>& encodebuf)
+  {
+    //Encode the full data section (non-empty sections are prefixed with the codec):
+    bool encode_full_data(m_format->compressFullData()&&!section_fulldata.empty());
+    std::uint32_t codecword(compression.codec);
+    unsigned fulldata_encoded_size(0);
+    if (encode_full_data) {
+      if (compression.codec!=CODEC_NONE&&compression.chunkSize) {
+        codecword |= EVTFILE_CODEC_CHUNKED;
+        compressChunked(section_fulldata,compression,encodebuf,fulldata_encoded_size);
+      } else if (compression.codec!=CODEC_NONE)
+        codecCompress(compression,&(section_fulldata[0]), section_fulldata.size(),
+                      encodebuf,fulldata_encoded_size);
+      else
+        fulldata_encoded_size = section_fulldata.size();
+      fulldata_encoded_size += EVTFILE_CODEC_WORD_BYTES;
     }
 
     //For efficient hash calculation and file i/o, put the event header in an array:
@@ -67,32 +346,45 @@ namespace EvtFile {
     //The first field in the header is reserved for the hash:
     eventheader[1] = runnumber;
     eventheader[2] = eventnumber;
-    eventheader[3] = (std::uint32_t)m_section_database.size();
-    eventheader[4] = (std::uint32_t)m_section_briefdata.size();
-    if (compress_full_data)
-      eventheader[5] = (std::uint32_t)(fulldata_compressed_size);
+    eventheader[3] = (std::uint32_t)section_database.size();
+    eventheader[4] = (std::uint32_t)section_briefdata.size();
+    if (encode_full_data)
+      eventheader[5] = (std::uint32_t)(fulldata_encoded_size);
     else
-      eventheader[5] = (std::uint32_t)m_section_fulldata.size();
+      eventheader[5] = (std::uint32_t)section_fulldata.size();
 
     //Calculate the hash (from uncompressed data!):
     ProgressiveHash hash;
     hash.addData((char*)&(eventheader[1]),5*sizeof(std::uint32_t));
-    if (!m_section_database.empty()) hash.addData(&(m_section_database[0]),m_section_database.size());
-    if (!m_section_briefdata.empty()) hash.addData(&(m_section_briefdata[0]),m_section_briefdata.size());
-    if (!m_section_fulldata.empty()) hash.addData(&(m_section_fulldata[0]),m_section_fulldata.size());
+    if (!section_database.empty()) hash.addData(&(section_database[0]),section_database.size());
+    if (!section_briefdata.empty()) hash.addData(&(section_briefdata[0]),section_briefdata.size());
+    if (!section_fulldata.empty()) hash.addData(&(section_fulldata[0]),section_fulldata.size());
     eventheader[0] = hash.getHash();
 
+    //Remember position and header of event for the index footer:
+    if (m_writeIndex) {
+      unsigned l(m_index.size());
+      m_index.resize(l+EVTFILE_INDEX_ENTRY_BYTES);
+      std::memcpy(&(m_index[l]),&m_nbytesWritten,sizeof(std::uint64_t));
+      std::memcpy(&(m_index[l+sizeof(std::uint64_t)]),&(eventheader[0]),6*sizeof(std::uint32_t));
+      static_assert(EVTFILE_INDEX_ENTRY_BYTES==sizeof(std::uint64_t)+6*sizeof(std::uint32_t));
+    }
+
     //Write out the header:
     write((char*)&(eventheader[0]),6*sizeof(std::uint32_t));
 
     //Write out the three data blobs:
-    if (!m_section_database.empty()) write(&(m_section_database[0]),m_section_database.size());
-    if (!m_section_briefdata.empty()) write(&(m_section_briefdata[0]),m_section_briefdata.size());
-    if (!m_section_fulldata.empty()) {
-      if (compress_full_data)
-        write(&(m_section_fulldata_compressed[0]),fulldata_compressed_size);
+    if (!section_database.empty()) write(&(section_database[0]),section_database.size());
+    if (!section_briefdata.empty()) write(&(section_briefdata[0]),section_briefdata.size());
+    if (encode_full_data) {
+      write(codecword);
+      static_assert(EVTFILE_CODEC_WORD_BYTES==sizeof(codecword));
+      if (compression.codec!=CODEC_NONE)
+        write(&(encodebuf[0]),fulldata_encoded_size-EVTFILE_CODEC_WORD_BYTES);
       else
-        write(&(m_section_fulldata[0]),m_section_fulldata.size());
+        write(&(section_fulldata[0]),section_fulldata.size());
+    } else if (!section_fulldata.empty()) {
+      write(&(section_fulldata[0]),section_fulldata.size());
     }
 
     if (!m_os.good()) {
@@ -100,11 +392,7 @@ namespace EvtFile {
       printf("               => File might be corrupted!\n");
       throw std::runtime_error("Data file write failed");
     }
-    m_section_database.clear();
-    m_section_briefdata.clear();
-    m_section_fulldata.clear();
+    m_nbytesWritten += EVTFILE_EVENT_HEADER_BYTES + eventheader[3] + eventheader[4] + eventheader[5];
   }
 
 }
-
-
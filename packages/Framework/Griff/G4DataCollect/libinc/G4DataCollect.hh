@@ -2,6 +2,7 @@
 #define G4DataCollect_hh
 
 #include <string>
+#include <cstdint>
 
 namespace G4Interfaces { class StepFilterBase; }
 class G4UserEventAction;
@@ -22,6 +23,12 @@ public:
   //
   //outputFile will automatically get the extension ".griff" appended.
   //
+  //In multi-threaded Geant4, all methods act on the calling thread only, and
+  //installHooks must be called in each worker thread (e.g. at the end of
+  //G4VUserActionInitialization::Build()) rather than in the master. Each worker
+  //then writes its own file, with ".tN" added before the extension for thread
+  //id N. The files can be combined afterwards with griffmerge.
+  //
   //Use the mode parameter to adjust amount of step information written
   //(tradeoff between file-size and available information):
   //
@@ -29,9 +36,24 @@ public:
   //  REDUCED: Coalesce steps following each other in the same volume into one.
   //  MINIMAL: No step info, only tracks and segments summaries.
   //
+  //Use the compression parameter to select the codec of the event data
+  //(tradeoff between file-size and CPU usage when writing and reading):
+  //
+  //  zlib: zlib at default level (the default).
+  //  zlib-N: zlib at level N (1=fastest, 9=best compression).
+  //  lz4, lz4-N: lz4 (N=1..12), much faster but compressing less than zlib.
+  //  zstd, zstd-N: zstd (N=1..19), faster and compressing better than zlib.
+  //  none: No compression.
+  //
+  //The lz4 and zstd codecs need the liblz4 and libzstd shared libraries at
+  //runtime (see EvtFile/Codec.hh). Appending a chunk size like "/64k" to a
+  //codec (e.g. "zlib/64k") compresses the step data in independent chunks, so
+  //readers accessing the steps of just a few segments need only inflate the
+  //chunks holding them.
+  //
   //See documentation for further details about the file format (TODO)
 
-  static void installHooks(const char* outputFile, const char* mode = "FULL");
+  static void installHooks(const char* outputFile, const char* mode = "FULL", const char* compression = "zlib");
 
   static void installUserSteppingAction(G4UserSteppingAction*);
   static void installUserEventAction(G4UserEventAction*);
@@ -39,6 +61,11 @@ public:
   //removes hooks again and closes output file:
   static void finish();
 
+  //Closes the output file and writes the following events to a new file
+  //(named as for installHooks), e.g. to split a long job into segments which
+  //are each complete files. It must be called between events:
+  static void startNewFile(const char* outputFile);
+
   //The next two methods can be used to store job settings, etc., inside the
   //files (think of it as a custom map<string,string> which you can fill with
   //whatever you feel like). The values stay active for all following events
@@ -50,12 +77,74 @@ public:
   static void setMetaData(const std::string& key,const std::string& value);
   static void setUserData(const std::string& key,const std::string& value);
 
+  //Select the encoding of step data in FULL and REDUCED modes:
+  //
+  //  STANDARD: Positions, times and kinetic energies in double precision (the default).
+  //  COMPACT: Positions and times of all but the first step point of each
+  //           segment are stored as float deltas to the previous step point,
+  //           kinetic energies as floats and momentum directions packed in 32
+  //           bits, for smaller files which are faster to read (at a relative
+  //           precision of ~1e-7 of step lengths, step times and kinetic
+  //           energies, and with momentum directions within 1e-4 radians).
+  //
+  //Readers decode both encodings transparently.
+  static void setStepEncoding(const char* encoding);
+
   //Optionally provide a step-filter [G4DataCollect takes ownership]
   static void setStepFilter(G4Interfaces::StepFilterBase*);
 
   //... and/or a kill filter [G4DataCollect takes ownership]:
   static void setStepKillFilter(G4Interfaces::StepFilterBase*);
 
+  //In REDUCED and MINIMAL modes, selected segments can nevertheless keep all
+  //their steps as in FULL mode, for instance to keep step details in the
+  //sensitive parts of a detector while storing the rest compactly. Segments
+  //are selected by the name of their (logical) volume, with volumes separated
+  //by commas, colons or semicolons (e.g. "Gas,Converter")...
+  static void setFullStepVolumes(const std::string& volumeList);
+  //... and/or by a filter applied to the first step of each segment
+  //[G4DataCollect takes ownership]:
+  static void setFullStepFilter(G4Interfaces::StepFilterBase*);
+
+  //Events can be vetoed after they have been simulated, in which case nothing
+  //about them is encoded, compressed or written to the output file. The
+  //decision is based on a summary of the event:
+  class EventSummary {
+  public:
+    virtual unsigned nTracks() const = 0;
+    virtual unsigned nPDGCodes() const = 0;
+    virtual std::int32_t pdgCode(unsigned i) const = 0;//sorted
+    virtual bool hasPDGCode(std::int32_t) const = 0;
+    virtual double eDepTotal() const = 0;
+    //The volume name refers to the innermost (logical) volume of touchables:
+    virtual double eDepInVolume(const std::string& volname) const = 0;
+    virtual bool visitedVolume(const std::string& volname) const = 0;
+  protected:
+    virtual ~EventSummary(){}
+  };
+  class EventVeto {
+  public:
+    virtual ~EventVeto(){}
+    virtual bool vetoEvent(const EventSummary&) = 0;//return true to skip the event
+  };
+
+  //Install a veto, either by providing a custom EventVeto [G4DataCollect
+  //takes ownership], or an expression which vetoes events for which it is
+  //true. Expressions can use the variables ntracks, npdgcodes and edep (total
+  //energy deposit), the functions has_pdg(code), visited("volname") and
+  //edep_in("volname"), as well as the usual units and mathematical
+  //functions. For instance "edep_in('Detector')<10keV" or "not has_pdg(2112)".
+  //
+  //When a veto is installed, each event in the file records the number of
+  //vetoed events since the previous event written (see
+  //GriffDataRead::EventSummary::nVetoedBefore), allowing for correct
+  //normalisation.
+  static void setEventVeto(EventVeto*);
+  static void setEventVeto(const std::string& expression);//throws on syntax errors
+
+  //Total number of events vetoed so far:
+  static std::uint64_t nVetoedEvents();
+
 private:
   struct Imp;
 };
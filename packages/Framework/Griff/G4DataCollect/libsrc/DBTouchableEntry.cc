@@ -90,7 +90,7 @@ void G4DataCollectInternals::DBTouchableEntry::write(EvtFile::FileWriter&fw)
   extraTests();
 #endif
 #ifndef GRIFF_APPLY_WORKAROUND_FOR_NAMEBUG
-  static std::string tmp;
+  static G4ThreadLocal std::string tmp;
 #endif
 
   unsigned actualDepth(volDepth);
@@ -0,0 +1,151 @@
+#include "DCEventVeto.hh"
+#include "DBTouchableEntry.hh"
+#include "ExprParser/ASTStdPhys.hh"
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+namespace G4DataCollectInternals {
+
+  bool DCEventSummary::hasPDGCode(std::int32_t c) const
+  {
+    return std::binary_search(m_pdgCodes.begin(),m_pdgCodes.end(),c);
+  }
+
+  double DCEventSummary::eDepTotal() const
+  {
+    double e(0.0);
+    for (auto& t : m_touchables)
+      e += m_eDeps[t.first];
+    return e;
+  }
+
+  double DCEventSummary::eDepInVolume(const std::string& volname) const
+  {
+    double e(0.0);
+    for (auto& t : m_touchables)
+      if (std::strcmp(t.second->name(),volname.c_str())==0)
+        e += m_eDeps[t.first];
+    return e;
+  }
+
+  bool DCEventSummary::visitedVolume(const std::string& volname) const
+  {
+    for (auto& t : m_touchables)
+      if (std::strcmp(t.second->name(),volname.c_str())==0)
+        return true;
+    return false;
+  }
+
+  using ExprParser::ExprEntityPtr;
+  using ExprParser::float_type;
+  using ExprParser::int_type;
+  using ExprParser::str_type;
+  typedef const G4DataCollect::EventSummary * SummaryPtr;
+
+  namespace {
+
+    template<class TValue>
+    class DCEvtBase : public ExprParser::ExprEntity<TValue> {
+    public:
+      DCEvtBase(const str_type& name_, SummaryPtr& s)
+        : ExprParser::ExprEntity<TValue>(), m_s(s), m_name(name_) {}
+      virtual bool isConstant() const { return false; }
+      virtual str_type name() const { return m_name; }
+    protected:
+      const G4DataCollect::EventSummary& summary() const
+      {
+        assert(m_s&&"did you remember to call DCEventVetoASTBuilder::setCurrentSummary before evaluating the expression?");
+        return *m_s;
+      }
+      SummaryPtr& m_s;
+      str_type m_name;
+    };
+
+    //Values like "edep":
+    template<class TValue, TValue eval_func(const G4DataCollect::EventSummary&)>
+    class DCEvtVal final : public DCEvtBase<TValue> {
+    public:
+      using DCEvtBase<TValue>::DCEvtBase;
+      virtual TValue evaluate() const { return eval_func(this->summary()); }
+    };
+
+    //Functions of a constant volume name, like "edep_in('Detector')":
+    template<class TValue, TValue eval_func(const G4DataCollect::EventSummary&, const std::string&)>
+    class DCEvtVolFct final : public DCEvtBase<TValue> {
+    public:
+      DCEvtVolFct(const str_type& name_, SummaryPtr& s, const str_type& volname)
+        : DCEvtBase<TValue>(name_,s), m_volname(volname) {}
+      virtual TValue evaluate() const { return eval_func(this->summary(),m_volname); }
+    private:
+      str_type m_volname;
+    };
+
+    //has_pdg(code):
+    class DCEvtHasPDG final : public DCEvtBase<int_type> {
+    public:
+      DCEvtHasPDG(SummaryPtr& s, ExprEntityPtr arg)
+        : DCEvtBase<int_type>("has_pdg",s) { m_children.push_back(arg); }
+      virtual int_type evaluate() const
+      {
+        return summary().hasPDGCode((std::int32_t)ExprParser::_eval<int_type>(child(0))) ? 1 : 0;
+      }
+    };
+
+    int_type evt_ntracks(const G4DataCollect::EventSummary& s) { return s.nTracks(); }
+    int_type evt_npdgcodes(const G4DataCollect::EventSummary& s) { return s.nPDGCodes(); }
+    float_type evt_edep(const G4DataCollect::EventSummary& s) { return s.eDepTotal(); }
+    float_type evt_edep_in(const G4DataCollect::EventSummary& s, const std::string& v) { return s.eDepInVolume(v); }
+    int_type evt_visited(const G4DataCollect::EventSummary& s, const std::string& v) { return s.visitedVolume(v) ? 1 : 0; }
+  }
+
+  ExprEntityPtr DCEventVetoASTBuilder::createValue(const str_type& name) const
+  {
+    auto p = ExprParser::ASTBuilder::createValue(name);
+    p = p ? p : ExprParser::create_standard_unit_or_constant(name);
+    if (p)
+      return p;
+    SummaryPtr& s = const_cast<DCEventVetoASTBuilder*>(this)->m_currentSummary;
+    if (name=="ntracks")
+      return ExprParser::makeobj<DCEvtVal<int_type,evt_ntracks>>(name,s);
+    if (name=="npdgcodes")
+      return ExprParser::makeobj<DCEvtVal<int_type,evt_npdgcodes>>(name,s);
+    if (name=="edep")
+      return ExprParser::makeobj<DCEvtVal<float_type,evt_edep>>(name,s);
+    return 0;
+  }
+
+  ExprEntityPtr DCEventVetoASTBuilder::createFunction(const str_type& name, ExprParser::ExprEntityList& args) const
+  {
+    if (name!="has_pdg"&&name!="visited"&&name!="edep_in")
+      return ExprParser::ASTBuilder::createFunction(name,args);
+    if (args.size()!=1)
+      EXPRPARSER_THROW2(ParseError,"function "<<name<<" requires exactly one argument");
+    SummaryPtr& s = const_cast<DCEventVetoASTBuilder*>(this)->m_currentSummary;
+    if (name=="has_pdg") {
+      if (args.front()->returnType()!=ExprParser::ET_INT)
+        EXPRPARSER_THROW(ParseError,"function has_pdg requires an integer argument");
+      return ExprParser::makeobj<DCEvtHasPDG>(s,args.front());
+    }
+    if (args.front()->returnType()!=ExprParser::ET_STRING||!args.front()->isConstant())
+      EXPRPARSER_THROW2(ParseError,"function "<<name<<" requires a constant string argument with a volume name");
+    str_type volname = ExprParser::_eval<str_type>(args.front());
+    if (name=="visited")
+      return ExprParser::makeobj<DCEvtVolFct<int_type,evt_visited>>(name,s,volname);
+    return ExprParser::makeobj<DCEvtVolFct<float_type,evt_edep_in>>(name,s,volname);
+  }
+
+  DCEventVetoExpr::DCEventVetoExpr(const std::string& expression)
+    : m_eval(m_builder.createEvaluator<bool>(expression))
+  {
+  }
+
+  bool DCEventVetoExpr::vetoEvent(const G4DataCollect::EventSummary& s)
+  {
+    m_builder.setCurrentSummary(&s);
+    bool veto = m_eval();
+    m_builder.setCurrentSummary(0);
+    return veto;
+  }
+
+}
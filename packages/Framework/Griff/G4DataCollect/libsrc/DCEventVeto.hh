@@ -0,0 +1,67 @@
+#ifndef G4DataCollect_DCEventVeto_hh
+#define G4DataCollect_DCEventVeto_hh
+
+//Event summary presented to event vetoes, and a veto implementation based on
+//expressions (see G4DataCollect::setEventVeto).
+
+#include "G4DataCollect/G4DataCollect.hh"
+#include "ExprParser/ASTBuilder.hh"
+#include "EvtFile/Defs.hh"
+#include <vector>
+#include <cassert>
+
+namespace G4DataCollectInternals {
+
+  class DBTouchableEntry;
+
+  //Summary referring directly to the buffers used during end of event
+  //processing in DCSteppingAction:
+  class DCEventSummary final : public G4DataCollect::EventSummary {
+  public:
+    typedef std::vector<std::pair<EvtFile::index_type,const DBTouchableEntry*> > TouchableList;
+    DCEventSummary(const std::vector<std::int32_t>& sortedPDGCodes,
+                   const TouchableList& sortedTouchables,
+                   const std::vector<double>& touchableEDeps)
+      : m_nTracks(0), m_pdgCodes(sortedPDGCodes), m_touchables(sortedTouchables), m_eDeps(touchableEDeps) {}
+    virtual ~DCEventSummary(){}
+    void setNTracks(unsigned n) { m_nTracks = n; }
+
+    unsigned nTracks() const { return m_nTracks; }
+    unsigned nPDGCodes() const { return m_pdgCodes.size(); }
+    std::int32_t pdgCode(unsigned i) const { assert(i<m_pdgCodes.size()); return m_pdgCodes[i]; }
+    bool hasPDGCode(std::int32_t) const;
+    double eDepTotal() const;
+    double eDepInVolume(const std::string& volname) const;
+    bool visitedVolume(const std::string& volname) const;
+  private:
+    unsigned m_nTracks;
+    const std::vector<std::int32_t>& m_pdgCodes;
+    const TouchableList& m_touchables;
+    const std::vector<double>& m_eDeps;//indexed by touchable index
+  };
+
+  class DCEventVetoASTBuilder : public ExprParser::ASTBuilder {
+  public:
+    DCEventVetoASTBuilder() : ExprParser::ASTBuilder(), m_currentSummary(0) {}
+    virtual ~DCEventVetoASTBuilder(){}
+    //Must always set current summary before evaluating expression trees built with this class:
+    void setCurrentSummary(const G4DataCollect::EventSummary* s) { m_currentSummary = s; }
+  protected:
+    virtual ExprParser::ExprEntityPtr createValue(const ExprParser::str_type& name) const;
+    virtual ExprParser::ExprEntityPtr createFunction(const ExprParser::str_type& name, ExprParser::ExprEntityList& args) const;
+    const G4DataCollect::EventSummary * m_currentSummary;
+  };
+
+  class DCEventVetoExpr : public G4DataCollect::EventVeto {
+  public:
+    DCEventVetoExpr(const std::string& expression);//throws on errors in expression
+    virtual ~DCEventVetoExpr(){}
+    bool vetoEvent(const G4DataCollect::EventSummary&);
+  private:
+    DCEventVetoASTBuilder m_builder;
+    ExprParser::Evaluator<bool> m_eval;
+  };
+
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include "G4RunManager.hh"
 #include "G4Run.hh"
 #include "G4Event.hh"
+class G4VProcess;
 
 namespace G4DataCollectInternals {
 
@@ -56,6 +57,11 @@ namespace G4DataCollectInternals {
     EvtFile::DBEntryWriter dbMetaData;
     EvtFile::DBStringsWriter dbMetaDataStrings;//must be after dbMetaData;
 
+    //Avoid repeated lookups of the name of the process defining step points
+    //(kept here since the index refers to the databases of this file):
+    const G4VProcess * lastProc = (const G4VProcess *)0x1;
+    EvtFile::index_type lastProcIdx = 0;
+
     void flushEventToDisk()
     {
       unsigned runid = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
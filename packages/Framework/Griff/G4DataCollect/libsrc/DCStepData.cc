@@ -25,16 +25,14 @@ void G4DataCollectInternals::DCStepData::EndPointData::set(G4StepPoint*p,const G
   //Get the index for the name of the GetProcessDefinedStep, but avoid repeated lookups of the same name.
   const G4VProcess * proc = p->GetProcessDefinedStep();
   assert(proc!=(const G4VProcess *)0x1);
-  static const G4VProcess * lastProc = (const G4VProcess *)0x1;
-  static EvtFile::index_type lastProcIdx = 0;
-  if (proc!=lastProc) {
+  if (proc!=mgr.lastProc) {
     static G4String empty;
     const G4String * name = proc ? &(proc->GetProcessName()) : &empty;
     assert(name);
-    lastProcIdx = mgr.dbProcNames.getIndex(*name);
-    lastProc = proc;
+    mgr.lastProcIdx = mgr.dbProcNames.getIndex(*name);
+    mgr.lastProc = proc;
   }
-  processDefiningStepIdx = lastProcIdx;
+  processDefiningStepIdx = mgr.lastProcIdx;
 }
 
 void G4DataCollectInternals::DCStepData::set(const G4Step*step,DCMgr&mgr, int isNewVolOnSameTrack,G4DataCollectInternals::DCStepData* prevStep)
@@ -94,6 +92,8 @@ void G4DataCollectInternals::DCStepData::set(const G4Step*step,DCMgr&mgr, int is
   }
 
   segmentEnd = 0;
+  nCoalesced = 1;
+  keepFull = false;
 
   volIdx = EvtFile::INDEX_MAX;//will be replaced by proper value during end of event processing
   if (preStep.atVolEdge||stepNbr<2) {
@@ -101,7 +101,7 @@ void G4DataCollectInternals::DCStepData::set(const G4Step*step,DCMgr&mgr, int is
     if (notNewVolumeNoMatterWhatGeant4Says) {
       std::cout<<FrameworkGlobals::printPrefix()<<"WARNING: Correcting buggy Geant4 AtVolEdge flags."
         " Seed is "<<FrameworkGlobals::currentEvtSeed()<<std::endl;
-      if (prevStep&&prevStep->trkId==trkId&&prevStep->stepNbr+1==stepNbr)
+      if (prevStep&&prevStep->trkId==trkId&&prevStep->lastStepNbr()+1==stepNbr)
         prevStep->postStep.atVolEdge = false;
       preStep.atVolEdge = false;
       touchableEntry = 0;
@@ -118,7 +118,7 @@ void G4DataCollectInternals::DCStepData::set(const G4Step*step,DCMgr&mgr, int is
     if (newVolumeNoMatterWhatGeant4Says) {
       std::cout<<FrameworkGlobals::printPrefix()<<"WARNING: Correcting buggy Geant4 AtVolEdge flags."
         " Seed is "<<FrameworkGlobals::currentEvtSeed()<<std::endl;
-      if (prevStep&&prevStep->trkId==trkId&&prevStep->stepNbr+1==stepNbr)
+      if (prevStep&&prevStep->trkId==trkId&&prevStep->lastStepNbr()+1==stepNbr)
         prevStep->postStep.atVolEdge = true;
       preStep.atVolEdge = true;
       touchableEntry = new DBTouchableEntry(&mgr,touchable);//fixme: use memory pool...
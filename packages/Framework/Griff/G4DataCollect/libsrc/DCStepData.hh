@@ -4,6 +4,7 @@
 #include "DCMgr.hh"
 #include "G4String.hh"
 #include "DBTouchableEntry.hh"
+#include "GriffFormat/OctahedralPack.hh"
 #include <cmath>
 class G4Step;
 class G4StepPoint;
@@ -29,21 +30,24 @@ namespace G4DataCollectInternals {
       EvtFile::index_type processDefiningStepIdx;
       bool atVolEdge;
       void set(G4StepPoint*,const G4AffineTransform& topTransform,DCMgr&mgr);
-      void write(EvtFile::FileWriter&fw)
+      double eKinAndVolEdge() const
       {
-        //weight is stored in the track section, not here. |eKin| and atVolEdge
-        //are stored in the same double, by using the sign bit for atVolEdge.
-
-        //encode |eKin| and atVolEdge, taking care when |eKin|==0
-        double eKinAndVolEdge;
+        //|eKin| and atVolEdge are stored in the same double, by using the
+        //sign bit for atVolEdge (taking care when |eKin|==0):
+        double e;
         if (std::fabs(eKin))
-          eKinAndVolEdge = std::fabs(eKin)*(atVolEdge?-1:1);
+          e = std::fabs(eKin)*(atVolEdge?-1:1);
         else {
-          eKinAndVolEdge = atVolEdge ? double(-0.0) : double(0.0);
+          e = atVolEdge ? double(-0.0) : double(0.0);
         }
-        assert( std::fabs(eKin) == std::fabs(eKinAndVolEdge) );
-        assert( atVolEdge == bool(std::signbit(eKinAndVolEdge)) );
-
+        assert( std::fabs(eKin) == std::fabs(e) );
+        assert( atVolEdge == bool(std::signbit(e)) );
+        return e;
+      }
+      void write(EvtFile::FileWriter&fw)
+      {
+        //weight is stored in the track section, not here.
+        double eKinAndVolEdge = this->eKinAndVolEdge();
 #ifndef NDEBUG
         unsigned stored_before = fw.sizeFullDataSection();
 #endif
@@ -59,6 +63,31 @@ namespace G4DataCollectInternals {
         static_assert(GriffFormat::Format::SIZE_STEPPREPOSTPART==5*sizeof(double)+6*sizeof(float)+sizeof(EvtFile::index_type));
         assert(fw.sizeFullDataSection()-stored_before==GriffFormat::Format::SIZE_STEPPREPOSTPART);
       }
+      //Compact encoding (see GriffFormat::Format::STEPENCODING_COMPACT), with
+      //global position and time as float deltas to ref (x,y,z,t), which is
+      //updated to the values readers will decode:
+      void writeCompact(EvtFile::FileWriter&fw, double * ref)
+      {
+#ifndef NDEBUG
+        unsigned stored_before = fw.sizeFullDataSection();
+#endif
+        float delta[4];
+        for (unsigned i = 0; i < 4; ++i) {
+          delta[i] = float((i<3?globpos[i]:time) - ref[i]);
+          ref[i] += delta[i];
+        }
+        fw.writeDataFullSection(delta);//4 floats
+        fw.writeDataFullSection(float(eKinAndVolEdge()));//1 float (keeps sign bit of -0.0)
+        fw.writeDataFullSection(locpos);//3 floats
+        float pmag = float(std::sqrt(double(mom[0])*mom[0]+double(mom[1])*mom[1]+double(mom[2])*mom[2]));
+        std::uint16_t pdir[2];
+        GriffFormat::packOctahedral(mom,pdir);
+        fw.writeDataFullSection(pmag);//1 float
+        fw.writeDataFullSection(pdir);//2 uint16
+        fw.writeDataFullSection(processDefiningStepIdx);//1 EvtFile::index_type (4 bytes)
+        static_assert(GriffFormat::Format::SIZE_STEPPREPOSTPART_COMPACT==9*sizeof(float)+2*sizeof(std::uint16_t)+sizeof(EvtFile::index_type));
+        assert(fw.sizeFullDataSection()-stored_before==GriffFormat::Format::SIZE_STEPPREPOSTPART_COMPACT);
+      }
 
     };
     EndPointData preStep;
@@ -89,6 +118,31 @@ namespace G4DataCollectInternals {
                         //segment and provide a pointer to the end (+1) of
                         //the segment.
 
+    //In REDUCED and MINIMAL modes, consecutive steps within the same segment
+    //are coalesced into a single object already while stepping (keeping
+    //stepNbr, preStep and touchableEntry of the first, and postStep and
+    //stepStatus of the last step):
+    unsigned nCoalesced;
+    G4int lastStepNbr() const { return stepNbr + G4int(nCoalesced) - 1; }
+    bool continuedBy(const DCStepData& o) const
+    {
+      return !o.touchableEntry && o.trkId==trkId && o.stepNbr==lastStepNbr()+1;
+    }
+    //Set on all steps of segments which keep full step data even in REDUCED
+    //and MINIMAL modes (see G4DataCollect::setFullStepVolumes), in which case
+    //the steps are not coalesced:
+    bool keepFull;
+    void coalesce(const DCStepData& o)
+    {
+      assert(continuedBy(o));
+      eDep += o.eDep;
+      eDepNonIonizing += o.eDepNonIonizing;
+      stepLength += o.stepLength;
+      stepStatus = o.stepStatus;
+      postStep = o.postStep;
+      ++nCoalesced;
+    }
+
     //NB: Do *not* init all variables here (for efficiency), only in ::set(..)).:
     bool valid() const { return stepNbr!=-99; }
     DCStepData() : stepNbr(-99),touchableEntry(0),segmentEnd(EvtFile::INDEX_MAX) { assert(!valid());}
@@ -5,67 +5,136 @@
 #include <cassert>
 #include "Utils/Format.hh"
 #include <algorithm>
-#include <set>
 #include <limits>
 #include <stdexcept>
 #include "DBMetaDataEntry.hh"
 #include "Randomize.hh"
 #include "G4Version.hh"
+#include "G4LogicalVolume.hh"
 
 #ifdef G4MULTITHREADED
-#  include "G4RunManager.hh"
-#  include "G4MTRunManager.hh"
+#  include "G4Threading.hh"
 #endif
 
 namespace G4DataCollectInternals {
 
-  DCSteppingAction::DCSteppingAction(const char* outputFile, GriffFormat::Format::MODE mode, G4UserSteppingAction * otherAct)
-    : G4UserSteppingAction(), m_mode(mode), m_otherAction(otherAct),
+  DCSteppingAction::DCSteppingAction(const char* outputFile, GriffFormat::Format::MODE mode, G4UserSteppingAction * otherAct,
+                                     const EvtFile::Compression& compression)
+    : G4UserSteppingAction(), m_mode(mode), m_compression(compression), m_otherAction(otherAct),
       m_stepFilter(0), m_stepKillFilter(0), m_doFilter(false),
       m_prevTrkId(INT_MAX), m_prevStepNbr(INT_MAX-1), m_prevVol(0),
       m_currentMetaDataIdx(EvtFile::INDEX_MAX),
-      m_mgr(0), m_outputFile(outputFile)
+      m_mgr(0), m_outputFile(outputFile),
+      m_eventVeto(0),
+      m_eventSummary(m_pdgCodes.codes(),m_touchablesVisited,m_touchableEDeps),
+      m_nVetoedSinceWritten(0),
+      m_nVetoedTotal(0),
+      m_fullStepFilter(0),
+      m_mixedMode(false),
+      m_lastFullStepVol(0),
+      m_lastFullStepVolResult(false),
+      m_stepEncoding(GriffFormat::Format::STEPENCODING_STANDARD),
+      m_mempool_nused(0),
+      m_coalesceSteps(mode!=GriffFormat::Format::MODE_FULL && !getenv("DGCODE_GRIFF_NOCOALESCE")),
+      m_openStep(0)
   {
-    //Todo: user should be able to change mode on the fly, and even be able to skip writing of event entirely.
+    //Todo: user should be able to change mode on the fly.
   }
 
   DCSteppingAction::~DCSteppingAction()
   {
+    if (m_nVetoedTotal)
+      printf("%sG4DataCollect: %llu events were vetoed and not written to %s (of which %u after the last written event)\n",
+             FrameworkGlobals::printPrefix(),(unsigned long long)m_nVetoedTotal,m_outputFile.c_str(),(unsigned)m_nVetoedSinceWritten);
+    delete m_eventVeto;
     delete m_stepFilter;
     delete m_stepKillFilter;
+    delete m_fullStepFilter;
     delete m_mgr;
   }
 
   void DCSteppingAction::initMgr()
   {
-#ifdef G4MULTITHREADED
-    {
-      auto runmgr = G4RunManager::GetRunManager();
-      if (!runmgr)
-        throw std::runtime_error("Logic error: Griff DCSteppingAction should not initialise before G4RunManager is created.");
-      if (dynamic_cast<G4MTRunManager*>(G4RunManager::GetRunManager()))
-        throw std::runtime_error("Griff Data collection detected usage of G4MTRunManager which is not supported!");
-    }
-#endif
+    openFile();
+    if (m_stepFilter)
+      m_stepFilter->initFilter();
+    if (m_stepKillFilter)
+      m_stepKillFilter->initFilter();
+    if (m_fullStepFilter)
+      m_fullStepFilter->initFilter();
+  }
 
+  void DCSteppingAction::openFile()
+  {
     std::string extension(GriffFormat::Format::getFormat()->fileExtension());
     bool has_extension(Core::ends_with(m_outputFile,extension));
+    std::string orig = m_outputFile;
+    if (orig.size()>=extension.size()&&has_extension)
+      orig.resize(orig.size()-extension.size());
+    std::string tmp;
+#ifdef G4MULTITHREADED
+    //Worker threads each write their own file (and databases), named after
+    //the thread id like forked processes are named after their mpID:
+    if (G4Threading::IsMultithreadedApplication()) {
+      assert(G4Threading::IsWorkerThread());//enforced in G4DataCollect::installHooks
+      Utils::string_format(tmp,".t%i",G4Threading::G4GetThreadId());
+      orig += tmp;
+    }
+#endif
     if (FrameworkGlobals::isForked()) {
-      std::string orig = m_outputFile;
-      if (orig.size()>=extension.size()&&has_extension)
-        orig.resize(orig.size()-extension.size());
-      std::string tmp;
       Utils::string_format(tmp,"%s.%i",orig.c_str(),FrameworkGlobals::mpID());
       m_outputFile = tmp;
     } else {
-      if (!has_extension)
-        m_outputFile += extension;
+      m_outputFile = orig + extension;
     }
     m_mgr = new DCMgr(m_outputFile.c_str());
-    if (m_stepFilter)
-      m_stepFilter->initFilter();
-    if (m_stepKillFilter)
-      m_stepKillFilter->initFilter();
+    m_mgr->fileWriter.setCompression(m_compression);
+    //Hash, compress and write events in the background while the next event is simulated:
+    m_mgr->fileWriter.setAsync(true);
+  }
+
+  void DCSteppingAction::startNewFile(const char* outputFile)
+  {
+    assert(m_steps.empty()&&!m_openStep);
+    bool wasOpen = (m_mgr!=0);
+    delete m_mgr;//closes the current file
+    m_mgr = 0;
+    m_outputFile = outputFile;
+    //The new file has its own databases, so the metadata must be written again:
+    m_currentMetaDataIdx = EvtFile::INDEX_MAX;
+    if (wasOpen)
+      openFile();//otherwise opened along with initialisation of filters
+  }
+
+  void DCSteppingAction::setFullStepVolumes(const std::string& volumeList)
+  {
+    std::vector<std::string> vols;
+    Core::split_noempty(vols,volumeList,";:, ");
+    for (auto& v : vols)
+      m_fullStepVolumes.insert(v);
+    m_lastFullStepVol = 0;
+    updateMixedMode();
+  }
+
+  void DCSteppingAction::updateMixedMode()
+  {
+    m_mixedMode = m_mode!=GriffFormat::Format::MODE_FULL && (m_fullStepFilter||!m_fullStepVolumes.empty());
+  }
+
+  bool DCSteppingAction::keepFullSteps(const G4Step*step)
+  {
+    //Only invoked on the first step of each segment:
+    assert(m_mixedMode);
+    if (!m_fullStepVolumes.empty()) {
+      const G4LogicalVolume * lv = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume(0)->GetLogicalVolume();
+      if (lv!=m_lastFullStepVol) {
+        m_lastFullStepVol = lv;
+        m_lastFullStepVolResult = m_fullStepVolumes.contains(lv->GetName());
+      }
+      if (m_lastFullStepVolResult)
+        return true;
+    }
+    return m_fullStepFilter && m_fullStepFilter->filterStep(step) != m_fullStepFilter->negated();
   }
 
   void DCSteppingAction::setMetaData(const std::string& ckey,const std::string& cvalue)
@@ -94,6 +163,7 @@ namespace G4DataCollectInternals {
     else if (m_mode==GriffFormat::Format::MODE_REDUCED) setMetaData("GriffMode","REDUCED");
     else if (m_mode==GriffFormat::Format::MODE_MINIMAL) setMetaData("GriffMode","MINIMAL");
     else { assert(false); }
+    setMetaData("GriffCompression",EvtFile::compressionName(m_compression));
     //Random engine name:
     setMetaData("RandEngine",CLHEP::HepRandom::getTheEngine()->name());
     //Data libraries (at least, the name they point to)
@@ -139,6 +209,34 @@ namespace G4DataCollectInternals {
     }
   }
 
+  void DCSteppingAction::writeStepPoint(EvtFile::FileWriter& fw, DCStepData::EndPointData& p, bool firstOnSegment)
+  {
+    if (m_stepEncoding==GriffFormat::Format::STEPENCODING_STANDARD) {
+      p.write(fw);
+    } else if (firstOnSegment) {
+      //segments can be decoded independently, so start from absolute values:
+      p.write(fw);
+      for (unsigned i = 0; i < 3; ++i)
+        m_compactRef[i] = p.globpos[i];
+      m_compactRef[3] = p.time;
+    } else {
+      p.writeCompact(fw,m_compactRef);
+    }
+  }
+
+  void DCSteppingAction::writeStepOtherPart(EvtFile::FileWriter& fw, double eDep, double eDepNonIonizing,
+                                            double stepLength, std::uint32_t stepStatus)
+  {
+    fw.writeDataFullSection(float(eDep));
+    fw.writeDataFullSection(float(eDepNonIonizing));
+    fw.writeDataFullSection(float(stepLength));
+    //Same in both encodings, since a shorter status would misalign the
+    //following data:
+    fw.writeDataFullSection(stepStatus);//waste of 3.5 bytes...
+    static_assert(GriffFormat::Format::SIZE_STEPOTHERPART==3*sizeof(float)+sizeof(std::uint32_t));
+    static_assert(GriffFormat::Format::SIZE_STEPOTHERPART_COMPACT==GriffFormat::Format::SIZE_STEPOTHERPART);
+  }
+
   void DCSteppingAction::UserSteppingAction(const G4Step*step)
   {
     if (m_otherAction) {
@@ -168,6 +266,25 @@ namespace G4DataCollectInternals {
         return;
     }
     //passed any filters so record:
+    if (m_coalesceSteps) {
+      //Merge into the previously recorded step if it belongs to the same
+      //segment (the object is still needed to detect new volumes):
+      DCStepData * newstep = mempoolGetStepObject();
+      newstep->set(step,*m_mgr,isNewVolOnSameTrack,isNewVolOnSameTrack!=-1 ? m_openStep : 0);
+      if (m_openStep && m_openStep->continuedBy(*newstep)) {
+        if (!m_openStep->keepFull) {
+          m_openStep->coalesce(*newstep);
+          mempoolReleaseLastStepObject();
+          return;
+        }
+        newstep->keepFull = true;
+      } else if (m_mixedMode) {
+        newstep->keepFull = keepFullSteps(step);
+      }
+      m_steps.push_back(newstep);
+      m_openStep = newstep;
+      return;
+    }
     unsigned nstepsprev = m_steps.size();
     DCStepData * newstep = mempoolGetStepObject();
     m_steps.push_back(newstep);
@@ -179,7 +296,8 @@ namespace G4DataCollectInternals {
 #endif
     G4DataCollectInternals::DCStepData * prevstep = ( (nstepsprev>0&&isNewVolOnSameTrack!=-1) ? m_steps[nstepsprev-1] : 0 );
     newstep->set(step,*m_mgr,isNewVolOnSameTrack,prevstep);
-
+    if (m_mixedMode)
+      newstep->keepFull = (prevstep && prevstep->continuedBy(*newstep)) ? prevstep->keepFull : keepFullSteps(step);
 
 #ifdef GRIFF_EXTRA_TESTS
     for (unsigned i=0;i<m_steps.size();++i) {
@@ -188,23 +306,6 @@ namespace G4DataCollectInternals {
 #endif
   }
 
-  struct DCSteppingAction::Track_
-  {
-    Track_(G4int trkId_,
-           unsigned stepBegin_)
-      : trkId(trkId_),
-        nSegments(0),
-        creatorProcIdx(EvtFile::INDEX_MAX),
-        stepBegin(stepBegin_),
-        stepEnd(EvtFile::INDEX_MAX) {}
-    G4int trkId;
-    unsigned nSegments;
-    unsigned segmentsBegin;
-    EvtFile::index_type creatorProcIdx;
-    unsigned stepBegin;
-    unsigned stepEnd;
-  };
-
   bool compareSteps(const DCStepData* lhs,const DCStepData* rhs)
   {
 #ifdef GRIFF_EXTRA_TESTS
@@ -216,13 +317,108 @@ namespace G4DataCollectInternals {
     return lhs->trkId==rhs->trkId ? lhs->stepNbr<rhs->stepNbr : lhs->trkId<rhs->trkId;
   }
 
+  void DCSteppingAction::sortSteps()
+  {
+    //Sort by trackid first, step number second. Steps mostly arrive in order
+    //already, and small events are simply handled with std::sort. Otherwise
+    //use a LSD radix sort on a 64 bit key (flipping the sign bits to preserve
+    //the order of signed integers), skipping passes over bytes which are
+    //identical for all steps:
+    const std::size_t n = m_steps.size();
+    if (std::is_sorted(m_steps.begin(),m_steps.end(),compareSteps))
+      return;
+    if (n<256) {
+      std::sort(m_steps.begin(),m_steps.end(),compareSteps);//cheap, just swapping order of pointers
+      return;
+    }
+    auto& buf = m_sortBuffer[0];
+    auto& tmp = m_sortBuffer[1];
+    buf.resize(n);
+    tmp.resize(n);
+    static_assert(sizeof(G4int)==4);
+    std::size_t counts[8][256] = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      DCStepData * s = m_steps[i];
+#ifdef GRIFF_EXTRA_TESTS
+      assert(s->valid());
+      s->extraTests();
+#endif
+      std::uint64_t key = ( std::uint64_t(std::uint32_t(s->trkId)^0x80000000u) << 32 )
+                          | (std::uint32_t(s->stepNbr)^0x80000000u);
+      buf[i].first = key;
+      buf[i].second = s;
+      for (unsigned d = 0; d < 8; ++d)
+        ++counts[d][(key>>(8*d))&0xFF];
+    }
+    for (unsigned d = 0; d < 8; ++d) {
+      std::size_t * c = counts[d];
+      if (c[(buf[0].first>>(8*d))&0xFF]==n)
+        continue;//all keys share this byte
+      std::size_t offset = 0;
+      for (unsigned j = 0; j < 256; ++j) {
+        std::size_t cj = c[j];
+        c[j] = offset;
+        offset += cj;
+      }
+      for (std::size_t i = 0; i < n; ++i)
+        tmp[c[(buf[i].first>>(8*d))&0xFF]++] = buf[i];
+      buf.swap(tmp);
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      m_steps[i] = buf[i].second;
+  }
+
+  std::size_t DCSteppingAction::PDGCodeSet::slot(std::int32_t pdgcode) const
+  {
+    //Multiplicative hashing, then linear probing:
+    const std::size_t mask = m_table.size()-1;
+    std::size_t i = std::size_t((std::uint32_t(pdgcode)*0x9E3779B1u)>>7) & mask;
+    while (m_table[i]!=s_empty && m_table[i]!=pdgcode)
+      i = (i+1) & mask;
+    return i;
+  }
+
+  void DCSteppingAction::PDGCodeSet::insert(std::int32_t pdgcode)
+  {
+    std::size_t i = slot(pdgcode);
+    if (m_table[i]!=s_empty)
+      return;//already present
+    m_table[i] = pdgcode;
+    m_codes.push_back(pdgcode);
+    if (2*m_codes.size()>m_table.size()) {
+      //keep the load factor below 0.5:
+      m_table.assign(2*m_table.size(),s_empty);
+      for (auto c : m_codes)
+        m_table[slot(c)] = c;
+    }
+  }
+
+  void DCSteppingAction::PDGCodeSet::clear()
+  {
+    //Reset all slots, since emptying just the occupied ones would break the
+    //probe chains of codes displaced by collisions (the table is small):
+    std::fill(m_table.begin(),m_table.end(),s_empty);
+    m_codes.clear();
+  }
+
+  void DCSteppingAction::clearEvent()
+  {
+    clearSteps();
+    m_tracks.clear();
+    m_daughterIDs.clear();
+    m_pdgCodes.clear();
+    for (auto& te : m_touchablesVisited)
+      m_touchableEDeps[te.first] = -1.0;
+    m_touchablesVisited.clear();
+  }
+
   void DCSteppingAction::EndOfEventAction(const G4Event*)
   {
     if (!m_mgr)//check here as well, in case 1st event had no tracks.
       initMgr();
 
     //Prepare steps:
-    std::sort(m_steps.begin(),m_steps.end(),compareSteps);//cheap, just swapping order of pointers
+    sortSteps();
 
     //////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////
@@ -234,12 +430,9 @@ namespace G4DataCollectInternals {
     //////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////
 
-    // Track related data structures:
-    std::vector<Track_> tracks;
-    tracks.reserve(std::min<unsigned>(1024,4*(m_steps.size()/12)));//fixme: cache tracks object?
-    std::map<G4int,std::set<G4int> > trkid2daughters;//todo: benchmark unordered_map.
-    // unsigned ndaughterfields_tot(0);
-    std::set<G4int> unique_pdgcodes;
+    // Track related data structures (all retained across events):
+    std::vector<Track_>& tracks = m_tracks;
+    assert(tracks.empty()&&m_daughterIDs.empty()&&m_pdgCodes.codes().empty()&&m_touchablesVisited.empty());
     G4int pdgcode_prev = std::numeric_limits<G4int>::max();
     EvtFile::index_type prev_volidx(EvtFile::INDEX_MAX);
     EvtFile::index_type volidx(EvtFile::INDEX_MAX);
@@ -262,30 +455,23 @@ namespace G4DataCollectInternals {
           nSegments = 0;
           stepNbr_prev = -9999;
         }
-        tracks.push_back(Track_(s.trkId,istep));//create new track
+        tracks.emplace_back();//create new track
+        Track_& trk = tracks.back();
+        trk.trkId = s.trkId;
+        trk.nSegments = 0;
+        trk.segmentsBegin = iSegments;
+        trk.creatorProcIdx = EvtFile::INDEX_MAX;
+        trk.stepBegin = istep;
+        trk.stepEnd = EvtFile::INDEX_MAX;
+        trk.nDaughters = 0;
+        trk.daughtersBegin = 0;
         trkId_prev=s.trkId;
-        tracks.back().segmentsBegin = iSegments;
         if (s.creatorProcessName)
-          tracks.back().creatorProcIdx = m_mgr->dbProcNames.getIndex(*(s.creatorProcessName));
+          trk.creatorProcIdx = m_mgr->dbProcNames.getIndex(*(s.creatorProcessName));
         if (pdgcode_prev != s.pdgcode || first) {//pdg code
-          unique_pdgcodes.insert(s.pdgcode);
+          m_pdgCodes.insert(s.pdgcode);
           pdgcode_prev = s.pdgcode;
         }
-        if (s.parentId!=0) {
-          //track has a parent (i.e. it is a secondary) so we fill the trkid => daughterids map
-          auto it = trkid2daughters.find(s.parentId);
-          if (it == trkid2daughters.end()) {
-            std::set<G4int> daughters;
-            daughters.insert(s.trkId);
-            // ++ndaughterfields_tot;
-            trkid2daughters[s.parentId] = daughters;//inefficient std::set copy?
-          } else {
-            it->second.insert(s.trkId);
-            // auto res = it->second.insert(s.trkId);
-            // if (res.second)
-            //   ++ndaughterfields_tot;
-          }
-        }
       }//endif new-track
 
       //define segments by volume changes (or when steps are omitted due to filtering).
@@ -327,7 +513,15 @@ namespace G4DataCollectInternals {
         ++iSegments;
       }
       s.volIdx = volidx;
-      stepNbr_prev = s.stepNbr;
+      assert(volidx!=EvtFile::INDEX_MAX);
+      if (volidx>=m_touchableEDeps.size())
+        m_touchableEDeps.resize(volidx+1,-1.0);
+      if (m_touchableEDeps[volidx]<0.0) {
+        m_touchableEDeps[volidx] = 0.0;
+        m_touchablesVisited.emplace_back(volidx,s.touchableEntry);
+      }
+      m_touchableEDeps[volidx] += s.eDep;
+      stepNbr_prev = s.lastStepNbr();
     }
     //Finish up the very last track:
     if (!tracks.empty()) {
@@ -338,6 +532,54 @@ namespace G4DataCollectInternals {
         m_steps[currentSegmentBegin]->segmentEnd = nsteps;
     }
 
+    //The event summary needs sorted pdg codes and touchables:
+    std::vector<std::int32_t>& unique_pdgcodes = m_pdgCodes.codes();
+    std::sort(unique_pdgcodes.begin(),unique_pdgcodes.end());
+    std::sort(m_touchablesVisited.begin(),m_touchablesVisited.end());
+
+    //Give the veto a chance to reject the event before anything is encoded:
+    if (m_eventVeto) {
+      m_eventSummary.setNTracks(tracks.size());
+      if (m_eventVeto->vetoEvent(m_eventSummary)) {
+        ++m_nVetoedSinceWritten;
+        ++m_nVetoedTotal;
+        clearEvent();
+        return;
+      }
+    }
+
+    //Establish mother-daughter relationships with two passes over the tracks
+    //(which are sorted by id, so daughter lists end up sorted as well). First
+    //count the daughters of each track, then fill them into m_daughterIDs:
+    auto findTrack = [&tracks](G4int trkId)
+    {
+      auto it = std::lower_bound(tracks.begin(),tracks.end(),trkId,
+                                 [](const Track_& t, G4int id) { return t.trkId < id; });
+      return (it!=tracks.end()&&it->trkId==trkId) ? &(*it) : nullptr;
+    };
+    unsigned nDaughtersTot = 0;
+    for (auto& trk : tracks) {
+      G4int parentId = m_steps[trk.stepBegin]->parentId;
+      Track_ * parent = parentId ? findTrack(parentId) : nullptr;
+      if (parent) {
+        ++(parent->nDaughters);
+        ++nDaughtersTot;
+      }
+    }
+    unsigned iDaughters = 0;
+    for (auto& trk : tracks) {
+      trk.daughtersBegin = iDaughters;
+      iDaughters += trk.nDaughters;
+      trk.nDaughters = 0;
+    }
+    m_daughterIDs.resize(nDaughtersTot);
+    for (auto& trk : tracks) {
+      G4int parentId = m_steps[trk.stepBegin]->parentId;
+      Track_ * parent = parentId ? findTrack(parentId) : nullptr;
+      if (parent)
+        m_daughterIDs[parent->daughtersBegin + parent->nDaughters++] = trk.trkId;
+    }
+
 
     //////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////
@@ -372,13 +614,36 @@ namespace G4DataCollectInternals {
     fw.writeDataBriefSection((std::uint64_t)FrameworkGlobals::currentEvtSeed());
     fw.writeDataBriefSection(m_currentMetaDataIdx);
     fw.writeDataBriefSection((std::uint32_t)tracks.size());
-    fw.writeDataBriefSection((std::uint32_t)m_mode);//could be squeezed into the track size word and hope we had <1e9 tracks
+    std::uint32_t modeword = (std::uint32_t)m_mode|GriffFormat::Format::MODEFLAG_SUMMARY;
+    if (m_eventVeto)
+      modeword |= GriffFormat::Format::MODEFLAG_VETOCOUNT;
+    if (m_mixedMode)
+      modeword |= GriffFormat::Format::MODEFLAG_MIXED;
+    modeword |= (std::uint32_t)m_stepEncoding << GriffFormat::Format::STEPENCODING_SHIFT;
+    fw.writeDataBriefSection(modeword);//could be squeezed into the track size word and hope we had <1e9 tracks
+
+    //Event summary (see GriffFormat::Format::MODEFLAG_SUMMARY), allowing
+    //readers to preselect events without loading tracks or steps:
+    fw.writeDataBriefSection((std::uint32_t)((m_eventVeto?4:3)*sizeof(std::uint32_t)
+                                             + unique_pdgcodes.size()*sizeof(int32_t)
+                                             + m_touchablesVisited.size()*(sizeof(EvtFile::index_type)+sizeof(float))));
+    fw.writeDataBriefSection((std::uint32_t)unique_pdgcodes.size());
+    for (auto pdgcode : unique_pdgcodes)
+      fw.writeDataBriefSection((int32_t)pdgcode);
+    fw.writeDataBriefSection((std::uint32_t)m_touchablesVisited.size());
+    for (auto& te : m_touchablesVisited) {
+      fw.writeDataBriefSection(te.first);
+      fw.writeDataBriefSection((float)m_touchableEDeps[te.first]);
+    }
+    if (m_eventVeto) {
+      fw.writeDataBriefSection(m_nVetoedSinceWritten);
+      m_nVetoedSinceWritten = 0;
+    }
 
     for (auto itTrack=tracks.begin();itTrack!=itTrackE;++itTrack) {
       Track_ & trk = *itTrack;
       DCStepData & step = * (m_steps[trk.stepBegin]);
-      auto itDaughters = trkid2daughters.find(trk.trkId);
-      unsigned nDaughters = itDaughters==trkid2daughters.end() ? 0 : itDaughters->second.size();
+      unsigned nDaughters = trk.nDaughters;
 
       fw.writeDataBriefSection((int32_t)trk.trkId);
       fw.writeDataBriefSection((int32_t)step.pdgcode);
@@ -388,9 +653,8 @@ namespace G4DataCollectInternals {
       fw.writeDataBriefSection((std::uint32_t)trk.nSegments);
       fw.writeDataBriefSection((std::uint32_t)nDaughters);
       assert(trk.nSegments>0);
-      if (nDaughters)
-        for (auto itD = itDaughters->second.begin();itD!=itDaughters->second.end();++itD)
-          fw.writeDataBriefSection((int32_t)*itD);
+      for (unsigned i = 0; i < nDaughters; ++i)
+        fw.writeDataBriefSection((int32_t)m_daughterIDs[trk.daughtersBegin+i]);
     }
 
     //Register pdg codes so we get their properties written out:
@@ -413,9 +677,18 @@ namespace G4DataCollectInternals {
                                    //only see the steps at the start of a segment up here.
         assert(step.volIdx!=EvtFile::INDEX_MAX);//all steps should have this info by now
 
-        //we have a segment with steps running from *itStep to step.segmentEnd:
-        unsigned nsegsteps = step.segmentEnd - istep;
+        //we have a segment with steps running from *itStep to step.segmentEnd
+        //(each possibly coalesced from several original steps):
+        unsigned nsegsteps = 0;
+        for (unsigned i = istep; i < step.segmentEnd; ++i)
+          nsegsteps += m_steps[i]->nCoalesced;
         assert(nsegsteps>0);//otherwise how did the segment get defined...
+        //Selected segments keep full step data in REDUCED and MINIMAL modes,
+        //unless some of their steps were nevertheless coalesced (which can
+        //happen when a track is suspended and resumed within the segment):
+        GriffFormat::Format::MODE segmode = m_mode;
+        if (step.keepFull && nsegsteps==step.segmentEnd-istep)
+          segmode = GriffFormat::Format::MODE_FULL;
         assert(nsegsteps<INT32_MAX);//the sign bit is reserved for other purposes...
         fw.writeDataBriefSection((double)step.preStep.time);//time_start
         fw.writeDataBriefSection((double)step.preStep.eKin);//ekin_start
@@ -426,7 +699,7 @@ namespace G4DataCollectInternals {
         DCStepData & laststep = *(m_steps[step.segmentEnd-1]);
         if (laststep.postStep.atVolEdge) volinfo |= 0x80000000;
         bool nextWasFiltered(false);
-        if (step.segmentEnd!=trk.stepEnd&&laststep.stepNbr + 1 != m_steps[step.segmentEnd/*first on next segment*/]->stepNbr) {
+        if (step.segmentEnd!=trk.stepEnd&&laststep.lastStepNbr() + 1 != m_steps[step.segmentEnd/*first on next segment*/]->stepNbr) {
           //This is a segment whose last step due to filtering does not
           //immediately preceede the first step of the next segment
           volinfo |= 0x20000000;
@@ -437,7 +710,7 @@ namespace G4DataCollectInternals {
         static_assert(sizeof(EvtFile::index_type)>=4);
         fw.writeDataBriefSection(volinfo);
 
-        if (m_mode==GriffFormat::Format::MODE_MINIMAL)
+        if (segmode==GriffFormat::Format::MODE_MINIMAL)
           fw.writeDataBriefSection(-((int32_t)nsegsteps));//minimal mode: put -nsegsteps where other modes put a step position
         else {
           assert(fw.sizeFullDataSection()<INT32_MAX);
@@ -446,17 +719,17 @@ namespace G4DataCollectInternals {
         unsigned segmentEnd = step.segmentEnd;
         double edep(0), edep_nonion(0), stepLength(0);
         std::uint32_t lastStepStatus(fUndefined);
-        if (m_mode!=GriffFormat::Format::MODE_MINIMAL)
+        if (segmode!=GriffFormat::Format::MODE_MINIMAL)
           {
             //put nsegsteps info in step section:
             fw.writeDataFullSection((std::uint32_t)nsegsteps);//nsegsteps_orig
-            fw.writeDataFullSection((std::uint32_t)(m_mode==GriffFormat::Format::MODE_FULL ? nsegsteps : 1));//nsegsteps_stored
+            fw.writeDataFullSection((std::uint32_t)(segmode==GriffFormat::Format::MODE_FULL ? nsegsteps : 1));//nsegsteps_stored
             static_assert(GriffFormat::Format::SIZE_STEPHEADER==2*sizeof(std::uint32_t));
           }
-        if (m_mode==GriffFormat::Format::MODE_REDUCED) {
+        if (segmode==GriffFormat::Format::MODE_REDUCED) {
           //prestep from the first step
           assert(istep<nsteps);
-          step.preStep.write(fw);
+          writeStepPoint(fw,step.preStep,true);
         }
         unsigned nsteps_onsegment = 0;
         for (;istep!=segmentEnd;++istep) {
@@ -465,34 +738,27 @@ namespace G4DataCollectInternals {
           edep_nonion += sstep.eDepNonIonizing;
           stepLength += sstep.stepLength;
           lastStepStatus = sstep.stepStatus;
-          ++nsteps_onsegment;
-          if (m_mode!=GriffFormat::Format::MODE_FULL)
+          nsteps_onsegment += sstep.nCoalesced;
+          if (segmode!=GriffFormat::Format::MODE_FULL)
             continue;
+          assert(sstep.nCoalesced==1);
           assert(istep<nsteps);
-          sstep.preStep.write(fw);
-          fw.writeDataFullSection(float(sstep.eDep));
-          fw.writeDataFullSection(float(sstep.eDepNonIonizing));
-          fw.writeDataFullSection(float(sstep.stepLength));
-          fw.writeDataFullSection(std::uint32_t(sstep.stepStatus));//waste of 3.5 bytes...
-          static_assert(GriffFormat::Format::SIZE_STEPOTHERPART==3*sizeof(float)+sizeof(std::uint32_t));
+          writeStepPoint(fw,sstep.preStep,&sstep==&step);
+          writeStepOtherPart(fw,sstep.eDep,sstep.eDepNonIonizing,sstep.stepLength,sstep.stepStatus);
           if (istep+1==segmentEnd) {
             //Only the last step needs postStep, the other ones can read the first part of the next steps.
             assert(istep<nsteps);
-            sstep.postStep.write(fw);
+            writeStepPoint(fw,sstep.postStep,false);
           }
         }
-        if (m_mode==GriffFormat::Format::MODE_REDUCED) {
-          //sum of all edep's:
-          fw.writeDataFullSection((float)edep);
-          fw.writeDataFullSection((float)edep_nonion);
-          fw.writeDataFullSection(float(stepLength));
-          fw.writeDataFullSection(std::uint32_t(nsteps_onsegment == 1 ? lastStepStatus : std::uint32_t(fUndefined)));//step status undefined for coalesced steps
-          static_assert(GriffFormat::Format::SIZE_STEPOTHERPART==3*sizeof(float)+sizeof(std::uint32_t));
+        if (segmode==GriffFormat::Format::MODE_REDUCED) {
+          //sum of all edep's (step status undefined for coalesced steps):
+          writeStepOtherPart(fw,edep,edep_nonion,stepLength,nsteps_onsegment == 1 ? lastStepStatus : std::uint32_t(fUndefined));
           //poststep from the last step
 
           assert(istep==segmentEnd);
           assert(istep-1<nsteps);
-          m_steps[istep-1]->postStep.write(fw);
+          writeStepPoint(fw,m_steps[istep-1]->postStep,false);
         }
         //finish up the segment info:
         fw.writeDataBriefSection((float)edep);
@@ -512,7 +778,7 @@ namespace G4DataCollectInternals {
     }
 
     m_mgr->flushEventToDisk();
-    clearSteps();
+    clearEvent();
 
     //A few compile-time sanity checks:
     static_assert(sizeof(double)==8);
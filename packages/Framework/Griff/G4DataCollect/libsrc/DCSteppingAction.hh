@@ -2,20 +2,25 @@
 #define G4DataCollect_DCSteppingAction_hh
 
 #include "GriffFormat/Format.hh"
+#include "EvtFile/Codec.hh"
 #include "G4Interfaces/StepFilterBase.hh"
 #include "G4UserSteppingAction.hh"
 #include "DCStepData.hh"
+#include "DCEventVeto.hh"
 #include "Utils/StringSort.hh"
+#include "Utils/FastLookupSet.hh"
 #include <vector>
 #include <deque>
 class G4Event;
 class G4VPhysicalVolume;
+class G4LogicalVolume;
 
 namespace G4DataCollectInternals {
   class DCSteppingAction : public G4UserSteppingAction
   {
   public:
-    DCSteppingAction(const char* outputFile, GriffFormat::Format::MODE mode, G4UserSteppingAction * otherAction);
+    DCSteppingAction(const char* outputFile, GriffFormat::Format::MODE mode, G4UserSteppingAction * otherAction,
+                     const EvtFile::Compression& compression = EvtFile::Compression());
     virtual ~DCSteppingAction();
     void UserSteppingAction(const G4Step*);
     void EndOfEventAction(const G4Event*);//This non-standard method will be invoked by our helpful event action.
@@ -24,8 +29,15 @@ namespace G4DataCollectInternals {
     void setStepFilter(G4Interfaces::StepFilterBase *sf) { assert(sf&&!m_stepFilter); m_stepFilter = sf; m_doFilter=true; }
     void setStepKillFilter(G4Interfaces::StepFilterBase *sf) { assert(sf&&!m_stepKillFilter); m_stepKillFilter = sf; m_doFilter=true; }
     void setMetaData(const std::string& ckey,const std::string& cvalue);
+    void setEventVeto(G4DataCollect::EventVeto *ev) { assert(ev&&!m_eventVeto); m_eventVeto = ev; }
+    std::uint64_t nVetoedEvents() const { return m_nVetoedTotal; }
+    void setFullStepVolumes(const std::string& volumeList);
+    void setFullStepFilter(G4Interfaces::StepFilterBase *sf) { assert(sf&&!m_fullStepFilter); m_fullStepFilter = sf; updateMixedMode(); }
+    void setStepEncoding(GriffFormat::Format::STEPENCODING e) { m_stepEncoding = e; }
+    void startNewFile(const char* outputFile);//must be called between events
   private:
     GriffFormat::Format::MODE m_mode;
+    EvtFile::Compression m_compression;
     G4UserSteppingAction * m_otherAction;
     G4Interfaces::StepFilterBase * m_stepFilter;
     G4Interfaces::StepFilterBase * m_stepKillFilter;
@@ -41,32 +53,111 @@ namespace G4DataCollectInternals {
 
     //File writing managers:
     void initMgr();
+    void openFile();
     DCMgr * m_mgr;
     std::string m_outputFile;
-    struct Track_;
+
+    //Event-scoped buffers used during end of event processing, all kept
+    //across events to avoid allocations:
+    struct Track_
+    {
+      G4int trkId;
+      unsigned nSegments;
+      unsigned segmentsBegin;
+      EvtFile::index_type creatorProcIdx;
+      unsigned stepBegin;
+      unsigned stepEnd;
+      unsigned nDaughters;
+      unsigned daughtersBegin;//index in m_daughterIDs
+    };
+    std::vector<Track_> m_tracks;
+    std::vector<G4int> m_daughterIDs;
+    std::vector<std::pair<std::uint64_t,DCStepData*> > m_sortBuffer[2];
+    std::vector<double> m_touchableEDeps;//indexed by touchable index
+    DCEventSummary::TouchableList m_touchablesVisited;
+    void sortSteps();
+    void clearEvent();
+
+    //Small open-addressing hash set for unique pdg codes:
+    class PDGCodeSet {
+    public:
+      PDGCodeSet() : m_table(64,s_empty) {}
+      void insert(std::int32_t);
+      void clear();
+      std::vector<std::int32_t>& codes() { return m_codes; }//in order of insertion
+    private:
+      static constexpr std::int64_t s_empty = INT64_MIN;
+      std::size_t slot(std::int32_t) const;
+      std::vector<std::int64_t> m_table;//size is a power of two
+      std::vector<std::int32_t> m_codes;
+    };
+    PDGCodeSet m_pdgCodes;
+
+    //Optional veto of events after the first pass over the steps:
+    G4DataCollect::EventVeto * m_eventVeto;
+    DCEventSummary m_eventSummary;
+    std::uint32_t m_nVetoedSinceWritten;
+    std::uint64_t m_nVetoedTotal;
+
+    //Segments keeping full step data in REDUCED and MINIMAL modes, selected
+    //by (logical) volume name and/or a filter applied to their first step:
+    Utils::FastLookupSet<std::string> m_fullStepVolumes;
+    G4Interfaces::StepFilterBase * m_fullStepFilter;
+    bool m_mixedMode;
+    const G4LogicalVolume * m_lastFullStepVol;
+    bool m_lastFullStepVolResult;
+    void updateMixedMode();
+    bool keepFullSteps(const G4Step*);
+
+    //Encoding of step points and the rest of the steps in the full data
+    //section (see GriffFormat::Format::STEPENCODING_COMPACT):
+    GriffFormat::Format::STEPENCODING m_stepEncoding;
+    double m_compactRef[4];//position and time of the previous step point as decoded by readers
+    void writeStepPoint(EvtFile::FileWriter&, DCStepData::EndPointData&, bool firstOnSegment);
+    void writeStepOtherPart(EvtFile::FileWriter&, double eDep, double eDepNonIonizing, double stepLength, std::uint32_t stepStatus);
 
     std::vector<DCStepData*> m_steps;
-    std::deque<DCStepData> m_mempool_steps;
+    std::deque<DCStepData> m_mempool_steps;//kept across events
+    std::size_t m_mempool_nused;
+
+    //Coalesce steps on the fly in REDUCED and MINIMAL modes (set
+    //DGCODE_GRIFF_NOCOALESCE to keep all steps until the end of the event
+    //instead), so memory usage scales with the number of segments rather
+    //than the number of steps:
+    bool m_coalesceSteps;
+    DCStepData * m_openStep;//last recorded step object
 
     DCStepData * mempoolGetStepObject()
     {
       //"All iterators related to this container are invalidated, but pointers
       //and references remain valid, referring to the same elements they were
       //referring to before the call."
-      m_mempool_steps.emplace_back();
+      if (m_mempool_nused==m_mempool_steps.size())
+        m_mempool_steps.emplace_back();
+      DCStepData * s = &m_mempool_steps[m_mempool_nused++];
 #ifdef GRIFF_EXTRA_TESTS
-      assert(!m_mempool_steps.back().valid());
+      assert(!s->valid());
 #endif
-      return &m_mempool_steps.back();
+      return s;
+    }
+    void mempoolReleaseLastStepObject()
+    {
+      assert(m_mempool_nused>0);
+      m_mempool_steps[--m_mempool_nused].clear();
     }
     void clearSteps()
     {
-      assert(m_steps.size()==m_mempool_steps.size());
+      assert(m_steps.size()==m_mempool_nused);
       auto itE=m_steps.end();
       for (auto it=m_steps.begin();it!=itE;++it)
         (*it)->clear();
       m_steps.clear();
-      m_mempool_steps.clear();
+      //Keep the step objects for the next event, unless this was an
+      //exceptionally large event:
+      if (m_mempool_steps.size()>16384&&m_mempool_nused<m_mempool_steps.size()/8)
+        m_mempool_steps.resize(std::max<std::size_t>(16384,m_mempool_nused*2));
+      m_mempool_nused = 0;
+      m_openStep = 0;
     }
 
   };
@@ -2,17 +2,24 @@
 #include "G4DataCollect/G4DataCollect.hh"
 #include "DCSteppingAction.hh"
 #include "DCEventAction.hh"
+#include "ExprParser/Exception.hh"
 
 #include "G4RunManager.hh"
+#include "G4Types.hh"
 #include <stdexcept>
+#ifdef G4MULTITHREADED
+#  include "G4Threading.hh"
+#endif
 
 namespace G4DataCollectInternals
 {
-  static DCSteppingAction * s_stepact = 0;
-  static DCEventAction * s_evtact = 0;
+  //Per thread, so each worker thread of a multi-threaded Geant4 run gets its
+  //own actions and output file:
+  static G4ThreadLocal DCSteppingAction * s_stepact = 0;
+  static G4ThreadLocal DCEventAction * s_evtact = 0;
 }
 
-void G4DataCollect::installHooks(const char* outputFile, const char* mode)
+void G4DataCollect::installHooks(const char* outputFile, const char* mode, const char* compression)
 {
 
   std::map<std::string, GriffFormat::Format::MODE> modemap;
@@ -26,6 +33,16 @@ void G4DataCollect::installHooks(const char* outputFile, const char* mode)
     return;
   }
 
+  EvtFile::Compression comp = EvtFile::parseCompression(compression);//throws in case of invalid input
+
+#ifdef G4MULTITHREADED
+  //Events are only processed in the worker threads, so hooks installed in the
+  //master thread would silently never write anything:
+  if (G4Threading::IsMultithreadedApplication()&&!G4Threading::IsWorkerThread())
+    throw std::logic_error("G4DataCollect::installHooks must be called in the worker threads of a multi-threaded Geant4 application"
+                           " (e.g. in G4VUserActionInitialization::Build), not in the master thread");
+#endif
+
   //For efficiency we use a class derived from G4UserSteppingAction as the
   //book-keeping class. We use a helper G4UserEventAction to provide an
   //EndOfEventAction hook as well.
@@ -37,7 +54,7 @@ void G4DataCollect::installHooks(const char* outputFile, const char* mode)
   G4UserSteppingAction * existingStepAct = const_cast<G4UserSteppingAction*>(rm->GetUserSteppingAction());
   G4UserEventAction * existingEventAct = const_cast<G4UserEventAction*>(rm->GetUserEventAction());
 
-  G4DataCollectInternals::s_stepact = new G4DataCollectInternals::DCSteppingAction(outputFile,modemap[mode],existingStepAct);
+  G4DataCollectInternals::s_stepact = new G4DataCollectInternals::DCSteppingAction(outputFile,modemap[mode],existingStepAct,comp);
   G4DataCollectInternals::s_evtact = new G4DataCollectInternals::DCEventAction(G4DataCollectInternals::s_stepact,existingEventAct);
 
   rm->SetUserAction(G4DataCollectInternals::s_stepact);
@@ -72,6 +89,62 @@ void G4DataCollect::setStepKillFilter(G4Interfaces::StepFilterBase*sf)
   G4DataCollectInternals::s_stepact->setStepKillFilter(sf);
 }
 
+void G4DataCollect::setStepEncoding(const char* encoding)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setStepEncoding");
+  std::string enc(encoding);
+  if (enc=="STANDARD")
+    G4DataCollectInternals::s_stepact->setStepEncoding(GriffFormat::Format::STEPENCODING_STANDARD);
+  else if (enc=="COMPACT")
+    G4DataCollectInternals::s_stepact->setStepEncoding(GriffFormat::Format::STEPENCODING_COMPACT);
+  else {
+    printf("G4DataCollect::setStepEncoding ERROR: encoding must be one of \"STANDARD\" or \"COMPACT\". It was instead \"%s\"\n",encoding);
+    throw std::runtime_error("Invalid Griff step encoding");
+  }
+  setMetaData("GriffStepEncoding",enc);
+}
+
+void G4DataCollect::setFullStepVolumes(const std::string& volumeList)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setFullStepVolumes");
+  G4DataCollectInternals::s_stepact->setFullStepVolumes(volumeList);
+  setMetaData("GriffFullStepVolumes",volumeList);
+}
+
+void G4DataCollect::setFullStepFilter(G4Interfaces::StepFilterBase*sf)
+{
+  assert(sf);
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setFullStepFilter");
+  G4DataCollectInternals::s_stepact->setFullStepFilter(sf);
+  setMetaData("GriffFullStepFilterName",sf->getName());
+}
+
+void G4DataCollect::setEventVeto(EventVeto*ev)
+{
+  assert(ev);
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setEventVeto");
+  G4DataCollectInternals::s_stepact->setEventVeto(ev);
+}
+
+void G4DataCollect::setEventVeto(const std::string& expression)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setEventVeto");
+  G4DataCollectInternals::DCEventVetoExpr * ev;
+  try {
+    ev = new G4DataCollectInternals::DCEventVetoExpr(expression);
+  } catch (ExprParser::InputError& e) {
+    printf("G4DataCollect::setEventVeto ERROR: %s in veto expression : %s\n",e.epType(),e.epWhat());
+    throw std::runtime_error("Invalid event veto expression");
+  }
+  G4DataCollectInternals::s_stepact->setEventVeto(ev);
+  setMetaData("eventVeto",expression);
+}
+
+std::uint64_t G4DataCollect::nVetoedEvents()
+{
+  return G4DataCollectInternals::s_stepact ? G4DataCollectInternals::s_stepact->nVetoedEvents() : 0;
+}
+
 void G4DataCollect::finish()
 {
   G4RunManager * rm = G4RunManager::GetRunManager();
@@ -80,15 +153,23 @@ void G4DataCollect::finish()
       G4UserEventAction * existingEvtAct = G4DataCollectInternals::s_evtact->otherAction();
       rm->SetUserAction(existingEvtAct);
       delete G4DataCollectInternals::s_evtact;
+      G4DataCollectInternals::s_evtact = 0;
     }
   if (G4DataCollectInternals::s_stepact)
     {
       G4UserSteppingAction * existingStepAct = G4DataCollectInternals::s_stepact->otherAction();
       rm->SetUserAction(existingStepAct);
       delete G4DataCollectInternals::s_stepact;//This also closes any open output file
+      G4DataCollectInternals::s_stepact = 0;
     }
 }
 
+void G4DataCollect::startNewFile(const char* outputFile)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before startNewFile");
+  G4DataCollectInternals::s_stepact->startNewFile(outputFile);
+}
+
 void G4DataCollect::setMetaData(const std::string& key,const std::string& value)
 {
   assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setMetaData");
@@ -103,9 +184,7 @@ void G4DataCollect::setMetaData(const std::string& key,const std::string& value)
 void G4DataCollect::setUserData(const std::string& key,const std::string& value)
 {
   assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setUserData");
-  static std::string tmp;
-  tmp.clear();
-  tmp+="^";
+  std::string tmp("^");
   tmp+=key;
   G4DataCollectInternals::s_stepact->setMetaData(tmp.c_str(),value);
 }
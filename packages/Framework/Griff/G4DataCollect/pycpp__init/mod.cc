@@ -10,4 +10,14 @@ PYTHON_MODULE( mod )
   mod.def("finish",&G4DataCollect::finish,"Uninstall hooks and close output file.");
   mod.def("setMetaData",&G4DataCollect::setMetaData);
   mod.def("setUserData",&G4DataCollect::setUserData);
+  mod.def("setStepEncoding",&G4DataCollect::setStepEncoding,
+          "Select encoding of step data (STANDARD or COMPACT).",
+          py::arg("encoding"));
+  mod.def("setFullStepVolumes",&G4DataCollect::setFullStepVolumes,
+          "Keep full step data for segments in the listed volumes in REDUCED and MINIMAL modes.",
+          py::arg("volumeList"));
+  mod.def("setEventVeto",[](const std::string& expression) { G4DataCollect::setEventVeto(expression); },
+          "Veto events for which the expression is true, so they are not written to the output file.",
+          py::arg("expression"));
+  mod.def("nVetoedEvents",&G4DataCollect::nVetoedEvents);
 }
@@ -0,0 +1,165 @@
+#include "GriffFormat/Format.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "EvtFile/Codec.hh"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <sys/stat.h>
+
+//Benchmark write/read throughput and resulting file size of the available
+//codecs for the full data section, by re-encoding the events of a reference
+//Griff file.
+
+namespace {
+  struct EventData {
+    std::int32_t run, evt;
+    std::vector<char> db, brief, full;
+  };
+  double secondsSince(std::chrono::steady_clock::time_point t0)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  }
+  //Whether the library of the codec in a compression string like "lz4-9" can
+  //be loaded (checked before parseCompression, which throws if not):
+  bool codecLibAvailable(const std::string& compression)
+  {
+    for (std::uint32_t codec : { EvtFile::CODEC_LZ4, EvtFile::CODEC_ZSTD })
+      if (compression.compare(0,std::strlen(EvtFile::codecName(codec)),EvtFile::codecName(codec))==0)
+        return EvtFile::codecAvailable(codec);
+    return true;
+  }
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> args(argv+1, argv+argc);
+  bool request_help( std::find(args.begin(), args.end(), "-h") != args.end()
+                     || std::find(args.begin(), args.end(), "--help") != args.end() );
+  if (request_help || args.empty() || args.size()>2 ) {
+    printf("\nUsage:\n\n  %s GRIFFINPUT [NREPEAT]\n\n"
+           "Reads all events of the existing file GRIFFINPUT into memory and writes\n"
+           "them NREPEAT times (default 10) with each available codec to files named\n"
+           "benchcodecs_<codec>.griff in the current directory, which are then read\n"
+           "back. Reports write and read throughput (in uncompressed MB/s) and file\n"
+           "size for each codec.\n"
+           "\nExample:\n\n"
+           "  %s myfile.griff 100\n\n",
+           argv[0],argv[0]);
+    return request_help ? 0 : 1;
+  }
+  unsigned nrepeat = 10;
+  if (args.size()==2) {
+    std::size_t pos;
+    nrepeat = (unsigned)stoul(args[1],&pos);
+    if (pos!=args[1].size()||!nrepeat) {
+      printf("ERROR: Invalid NREPEAT value!\n");
+      return 1;
+    }
+  }
+
+  //Load reference sample:
+  const EvtFile::IFormat * format = GriffFormat::Format::getFormat();
+  std::vector<EventData> evts;
+  std::uint64_t nbytesfull(0);
+  {
+    EvtFile::FileReader fr(format,args[0].c_str());
+    if (!fr.init()||!fr.ok()) {
+      printf("ERROR: Problems opening input file: %s\n",fr.bad_reason());
+      return 1;
+    }
+    for (;fr.eventActive();fr.goToNextEvent()) {
+      evts.emplace_back();
+      EventData& e = evts.back();
+      e.run = fr.runNumber();
+      e.evt = fr.eventNumber();
+      fr.getSharedDataInEvent(e.db);
+      e.brief.assign(fr.getBriefData(),fr.getBriefData()+fr.nBytesBriefData());
+      e.full.assign(fr.getFullData(),fr.getFullData()+fr.nBytesFullData());
+      nbytesfull += e.full.size();
+      if (!fr.ok()) {
+        printf("ERROR: Problems reading input file: %s\n",fr.bad_reason());
+        return 1;
+      }
+    }
+  }
+  if (evts.empty()) {
+    printf("ERROR: No events in input file\n");
+    return 1;
+  }
+  const double mbfull = 1e-6 * nbytesfull * nrepeat;
+  printf("Loaded %llu events with %.2f MB of full data (uncompressed). Repeating %u times.\n\n",
+         (unsigned long long)evts.size(),1e-6*nbytesfull,nrepeat);
+
+  const char * codecs[] = { "none", "zlib-1", "zlib", "zlib-9", "zlib/64k",
+                            "lz4", "lz4-9", "lz4/64k", "zstd-1", "zstd", "zstd-19", "zstd/64k" };
+  printf("  %-8s %14s %14s %14s %10s\n","Codec","Write[MB/s]","Read[MB/s]","FileSize[MB]","Size/Full");
+  for (const char * codec : codecs) {
+    if (!codecLibAvailable(codec)) {
+      printf("  %-8s %14s\n",codec,"(unavailable)");
+      continue;
+    }
+    std::string outfile = std::string("benchcodecs_") + codec + format->fileExtension();
+    std::replace(outfile.begin(),outfile.end(),'/','_');
+
+    auto t0 = std::chrono::steady_clock::now();
+    {
+      EvtFile::FileWriter fw(format,outfile.c_str());
+      if (!fw.ok()) {
+        printf("ERROR: Problems opening output file %s\n",outfile.c_str());
+        return 1;
+      }
+      fw.setCompression(EvtFile::parseCompression(codec));
+      for (unsigned irep = 0; irep < nrepeat; ++irep) {
+        for (auto& e : evts) {
+          if (irep==0&&!e.db.empty())
+            fw.writeDataDBSection(&e.db[0],e.db.size());//shared data only needed once
+          if (!e.brief.empty())
+            fw.writeDataBriefSection(&e.brief[0],e.brief.size());
+          if (!e.full.empty())
+            fw.writeDataFullSection(&e.full[0],e.full.size());
+          fw.flushEventToDisk(e.run,e.evt);
+        }
+      }
+      fw.close();
+    }
+    double twrite = secondsSince(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    std::uint64_t nread(0);
+    {
+      EvtFile::FileReader fr(format,outfile.c_str());
+      if (!fr.init()) {
+        printf("ERROR: Problems reading back file %s: %s\n",outfile.c_str(),fr.bad_reason());
+        return 1;
+      }
+      for (;fr.eventActive();fr.goToNextEvent()) {
+        fr.getFullData();
+        nread += fr.nBytesFullData();
+      }
+      if (!fr.ok()) {
+        printf("ERROR: Problems reading back file %s: %s\n",outfile.c_str(),fr.bad_reason());
+        return 1;
+      }
+    }
+    double tread = secondsSince(t0);
+    if (nread!=nbytesfull*nrepeat) {
+      printf("ERROR: Data read back from %s differs in size from data written\n",outfile.c_str());
+      return 1;
+    }
+
+    struct stat st;
+    if (stat(outfile.c_str(),&st)!=0) {
+      printf("ERROR: Could not stat file %s\n",outfile.c_str());
+      return 1;
+    }
+    printf("  %-8s %14.1f %14.1f %14.3f %10.2f\n",codec,
+           mbfull/std::max(twrite,1e-9),mbfull/std::max(tread,1e-9),
+           1e-6*st.st_size,1e-6*st.st_size/std::max(mbfull,1e-9));
+  }
+  return 0;
+}
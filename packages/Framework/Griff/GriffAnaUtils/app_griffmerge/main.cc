@@ -0,0 +1,539 @@
+#include "GriffFormat/Format.hh"
+#include "GriffFormat/ParticleDefinition.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "EvtFile/Codec.hh"
+#include "EvtFile/DBEntryWriter.hh"
+#include "EvtFile/DBStringsWriter.hh"
+#include "EvtFile/IDBEntry.hh"
+#include "Utils/ByteStream.hh"
+#include "Utils/Glob.hh"
+#include "Core/File.hh"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+
+//Merge Griff files into a single file. Rather than simply concatenating the
+//events, the database sections of the input files are merged, so that
+//entries (volumes, materials, particles, process names, meta data, ...)
+//present in several input files are written just once. References to the
+//database entries in the track and step data of the events are re-indexed
+//accordingly, directly in the raw data (tracks and steps are never decoded
+//into objects).
+
+namespace {
+
+  typedef EvtFile::index_type index_type;
+  typedef GriffFormat::Format GF;
+
+  void corrupted(const char * what)
+  {
+    printf("ERROR: Corrupted input data (%s)\n",what);
+    throw std::runtime_error("Corrupted input data");
+  }
+
+  //Entry for a DBEntryWriter, given directly by its (re-indexed) raw data:
+  class RawEntry : public EvtFile::IDBEntry {
+  public:
+    RawEntry(std::string&& data) : m_data(std::move(data)) {}
+    virtual void write(EvtFile::FileWriter& fw)
+    {
+      if (!m_data.empty())
+        fw.writeDataDBSection(m_data.data(),m_data.size());
+    }
+  protected:
+    virtual unsigned calculateHash() const { return std::hash<std::string>()(m_data); }
+    virtual bool lessThan(const IDBEntry& o) const { return m_data < static_cast<const RawEntry&>(o).m_data; }
+    virtual bool equals(const IDBEntry& o) const { return m_data == static_cast<const RawEntry&>(o).m_data; }
+  private:
+    std::string m_data;
+  };
+
+  //Particle definitions are referenced by pdg code rather than by index, so
+  //they simply need to be written out once per pdg code:
+  class PDGCodeWriter : public EvtFile::IDBSubSectionWriter {
+  public:
+    PDGCodeWriter(EvtFile::FileWriter& fw) : IDBSubSectionWriter(fw) {}
+    virtual EvtFile::subsectid_type uniqueSubSectionID() const { return GF::subsectid_pdgcodes; }
+    virtual bool needsWrite() const { return !m_toWrite.empty(); }
+    void add(const GriffFormat::ParticleDefinition& pdef)
+    {
+      auto it = m_known.find(pdef.pdgcode);
+      if (it==m_known.end()) {
+        m_known[pdef.pdgcode] = pdef;
+        m_toWrite.push_back(pdef);
+      } else if (it->second!=pdef) {
+        printf("WARNING: Inconsistent definitions of particle with pdg code %i in input files (keeping the first)\n",
+               (int)pdef.pdgcode);
+      }
+    }
+    virtual void write(EvtFile::FileWriter& fw)
+    {
+      fw.writeDataDBSection((std::uint8_t)0);//version
+      fw.writeDataDBSection((std::uint32_t)m_toWrite.size());//number of pdg entries
+      for (auto& pdef : m_toWrite)
+        pdef.write(fw);
+      m_toWrite.clear();
+    }
+  private:
+    std::map<std::int32_t,GriffFormat::ParticleDefinition> m_known;
+    std::vector<GriffFormat::ParticleDefinition> m_toWrite;
+  };
+
+  //Receives the database sections of the input files and adds their entries
+  //to the database of the output file, keeping track of how indices in the
+  //current input file map to indices in the output file:
+  class DBMerger : public EvtFile::EvtFileDB {
+  public:
+    DBMerger(EvtFile::FileWriter& fw)
+      : m_dbTouchables(GF::subsectid_touchables,fw),
+        m_dbVolNames(GF::subsectid_volnames,fw),
+        m_dbMaterials(GF::subsectid_materials,fw),
+        m_dbElements(GF::subsectid_elements,fw),
+        m_dbIsotopes(GF::subsectid_isotopes,fw),
+        m_dbMaterialNames(GF::subsectid_materialnames,fw),
+        m_dbElementNames(GF::subsectid_elementnames,fw),
+        m_dbIsotopeNames(GF::subsectid_isotopenames,fw),
+        m_dbProcNames(GF::subsectid_procnames,fw),
+        m_dbPDGCodes(fw),
+        m_dbPDGNames(GF::subsectid_pdgnames,fw),
+        m_dbPDGTypes(GF::subsectid_pdgtypes,fw),
+        m_dbPDGSubTypes(GF::subsectid_pdgsubtypes,fw),
+        m_dbMetaData(GF::subsectid_metadata,fw),
+        m_dbMetaDataStrings(GF::subsectid_metadatastrings,fw)
+    {
+      m_strings[GF::subsectid_volnames] = &m_dbVolNames;
+      m_strings[GF::subsectid_materialnames] = &m_dbMaterialNames;
+      m_strings[GF::subsectid_elementnames] = &m_dbElementNames;
+      m_strings[GF::subsectid_isotopenames] = &m_dbIsotopeNames;
+      m_strings[GF::subsectid_procnames] = &m_dbProcNames;
+      m_strings[GF::subsectid_pdgnames] = &m_dbPDGNames;
+      m_strings[GF::subsectid_pdgtypes] = &m_dbPDGTypes;
+      m_strings[GF::subsectid_pdgsubtypes] = &m_dbPDGSubTypes;
+      m_strings[GF::subsectid_metadatastrings] = &m_dbMetaDataStrings;
+    }
+
+    //Output index of entry with index idx in sub-section subsectid of the current input file:
+    index_type remap(unsigned subsectid, index_type idx) const
+    {
+      auto it = m_indexMaps.find(subsectid);
+      if (it==m_indexMaps.end()||idx>=it->second.size())
+        corrupted("reference to unknown database entry");
+      return it->second[idx];
+    }
+
+    virtual void clearInfo() { m_indexMaps.clear(); }
+
+    virtual void newInfoAvailable(const char* data, unsigned nbytes)
+    {
+      //Entries might refer to entries in other sub-sections appearing later in
+      //the same DB section, so collect everything before adding entries in
+      //the order of their dependencies:
+      std::map<unsigned,std::vector<std::string> > pending;
+      const char * dataE = data + nbytes;
+      while (data<dataE) {
+        std::uint16_t subsectid;
+        read(data,dataE,subsectid);
+        std::vector<std::string>& entries = pending[subsectid];
+        if (m_strings.count(subsectid))
+          readStrings(data,dataE,entries);
+        else if (subsectid==GF::subsectid_pdgcodes)
+          readPDGCodes(data,dataE,entries);
+        else
+          readEntries(subsectid,data,dataE,entries);
+      }
+      for (auto& e : m_strings) {
+        std::vector<index_type>& idxmap = m_indexMaps[e.first];
+        for (auto& s : pending[e.first])
+          idxmap.push_back(e.second->getIndex(s));
+      }
+      addEntries(GF::subsectid_isotopes,m_dbIsotopes,pending);
+      addEntries(GF::subsectid_elements,m_dbElements,pending);
+      addEntries(GF::subsectid_materials,m_dbMaterials,pending);
+      addEntries(GF::subsectid_touchables,m_dbTouchables,pending);
+      addEntries(GF::subsectid_metadata,m_dbMetaData,pending);
+      for (auto& s : pending[GF::subsectid_pdgcodes]) {
+        const char * p = s.data();
+        GriffFormat::ParticleDefinition pdef(p);
+        pdef.nameIdx = remap(GF::subsectid_pdgnames,pdef.nameIdx);
+        pdef.typeIdx = remap(GF::subsectid_pdgtypes,pdef.typeIdx);
+        pdef.subTypeIdx = remap(GF::subsectid_pdgsubtypes,pdef.subTypeIdx);
+        m_dbPDGCodes.add(pdef);
+      }
+    }
+
+  private:
+    //Writers in the same order as in G4DataCollect:
+    EvtFile::DBEntryWriter m_dbTouchables;
+    EvtFile::DBStringsWriter m_dbVolNames;
+    EvtFile::DBEntryWriter m_dbMaterials;
+    EvtFile::DBEntryWriter m_dbElements;
+    EvtFile::DBEntryWriter m_dbIsotopes;
+    EvtFile::DBStringsWriter m_dbMaterialNames;
+    EvtFile::DBStringsWriter m_dbElementNames;
+    EvtFile::DBStringsWriter m_dbIsotopeNames;
+    EvtFile::DBStringsWriter m_dbProcNames;
+    PDGCodeWriter m_dbPDGCodes;
+    EvtFile::DBStringsWriter m_dbPDGNames;
+    EvtFile::DBStringsWriter m_dbPDGTypes;
+    EvtFile::DBStringsWriter m_dbPDGSubTypes;
+    EvtFile::DBEntryWriter m_dbMetaData;
+    EvtFile::DBStringsWriter m_dbMetaDataStrings;
+    std::map<unsigned,EvtFile::DBStringsWriter*> m_strings;
+    std::map<unsigned,std::vector<index_type> > m_indexMaps;
+
+    template<class T>
+    static void read(const char*& data, const char* dataE, T& t)
+    {
+      if (dataE-data<(long)sizeof(T))
+        corrupted("truncated database section");
+      ByteStream::read(data,t);
+    }
+
+    static void readStrings(const char*& data, const char* dataE, std::vector<std::string>& out)
+    {
+      std::uint16_t version, n;
+      read(data,dataE,version);
+      read(data,dataE,n);
+      if (version!=0)
+        corrupted("unsupported version of string database");
+      for (unsigned i = 0; i < n; ++i) {
+        std::uint16_t l;
+        read(data,dataE,l);
+        if (dataE-data<l)
+          corrupted("truncated database section");
+        out.emplace_back(data,l);
+        data += l;
+      }
+    }
+
+    static void readPDGCodes(const char*& data, const char* dataE, std::vector<std::string>& out)
+    {
+      std::uint8_t version;
+      std::uint32_t n;
+      read(data,dataE,version);
+      read(data,dataE,n);
+      if (version!=0)
+        corrupted("unsupported version of particle database");
+      for (unsigned i = 0; i < n; ++i) {
+        if (dataE-data<(long)sizeof(GriffFormat::ParticleDefinition))
+          corrupted("truncated database section");
+        out.emplace_back(data,sizeof(GriffFormat::ParticleDefinition));
+        data += sizeof(GriffFormat::ParticleDefinition);
+      }
+    }
+
+    //Size of entry in DBEntryWriter sub-sections (see the corresponding
+    //classes in GriffDataRead for the layout):
+    static unsigned entrySize(unsigned subsectid, const char* data, const char* dataE)
+    {
+      const long avail = dataE - data;
+      auto u32at = [data,avail](unsigned offset) -> std::uint32_t
+        {
+          if (avail<long(offset+4))
+            corrupted("truncated database section");
+          return ByteStream::interpret<std::uint32_t>(data+offset);
+        };
+      switch (subsectid) {
+      case GF::subsectid_touchables:
+        if (avail<1)
+          corrupted("truncated database section");
+        return 1 + std::uint8_t(*data) * 16;
+      case GF::subsectid_materials:
+        return 64 + u32at(60) * 12;
+      case GF::subsectid_elements:
+        return 44 + u32at(40) * 12;
+      case GF::subsectid_isotopes:
+        return 28;
+      case GF::subsectid_metadata:
+        return 8 + u32at(4) * 8;
+      default:
+        printf("ERROR: Unknown database sub-section %u in input\n",subsectid);
+        throw std::runtime_error("Unknown database sub-section");
+      }
+    }
+
+    static void readEntries(unsigned subsectid, const char*& data, const char* dataE, std::vector<std::string>& out)
+    {
+      std::uint16_t version;
+      std::uint32_t n;
+      read(data,dataE,version);
+      read(data,dataE,n);
+      if (version!=0)
+        corrupted("unsupported version of database");
+      for (unsigned i = 0; i < n; ++i) {
+        unsigned l = entrySize(subsectid,data,dataE);
+        if (dataE-data<(long)l)
+          corrupted("truncated database section");
+        out.emplace_back(data,l);
+        data += l;
+      }
+    }
+
+    void remapAt(std::string& entry, unsigned offset, unsigned subsectid) const
+    {
+      index_type idx;
+      std::memcpy(&idx,&entry[offset],sizeof(idx));
+      idx = remap(subsectid,idx);
+      std::memcpy(&entry[offset],&idx,sizeof(idx));
+    }
+
+    void addEntries(unsigned subsectid, EvtFile::DBEntryWriter& dbw, std::map<unsigned,std::vector<std::string> >& pending)
+    {
+      std::vector<index_type>& idxmap = m_indexMaps[subsectid];
+      for (auto& e : pending[subsectid]) {
+        switch (subsectid) {
+        case GF::subsectid_touchables:
+          for (unsigned i = 1; i < e.size(); i += 16) {
+            remapAt(e,i+4,GF::subsectid_volnames);
+            remapAt(e,i+8,GF::subsectid_volnames);
+            remapAt(e,i+12,GF::subsectid_materials);
+          }
+          break;
+        case GF::subsectid_materials:
+          remapAt(e,4,GF::subsectid_materialnames);
+          for (unsigned i = 64; i < e.size(); i += 12)
+            remapAt(e,i+8,GF::subsectid_elements);
+          break;
+        case GF::subsectid_elements:
+          remapAt(e,4,GF::subsectid_elementnames);
+          remapAt(e,8,GF::subsectid_elementnames);
+          for (unsigned i = 44; i < e.size(); i += 12)
+            remapAt(e,i+8,GF::subsectid_isotopes);
+          break;
+        case GF::subsectid_isotopes:
+          remapAt(e,4,GF::subsectid_isotopenames);
+          break;
+        case GF::subsectid_metadata:
+          for (unsigned i = 8; i < e.size(); i += 4)
+            remapAt(e,i,GF::subsectid_metadatastrings);
+          break;
+        default:
+          assert(false);
+        }
+        RawEntry * entry = new RawEntry(std::move(e));
+        entry->ref();
+        idxmap.push_back(dbw.getIndex(entry));
+        entry->unref();
+      }
+    }
+  };
+
+  //Re-index references to database entries in the track and step data of an
+  //event, in place:
+  void reindexEvent(const DBMerger& db, std::vector<char>& brief, std::vector<char>& full)
+  {
+    char * data = &brief[0];
+    char * dataE = data + brief.size();
+    auto check = [&dataE](const char * p, unsigned n)
+      {
+        if (dataE-p<long(n))
+          corrupted("truncated track data");
+      };
+    auto remapAt = [&db](char * p, unsigned subsectid)
+      {
+        index_type idx;
+        std::memcpy(&idx,p,sizeof(idx));
+        idx = db.remap(subsectid,idx);
+        std::memcpy(p,&idx,sizeof(idx));
+      };
+    check(data,GF::SIZE_TRACKHEADER);
+    remapAt(data+8,GF::subsectid_metadata);
+    const std::uint32_t ntracks = ByteStream::interpret<std::uint32_t>(data+12);
+    const std::uint32_t modeword = ByteStream::interpret<std::uint32_t>(data+16);
+    data += GF::SIZE_TRACKHEADER;
+    const std::uint32_t stepencoding = (modeword & GF::STEPENCODING_MASK) >> GF::STEPENCODING_SHIFT;
+    if (stepencoding!=GF::STEPENCODING_STANDARD&&stepencoding!=GF::STEPENCODING_COMPACT)
+      corrupted("unknown step encoding");
+    const bool compact = stepencoding==GF::STEPENCODING_COMPACT;
+    if (modeword & GF::MODEFLAG_SUMMARY) {
+      //Touchables in the summary must stay sorted by index:
+      check(data,2*sizeof(std::uint32_t));
+      const std::uint32_t nbytes = ByteStream::interpret<std::uint32_t>(data);
+      const std::uint32_t npdg = ByteStream::interpret<std::uint32_t>(data+4);
+      check(data,nbytes);
+      char * touch = data + 12 + npdg * 4;
+      if (touch>data+nbytes)
+        corrupted("event summary");
+      const std::uint32_t ntouch = ByteStream::interpret<std::uint32_t>(touch-4);
+      const unsigned nvetocount = (modeword & GF::MODEFLAG_VETOCOUNT) ? 4 : 0;
+      if (touch+ntouch*8+nvetocount!=data+nbytes)
+        corrupted("event summary");
+      std::vector<std::pair<index_type,float> > edeps(ntouch);
+      for (auto& te : edeps) {
+        std::memcpy(&te.first,touch,4);
+        std::memcpy(&te.second,touch+4,4);
+        te.first = db.remap(GF::subsectid_touchables,te.first);
+        touch += 8;
+      }
+      std::sort(edeps.begin(),edeps.end());
+      touch -= ntouch*8;
+      for (auto& te : edeps) {
+        std::memcpy(touch,&te.first,4);
+        std::memcpy(touch+4,&te.second,4);
+        touch += 8;
+      }
+      data += nbytes;
+    }
+    std::vector<std::uint32_t> nsegments(ntracks);
+    for (auto& nseg : nsegments) {
+      check(data,GF::SIZE_PER_TRACK_WO_DAUGHTERLIST);
+      remapAt(data+12,GF::subsectid_procnames);//creator process
+      nseg = ByteStream::interpret<std::uint32_t>(data+20);
+      std::uint32_t ndaughters = ByteStream::interpret<std::uint32_t>(data+24);
+      data += GF::SIZE_PER_TRACK_WO_DAUGHTERLIST + ndaughters * GF::SIZE_PER_DAUGHTERLIST_ENTRY;
+    }
+    for (auto nseg : nsegments) {
+      for (unsigned iseg = 0; iseg < nseg; ++iseg) {
+        check(data,GF::SIZE_PER_SEGMENT);
+        index_type volinfo = ByteStream::interpret<index_type>(data+16);
+        volinfo = (volinfo & 0xE0000000) | db.remap(GF::subsectid_touchables,volinfo & 0x1FFFFFFF);
+        std::memcpy(data+16,&volinfo,sizeof(volinfo));
+        std::int32_t rawstep = ByteStream::interpret<std::int32_t>(data+20);
+        if (rawstep>=0) {
+          //Process names of the pre and post step points of all steps:
+          if (full.size()<rawstep+GF::SIZE_STEPHEADER)
+            corrupted("truncated step data");
+          //(which in both encodings are at the end of each step point, with
+          //the first step point always in the standard encoding):
+          const std::uint32_t nsteps = ByteStream::interpret<std::uint32_t>(&full[rawstep+4]);
+          const unsigned stepsize = compact ? GF::SIZE_STEPPREPOSTPART_COMPACT+GF::SIZE_STEPOTHERPART_COMPACT
+                                            : GF::SIZE_STEPPREPOSTPART+GF::SIZE_STEPOTHERPART;
+          const std::uint64_t rawstepE = rawstep + GF::SIZE_STEPHEADER
+            + std::uint64_t(nsteps)*stepsize + GF::SIZE_STEPPREPOSTPART;
+          if (full.size()<rawstepE)
+            corrupted("truncated step data");
+          char * p = &full[rawstep] + GF::SIZE_STEPHEADER + GF::SIZE_STEPPREPOSTPART - sizeof(index_type);
+          for (unsigned i = 0; i <= nsteps; ++i, p += stepsize)
+            remapAt(p,GF::subsectid_procnames);
+        }
+        data += GF::SIZE_PER_SEGMENT;
+        if (volinfo & 0x20000000)
+          data += GF::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;//nextWasFiltered
+      }
+      data += GF::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;
+    }
+    if (data!=dataE)
+      corrupted("unexpected size of track data");
+  }
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> args(argv+1, argv+argc);
+  bool request_help( std::find(args.begin(), args.end(), "-h") != args.end()
+                     || std::find(args.begin(), args.end(), "--help") != args.end() );
+  std::string compression("zlib");
+  bool renumber(false);
+  for (auto it = args.begin(); it!=args.end();) {
+    if (it->compare(0,14,"--compression=")==0)
+      compression = it->substr(14);
+    else if (*it=="--renumber")
+      renumber = true;
+    else {
+      ++it;
+      continue;
+    }
+    it = args.erase(it);
+  }
+  if (request_help || args.size()<2 ) {
+    printf("\nUsage:\n\n  %s [--compression=CODEC] [--renumber] GRIFFOUTPUT GRIFFINPUT1 [GRIFFINPUT2 ...]\n\n"
+           "Merges the events of all the existing GRIFFINPUT files (wildcards allowed)\n"
+           "into the new file GRIFFOUTPUT. Database entries (volumes, materials,\n"
+           "particles, meta data, ...) found in several input files are only written\n"
+           "once to the output, which is thus smaller and faster to read than the\n"
+           "input files. This is for instance useful for the output files of jobs\n"
+           "running in multi-processing mode.\n\n"
+           "The step data is written with the given compression (default \"zlib\", see\n"
+           "G4DataCollect::installHooks). Events keep their run and event numbers,\n"
+           "unless --renumber is specified in which case events are numbered\n"
+           "consecutively from 0.\n"
+           "\nExample:\n\n"
+           "  %s merged.griff output.*.griff\n\n",
+           argv[0],argv[0]);
+    return request_help ? 0 : 1;
+  }
+
+  std::string outfile = args.at(0);
+  std::vector<std::string> infiles;
+  for (auto it = args.begin()+1; it!=args.end(); ++it) {
+    if (it->find('*')!=std::string::npos)
+      Utils::glob(*it,infiles);
+    else
+      infiles.push_back(*it);
+  }
+  if (infiles.empty()) {
+    printf("ERROR: No input files found\n");
+    return 1;
+  }
+  for (auto& f : infiles) {
+    if (!Core::file_exists(f)) {
+      printf("ERROR: Input file does not exist: %s\n",f.c_str());
+      return 1;
+    }
+    if (f==outfile) {
+      printf("ERROR: Output file can not also be an input file: %s\n",f.c_str());
+      return 1;
+    }
+  }
+
+  const EvtFile::IFormat * format = GriffFormat::Format::getFormat();
+  std::uint64_t nevts(0);
+  try {
+    EvtFile::FileWriter fw(format,outfile.c_str());
+    if (!fw.ok()) {
+      printf("ERROR: Problems opening requested output file\n");
+      return 1;
+    }
+    fw.setCompression(EvtFile::parseCompression(compression.c_str()));
+    DBMerger db(fw);
+    fw.setAsync(true);
+    std::vector<char> brief, full;
+    for (auto& f : infiles) {
+      EvtFile::FileReader fr(format,f.c_str(),&db);
+      fr.setReadMode(EvtFile::FileReader::READ_AUTO);
+      fr.setPrefetch(1);
+      if (!fr.init()||!fr.ok()) {
+        printf("ERROR: Problems opening input file %s: %s\n",f.c_str(),fr.bad_reason());
+        return 1;
+      }
+      std::uint64_t nevts_file(0);
+      for (;fr.eventActive();fr.goToNextEvent()) {
+        const char * b = fr.getBriefData();
+        const char * d = fr.getFullData();
+        if (!fr.ok()||!b||!d) {
+          printf("ERROR: Problems reading input file %s: %s\n",f.c_str(),fr.bad_reason());
+          return 1;
+        }
+        brief.assign(b,b+fr.nBytesBriefData());
+        full.assign(d,d+fr.nBytesFullData());
+        reindexEvent(db,brief,full);
+        fw.writeDataBriefSection(&brief[0],brief.size());
+        if (!full.empty())
+          fw.writeDataFullSection(&full[0],full.size());
+        fw.flushEventToDisk(fr.runNumber(),renumber ? int32_t(nevts) : int32_t(fr.eventNumber()));
+        ++nevts;
+        ++nevts_file;
+      }
+      if (fr.bad()) {
+        printf("ERROR: Problems reading input file %s: %s\n",f.c_str(),fr.bad_reason());
+        return 1;
+      }
+      printf("Merged %llu events from %s\n",(unsigned long long)nevts_file,f.c_str());
+    }
+    fw.close();
+  } catch (std::exception& e) {
+    printf("ERROR: Merging failed: %s\n",e.what());
+    return 1;
+  }
+
+  printf("Wrote %llu events from %llu input files to %s\n",
+         (unsigned long long)nevts,(unsigned long long)infiles.size(),outfile.c_str());
+  return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef GriffAnaUtils_GriffParallelLoop_hh
+#define GriffAnaUtils_GriffParallelLoop_hh
+
+#include "GriffDataRead/GriffDataReader.hh"
+#include "SimpleHists/HistCollection.hh"
+#include <functional>
+
+//Multi-threaded event loop over Griff files. The input files are divided into
+//chunks of events (whole files, or ranges of events within the files when
+//there are too few files to keep all threads busy), which are handed out to
+//the worker threads on demand. Each worker has its own GriffDataReader and its
+//own HistCollection, which are merged into a single collection at the end.
+//
+//The user supplied functions are called concurrently from the worker threads
+//and must only modify the HistCollection they are passed (or otherwise take
+//care of synchronising access to shared state). The order in which events are
+//processed is not defined. Example:
+//
+//  GriffAnaUtils::GriffParallelLoop loop("sim_*.griff",8);
+//  loop.setBookFunction([](SimpleHists::HistCollection& hc)
+//                       { hc.book1D(100,0.0,5.0,"edep"); });
+//  loop.setEventFunction([](GriffDataReader& dr, SimpleHists::HistCollection& hc)
+//                        { auto h = static_cast<SimpleHists::Hist1D*>(hc.hist("edep")); ... });
+//  SimpleHists::HistCollection result = loop.run();
+//
+//Note that GriffDataReader only checks setup consistency between events read
+//by the same reader instance, and each chunk is read by a separate instance.
+
+namespace GriffAnaUtils {
+
+  class GriffParallelLoop {
+  public:
+    //Input files can contain wildcards. Use nthreads=0 for one thread per core:
+    GriffParallelLoop(const std::string& inputFile, unsigned nthreads = 0);
+    GriffParallelLoop(const std::vector<std::string>& inputFiles, unsigned nthreads = 0);
+    ~GriffParallelLoop();
+
+    typedef std::function<void(SimpleHists::HistCollection&)> BookFct;
+    typedef std::function<void(GriffDataReader&,SimpleHists::HistCollection&)> EventFct;
+
+    //Called once for each per-thread collection (before any events):
+    void setBookFunction(const BookFct& f) { m_bookFct = f; }
+    //Called once for each event:
+    void setEventFunction(const EventFct& f) { m_eventFct = f; }
+
+    //Maximum number of events per chunk. The default (0) processes whole files
+    //when there are enough of them, and otherwise splits files into roughly
+    //4*nthreads chunks in total:
+    void setEventsPerChunk(unsigned n) { m_eventsPerChunk = n; }
+
+    //Forwarded to the readers (see GriffDataReader):
+    void allowSetupChange() { m_allowSetupChange = true; }
+    void setPrefetch(unsigned nthreads, unsigned depth = 0) { m_prefetchThreads = nthreads; m_prefetchDepth = depth; }
+
+    unsigned nThreads() const { return m_nthreads; }
+    const std::vector<std::string>& inputFiles() const { return m_inputFiles; }
+
+    //Process all events and return the merged collection. Exceptions thrown by
+    //the user functions stop the processing and are rethrown here:
+    SimpleHists::HistCollection run();
+
+    //Number of events processed by the last call to run():
+    std::uint64_t nEventsProcessed() const { return m_nevts; }
+
+  private:
+    struct Chunk {
+      unsigned fileIdx;
+      unsigned evtBegin;
+      unsigned evtEnd;//UINT_MAX for all events in file
+    };
+    std::vector<std::string> m_inputFiles;
+    unsigned m_nthreads;
+    unsigned m_eventsPerChunk;
+    unsigned m_prefetchThreads;
+    unsigned m_prefetchDepth;
+    bool m_allowSetupChange;
+    BookFct m_bookFct;
+    EventFct m_eventFct;
+    std::uint64_t m_nevts;
+    void init(const std::vector<std::string>& patterns, unsigned nthreads);
+    void planChunks(std::vector<Chunk>&) const;
+    std::uint64_t processChunk(const Chunk&, SimpleHists::HistCollection&) const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "GriffAnaUtils/GriffParallelLoop.hh"
+#include "Utils/Glob.hh"
+#include "Core/File.hh"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <climits>
+#include <cstdio>
+
+GriffAnaUtils::GriffParallelLoop::GriffParallelLoop(const std::string& inputFile, unsigned nthreads)
+{
+  init(std::vector<std::string>(1,inputFile),nthreads);
+}
+
+GriffAnaUtils::GriffParallelLoop::GriffParallelLoop(const std::vector<std::string>& inputFiles, unsigned nthreads)
+{
+  init(inputFiles,nthreads);
+}
+
+GriffAnaUtils::GriffParallelLoop::~GriffParallelLoop()
+{
+}
+
+void GriffAnaUtils::GriffParallelLoop::init(const std::vector<std::string>& patterns, unsigned nthreads)
+{
+  for (auto& p : patterns) {
+    if (p.find('*')!=std::string::npos)
+      Utils::glob(p,m_inputFiles);
+    else
+      m_inputFiles.push_back(p);
+  }
+  if (m_inputFiles.empty()) {
+    printf("GriffParallelLoop ERROR: No input files found\n");
+    throw std::runtime_error("GriffParallelLoop: No input files");
+  }
+  for (auto& f : m_inputFiles) {
+    if (!Core::file_exists(f)) {
+      printf("GriffParallelLoop ERROR: Input file does not exist: %s\n",f.c_str());
+      throw std::runtime_error("GriffParallelLoop: Input file does not exist");
+    }
+  }
+  m_nthreads = nthreads ? nthreads : std::max<unsigned>(1,std::thread::hardware_concurrency());
+  m_eventsPerChunk = 0;
+  m_prefetchThreads = 0;
+  m_prefetchDepth = 0;
+  m_allowSetupChange = false;
+  m_nevts = 0;
+}
+
+void GriffAnaUtils::GriffParallelLoop::planChunks(std::vector<Chunk>& chunks) const
+{
+  chunks.clear();
+  const unsigned nfiles = m_inputFiles.size();
+  if (!m_eventsPerChunk && nfiles >= 4*m_nthreads) {
+    //Plenty of files, no need to look inside them:
+    for (unsigned i = 0; i < nfiles; ++i)
+      chunks.push_back(Chunk{i,0,UINT_MAX});
+    return;
+  }
+
+  //Split files into event ranges (cheap for files with an event index, but
+  //otherwise involves a scan of the event headers):
+  std::vector<unsigned> nevts;
+  nevts.reserve(nfiles);
+  std::uint64_t ntot(0);
+  for (auto& f : m_inputFiles) {
+    EvtFile::FileReader fr(GriffFormat::Format::getFormat(),f.c_str());
+    if (!fr.init()||fr.bad()) {
+      printf("GriffParallelLoop ERROR: Trouble while opening file %s : %s\n",f.c_str(),fr.bad_reason());
+      throw std::runtime_error("GriffParallelLoop: Could not open file");
+    }
+    nevts.push_back(fr.nEvents());
+    ntot += nevts.back();
+  }
+  std::uint64_t chunksize = m_eventsPerChunk;
+  if (!chunksize)
+    chunksize = std::max<std::uint64_t>(1,(ntot+4*m_nthreads-1)/(4*m_nthreads));
+  for (unsigned i = 0; i < nfiles; ++i)
+    for (std::uint64_t b = 0; b < nevts[i]; b += chunksize)
+      chunks.push_back(Chunk{i,unsigned(b),unsigned(std::min<std::uint64_t>(b+chunksize,nevts[i]))});
+}
+
+std::uint64_t GriffAnaUtils::GriffParallelLoop::processChunk(const Chunk& c, SimpleHists::HistCollection& hc) const
+{
+  GriffDataReader dr(m_inputFiles[c.fileIdx]);
+  if (m_allowSetupChange)
+    dr.allowSetupChange();
+  if (m_prefetchThreads)
+    dr.setPrefetch(m_prefetchThreads,m_prefetchDepth);
+  if (!dr.eventActive()||c.evtBegin>=c.evtEnd)
+    return 0;
+  if (c.evtBegin && !dr.seekEventByIndexInCurrentFile(c.evtBegin))
+    return 0;
+  std::uint64_t n(0);
+  for (unsigned i = c.evtBegin;;) {
+    m_eventFct(dr,hc);
+    ++n;
+    if (++i==c.evtEnd||!dr.goToNextEvent())
+      break;
+  }
+  return n;
+}
+
+SimpleHists::HistCollection GriffAnaUtils::GriffParallelLoop::run()
+{
+  if (!m_eventFct) {
+    printf("GriffParallelLoop ERROR: No event function set\n");
+    throw std::runtime_error("GriffParallelLoop: No event function set");
+  }
+  m_nevts = 0;
+  std::vector<Chunk> chunks;
+  planChunks(chunks);
+
+  //Book the per-thread collections up front, so the book function does not
+  //need to be thread-safe:
+  const unsigned nworkers = std::max<unsigned>(1,std::min<std::size_t>(m_nthreads,chunks.size()));
+  std::vector<std::unique_ptr<SimpleHists::HistCollection>> colls;
+  for (unsigned i = 0; i < nworkers; ++i) {
+    colls.emplace_back(new SimpleHists::HistCollection);
+    if (m_bookFct)
+      m_bookFct(*colls.back());
+  }
+
+  std::atomic<std::size_t> nextChunk(0);
+  std::atomic<std::uint64_t> nevts(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr firstError;
+  std::mutex errorMutex;
+  auto worker = [&](unsigned iworker)
+  {
+    try {
+      std::uint64_t n(0);
+      std::size_t ichunk;
+      while (!failed && (ichunk = nextChunk++) < chunks.size())
+        n += processChunk(chunks[ichunk],*colls[iworker]);
+      nevts += n;
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!firstError)
+        firstError = std::current_exception();
+      failed = true;
+    }
+  };
+
+  if (nworkers==1) {
+    worker(0);
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(nworkers);
+    for (unsigned i = 0; i < nworkers; ++i)
+      threads.emplace_back(worker,i);
+    for (auto& t : threads)
+      t.join();
+  }
+  if (firstError)
+    std::rethrow_exception(firstError);
+  m_nevts = nevts;
+
+  SimpleHists::HistCollection result(std::move(*colls.front()));
+  for (unsigned i = 1; i < nworkers; ++i)
+    result.merge(colls[i].get());
+  return result;
+}
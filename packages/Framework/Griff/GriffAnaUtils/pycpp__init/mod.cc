@@ -14,14 +14,18 @@
 #include "GriffAnaUtils/StepFilter_EnergyDeposition.hh"
 #include "GriffAnaUtils/SegmentFilter_EKin.hh"
 #include "GriffAnaUtils/StepFilter_EKin.hh"
+#include "GriffAnaUtils/GriffParallelLoop.hh"
 #include "Core/Python.hh"
 
 #include "filters.hh"
 #include "iterators.hh"
+#include "parallelloop.hh"
 
 PYTHON_MODULE( mod )
 {
   pyextra::pyimport("GriffDataRead");
+  pyextra::pyimport("SimpleHists");
   GriffAnaUtils::pyexport_filters(mod);
   GriffAnaUtils::pyexport_iterators(mod);
+  GriffAnaUtils::pyexport_parallelloop(mod);
 }
@@ -0,0 +1,46 @@
+namespace GriffAnaUtils {
+
+  //The python functions are called from the worker threads, which must hold
+  //the GIL while doing so. Reading and decoding of the data is still done in
+  //parallel, but the python code itself is effectively serialised.
+
+  void pyexport_parallelloop( py::module_ themod)
+  {
+    py::class_<GriffParallelLoop>(themod,"GriffParallelLoop")
+      .def(py::init<std::string,unsigned>(),py::arg("inputFile"),py::arg("nthreads")=0)
+      .def(py::init( []( py::list l, unsigned nthreads )
+      {
+        const std::size_t n = static_cast<std::size_t>(py::len(l));
+        std::vector<std::string> v;
+        v.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+          v.push_back( l[i].cast<std::string>() );
+        return new GriffParallelLoop(v,nthreads);
+      }),py::arg("inputFiles"),py::arg("nthreads")=0)
+      .def("setBookFunction",[](GriffParallelLoop& self, py::object fct)
+      {
+        self.setBookFunction([fct](SimpleHists::HistCollection& hc)
+                             {
+                               py::gil_scoped_acquire gil;
+                               fct(py::cast(&hc,py::return_value_policy::reference));
+                             });
+      })
+      .def("setEventFunction",[](GriffParallelLoop& self, py::object fct)
+      {
+        self.setEventFunction([fct](GriffDataReader& dr, SimpleHists::HistCollection& hc)
+                              {
+                                py::gil_scoped_acquire gil;
+                                fct(py::cast(&dr,py::return_value_policy::reference),
+                                    py::cast(&hc,py::return_value_policy::reference));
+                              });
+      })
+      .def("setEventsPerChunk",&GriffParallelLoop::setEventsPerChunk)
+      .def("allowSetupChange",&GriffParallelLoop::allowSetupChange)
+      .def("setPrefetch",&GriffParallelLoop::setPrefetch,py::arg("nthreads"),py::arg("depth")=0)
+      .def("nThreads",&GriffParallelLoop::nThreads)
+      .def("run",&GriffParallelLoop::run,py::call_guard<py::gil_scoped_release>())
+      .def("nEventsProcessed",&GriffParallelLoop::nEventsProcessed)
+      ;
+  }
+
+}
@@ -0,0 +1,57 @@
+"""Utilities for comparing the events in Griff files by content, independently
+of how the events are distributed over files and of how the database entries
+they refer to (volume names, materials, process names, ...) are indexed."""
+
+__all__ = [ 'event_digest', 'file_digests', 'compare_files' ]
+
+def _step_digest(step):
+    return (step.preGlobalX(),step.preGlobalY(),step.preGlobalZ(),step.preTime(),step.preEKin(),
+            step.postGlobalX(),step.postGlobalY(),step.postGlobalZ(),step.postTime(),step.postEKin(),
+            step.preMomentumX(),step.preMomentumY(),step.preMomentumZ(),
+            step.postMomentumX(),step.postMomentumY(),step.postMomentumZ(),
+            step.eDep(),step.eDepNonIonising(),step.stepLength(),
+            step.preAtVolEdge(),step.postAtVolEdge(),
+            step.preProcessDefinedStep(),step.postProcessDefinedStep())
+
+def _segment_digest(seg):
+    return (seg.volumeName(),seg.physicalVolumeName(),seg.volumeCopyNumber(),seg.material().getName(),
+            seg.startTime(),seg.endTime(),seg.startEKin(),seg.endEKin(),seg.eDep(),seg.eDepNonIonising(),
+            seg.nStepsOriginal(),seg.nStepsStored(),
+            tuple(_step_digest(step) for step in seg.steps) if seg.hasStepInfo() else ())
+
+def _track_digest(trk):
+    return (trk.trackID(),trk.parentID(),trk.pdgCode(),trk.pdgName(),trk.creatorProcess(),
+            trk.startEKin(),trk.weight(),tuple(d.trackID() for d in trk.daughters),
+            tuple(_segment_digest(seg) for seg in trk.segments))
+
+def event_digest(dr):
+    """Digest of the current event of the GriffDataReader dr, holding the
+    content of all tracks, segments and steps (with the database entries
+    included by value)"""
+    return (dr.runNumber(),dr.eventNumber(),dr.seedStr(),dr.nTracks(),
+            tuple(_track_digest(trk) for trk in dr.tracks))
+
+def file_digests(files):
+    """List of (run number, event number, digest) of all events in the given
+    file or list of files, in the order in which the events are stored"""
+    import GriffDataRead
+    dr = GriffDataRead.GriffDataReader([str(f) for f in files] if isinstance(files,(list,tuple)) else str(files))
+    l = []
+    while dr.loopEvents():
+        l += [ (dr.runNumber(),dr.eventNumber(),event_digest(dr)) ]
+    return l
+
+def compare_files(files_a,files_b,ignore_order=False,ignore_event_numbers=False):
+    """Returns (nevents_a,nevents_b,ndiffer) comparing the events in two
+    (lists of) files. If ignore_order is set, events are matched by their run
+    and event numbers rather than by their position in the files. If
+    ignore_event_numbers is set, events are matched by content alone (for
+    instance to compare events of jobs split differently over processes, in
+    which event numbers are not the same, but the seeds of the events are)."""
+    a,b = file_digests(files_a),file_digests(files_b)
+    if ignore_event_numbers:
+        a,b = sorted(d[2:] for _,_,d in a),sorted(d[2:] for _,_,d in b)
+    elif ignore_order:
+        a,b = sorted(a),sorted(b)
+    ndiffer = sum(1 for ea,eb in zip(a,b) if ea!=eb) + abs(len(a)-len(b))
+    return len(a),len(b),ndiffer
@@ -0,0 +1,116 @@
+#include "GriffDataRead/GriffDataReader.hh"
+#include "GriffFormat/Format.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "EvtFile/Codec.hh"
+#include "Core/FindData.hh"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+
+//Test chunked compression of the step data: a reference file is rewritten
+//with various chunk sizes, and the step data read back (completely, with
+//prefetching or partially) is compared with that of the original file.
+
+namespace {
+
+  //Sum of step quantities, of all steps or of the first segment of each track
+  //(where the reader only inflates the chunks needed):
+  double stepSum(GriffDataReader& dr, bool firstSegmentOnly)
+  {
+    double sum(0.0);
+    for (auto trk = dr.trackBegin(); trk != dr.trackEnd(); ++trk) {
+      for (auto seg = trk->segmentBegin(); seg != trk->segmentEnd(); ++seg) {
+        for (auto step = seg->stepBegin(); step != seg->stepEnd(); ++step)
+          sum += step->preEKin() + step->postGlobalX() + step->postLocalZ() + step->eDep();
+        if (firstSegmentOnly)
+          break;
+      }
+    }
+    return sum;
+  }
+
+  void rewrite(const std::string& infile, const std::string& outfile, const char * compression)
+  {
+    EvtFile::FileReader fr(GriffFormat::Format::getFormat(),infile.c_str());
+    if (!fr.init())
+      throw std::runtime_error("Could not open input file");
+    EvtFile::FileWriter fw(GriffFormat::Format::getFormat(),outfile.c_str());
+    fw.setCompression(EvtFile::parseCompression(compression));
+    std::vector<char> db;
+    for (; fr.eventActive(); fr.goToNextEvent()) {
+      fr.getSharedDataInEvent(db);
+      if (!db.empty())
+        fw.writeDataDBSection(&db[0],db.size());
+      fw.writeDataBriefSection(fr.getBriefData(),fr.nBytesBriefData());
+      if (fr.nBytesFullData())
+        fw.writeDataFullSection(fr.getFullData(),fr.nBytesFullData());
+      fw.flushEventToDisk(fr.runNumber(),fr.eventNumber());
+    }
+  }
+
+  enum Mode { ALL_STEPS, PREFETCH, FIRST_SEGMENTS };
+  const char * modeName(Mode m) { return m==ALL_STEPS ? "all steps" : (m==PREFETCH ? "prefetch" : "first segments"); }
+
+  bool compare(const std::string& reffile, const std::string& file, Mode mode)
+  {
+    GriffDataReader dr_ref(reffile), dr(file);
+    if (mode==PREFETCH)
+      dr.setPrefetch(2);
+    unsigned nevts(0), nbad(0), nzlib(0);
+    while (dr_ref.loopEvents()) {
+      if (!dr.loopEvents())
+        return false;
+      ++nevts;
+      bool firstSegmentOnly(mode==FIRST_SEGMENTS);
+      bool ok = stepSum(dr_ref,firstSegmentOnly)==stepSum(dr,firstSegmentOnly);
+      if (!dr.getRawFileReader()->verifyEventDataIntegrity())
+        ok = false;
+      if (dr.getRawFileReader()->fullDataCodec()==EvtFile::CODEC_ZLIB)
+        ++nzlib;
+      if (firstSegmentOnly&&stepSum(dr_ref,false)!=stepSum(dr,false))
+        ok = false;//remaining chunks must be inflated on demand
+      if (!ok)
+        ++nbad;
+    }
+    if (dr.loopEvents())
+      return false;
+    printf("    %-14s : %u events, %u with zlib step data, %u with differences\n",modeName(mode),nevts,nzlib,nbad);
+    return nbad==0;
+  }
+
+}
+
+int main(int,char**) {
+  GriffDataReader::setOpenMsg(false);
+  printf("Parsing compression strings:\n");
+  const char * names[] = { "zlib/64k", "zlib-3/1000", "zlib/1024", "none/4k", "zlib/0k", "zlib/x", "zlib/70000k" };
+  for (auto name : names) {
+    try {
+      auto c = EvtFile::parseCompression(name);
+      printf("  %-12s -> %s (chunk size %u)\n",name,EvtFile::compressionName(c).c_str(),c.chunkSize);
+    } catch (std::runtime_error&) {
+      printf("  %-12s -> rejected\n",name);
+    }
+  }
+
+  std::string reffile = Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff");
+  const char * compressions[] = { "zlib/1k", "zlib-1/4k", "zlib/64k" };
+  bool allok(true);
+  unsigned i(0);
+  for (auto compression : compressions) {
+    std::string outfile = "chunked" + std::to_string(i++) + ".griff";
+    rewrite(reffile,outfile,compression);
+    printf("Reading file with %s compression:\n",compression);
+    for (auto mode : { ALL_STEPS, PREFETCH, FIRST_SEGMENTS })
+      if (!compare(reffile,outfile,mode))
+        allok = false;
+  }
+  if (!allok) {
+    printf("ERROR: Step data differs from that of the reference file\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include "GriffDataRead/GriffDataReader.hh"
+#include "GriffFormat/Format.hh"
+#include "GriffFormat/OctahedralPack.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "Utils/ByteStream.hh"
+#include "Core/FindData.hh"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+//Test decoding of the compact step encoding: the step data of a reference file
+//in FULL mode is converted to the compact encoding (following the layout
+//described in GriffFormat/Format.hh), and the steps decoded by the reader are
+//compared with those of the original file.
+
+namespace {
+
+  typedef GriffFormat::Format GF;
+  typedef EvtFile::index_type index_type;
+
+  //Re-encode the standard step data of all segments in full into compact
+  //step data, updating the mode word and the step data offsets of the
+  //segments in brief accordingly:
+  void encodeCompact(std::vector<char>& brief, const std::vector<char>& full, std::vector<char>& out)
+  {
+    out.clear();
+    char * data = &brief[0];
+    const std::uint32_t ntracks = ByteStream::interpret<std::uint32_t>(data+12);
+    std::uint32_t modeword = ByteStream::interpret<std::uint32_t>(data+16);
+    if (modeword & GF::STEPENCODING_MASK)
+      throw std::runtime_error("Input is not in the standard step encoding");
+    modeword |= (GF::STEPENCODING_COMPACT<<GF::STEPENCODING_SHIFT);
+    std::memcpy(data+16,&modeword,sizeof(modeword));
+    data += GF::SIZE_TRACKHEADER;
+    if (modeword & GF::MODEFLAG_SUMMARY)
+      data += ByteStream::interpret<std::uint32_t>(data);
+    std::vector<std::uint32_t> nsegments(ntracks);
+    for (auto& nseg : nsegments) {
+      nseg = ByteStream::interpret<std::uint32_t>(data+20);
+      data += GF::SIZE_PER_TRACK_WO_DAUGHTERLIST
+        + ByteStream::interpret<std::uint32_t>(data+24) * GF::SIZE_PER_DAUGHTERLIST_ENTRY;
+    }
+    auto append = [&out](const void * p, unsigned n)
+      {
+        out.insert(out.end(),static_cast<const char*>(p),static_cast<const char*>(p)+n);
+      };
+    for (auto nseg : nsegments) {
+      for (unsigned iseg = 0; iseg < nseg; ++iseg) {
+        const index_type volinfo = ByteStream::interpret<index_type>(data+16);
+        const std::int32_t rawstep = ByteStream::interpret<std::int32_t>(data+20);
+        if (rawstep>=0) {
+          const std::int32_t newrawstep = out.size();
+          std::memcpy(data+20,&newrawstep,sizeof(newrawstep));
+          const char * in = &full[rawstep];
+          const std::uint32_t nsteps = ByteStream::interpret<std::uint32_t>(in+4);
+          //Header and first step point are unchanged:
+          append(in,GF::SIZE_STEPHEADER+GF::SIZE_STEPPREPOSTPART);
+          in += GF::SIZE_STEPHEADER;
+          double ref[4];//x,y,z,t as decoded by readers
+          std::memcpy(ref,in,sizeof(ref));
+          in += GF::SIZE_STEPPREPOSTPART;
+          for (unsigned i = 0; i < nsteps; ++i) {
+            append(in,GF::SIZE_STEPOTHERPART);
+            in += GF::SIZE_STEPOTHERPART;
+            double postpoint[5];//x,y,z,t,ekin
+            float locpos[3], mom[3];
+            std::memcpy(postpoint,in,sizeof(postpoint));
+            std::memcpy(locpos,in+40,sizeof(locpos));
+            std::memcpy(mom,in+52,sizeof(mom));
+            float f[9];
+            for (unsigned j = 0; j < 4; ++j) {
+              f[j] = float(postpoint[j]-ref[j]);
+              ref[j] += f[j];
+            }
+            f[4] = float(postpoint[4]);
+            std::copy(locpos,locpos+3,f+5);
+            f[8] = float(std::sqrt(double(mom[0])*mom[0]+double(mom[1])*mom[1]+double(mom[2])*mom[2]));
+            std::uint16_t pdir[2];
+            GriffFormat::packOctahedral(mom,pdir);
+            append(f,sizeof(f));
+            append(pdir,sizeof(pdir));
+            append(in+64,sizeof(index_type));//process
+            in += GF::SIZE_STEPPREPOSTPART;
+          }
+        }
+        data += GF::SIZE_PER_SEGMENT;
+        if (volinfo & 0x20000000)
+          data += GF::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;//nextWasFiltered
+      }
+      data += GF::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;
+    }
+    if (data!=&brief[0]+brief.size())
+      throw std::runtime_error("Unexpected size of track data");
+  }
+
+  void convert(const std::string& infile, const std::string& outfile)
+  {
+    EvtFile::FileReader fr(GF::getFormat(),infile.c_str());
+    if (!fr.init())
+      throw std::runtime_error("Could not open input file");
+    EvtFile::FileWriter fw(GF::getFormat(),outfile.c_str());
+    std::vector<char> db, brief, full, compact;
+    for (; fr.eventActive(); fr.goToNextEvent()) {
+      fr.getSharedDataInEvent(db);
+      if (!db.empty())
+        fw.writeDataDBSection(&db[0],db.size());
+      brief.assign(fr.getBriefData(),fr.getBriefData()+fr.nBytesBriefData());
+      full.assign(fr.getFullData(),fr.getFullData()+fr.nBytesFullData());
+      encodeCompact(brief,full,compact);
+      fw.writeDataBriefSection(&brief[0],brief.size());
+      if (!compact.empty())
+        fw.writeDataFullSection(&compact[0],compact.size());
+      fw.flushEventToDisk(fr.runNumber(),fr.eventNumber());
+    }
+  }
+
+  double angle(const float * a, const float * b)
+  {
+    double dot(0.0), na(0.0), nb(0.0);
+    for (unsigned i = 0; i < 3; ++i) {
+      dot += double(a[i])*b[i];
+      na += double(a[i])*a[i];
+      nb += double(b[i])*b[i];
+    }
+    if (!na||!nb)
+      return na==nb ? 0.0 : M_PI;
+    return std::acos(std::min(1.0,std::max(-1.0,dot/std::sqrt(na*nb))));
+  }
+
+  //Largest deviations seen between the compact and standard step points:
+  struct Deviations {
+    double pos = 0.0;//relative to the step length
+    double time = 0.0;//relative to the time since the segment start
+    double ekin = 0.0;//relative
+    double pmag = 0.0;//relative
+    double pdir = 0.0;//angle
+    unsigned nmismatch = 0;//quantities which must be identical
+    void addStepPoint(const GriffDataRead::Step& s, const GriffDataRead::Step& r, bool post)
+    {
+      const double * gs = post ? s.postGlobalArray() : s.preGlobalArray();
+      const double * gr = post ? r.postGlobalArray() : r.preGlobalArray();
+      const double scale = std::max(r.stepLength(),1e-12);
+      for (unsigned i = 0; i < 3; ++i)
+        pos = std::max(pos,std::fabs(gs[i]-gr[i])/scale);
+      const double t0 = r.getSegment()->startTime();
+      const double ts(post?s.postTime():s.preTime()), tr(post?r.postTime():r.preTime());
+      time = std::max(time,std::fabs(ts-tr)/std::max(tr-t0,1e-12));
+      const double es(post?s.postEKin():s.preEKin()), er(post?r.postEKin():r.preEKin());
+      if (er)
+        ekin = std::max(ekin,std::fabs(es-er)/er);
+      else if (es)
+        ++nmismatch;
+      const float * ms = post ? s.postMomentumArray() : s.preMomentumArray();
+      const float * mr = post ? r.postMomentumArray() : r.preMomentumArray();
+      const double ns = std::sqrt(double(ms[0])*ms[0]+double(ms[1])*ms[1]+double(ms[2])*ms[2]);
+      const double nr = std::sqrt(double(mr[0])*mr[0]+double(mr[1])*mr[1]+double(mr[2])*mr[2]);
+      if (nr)
+        pmag = std::max(pmag,std::fabs(ns-nr)/nr);
+      pdir = std::max(pdir,angle(ms,mr));
+      const float * ls = post ? s.postLocalArray() : s.preLocalArray();
+      const float * lr = post ? r.postLocalArray() : r.preLocalArray();
+      if (!std::equal(ls,ls+3,lr))
+        ++nmismatch;
+      if ((post?s.postAtVolEdge():s.preAtVolEdge())!=(post?r.postAtVolEdge():r.preAtVolEdge()))
+        ++nmismatch;
+      if ((post?s.postProcessDefinedStep():s.preProcessDefinedStep())!=(post?r.postProcessDefinedStep():r.preProcessDefinedStep()))
+        ++nmismatch;
+    }
+  };
+
+  void testOctahedralPacking()
+  {
+    printf("Packing of directions:\n");
+    const float dirs[][3] = { {1,0,0}, {0,-1,0}, {0,0,1}, {0,0,-1}, {0.6f,0.0f,-0.8f}, {-1e-20f,1e-20f,-1}, {0,0,0} };
+    for (auto& d : dirs) {
+      std::uint16_t packed[2];
+      double v[3];
+      GriffFormat::packOctahedral(d,packed);
+      GriffFormat::unpackOctahedral(packed,v);
+      printf("  (%g, %g, %g) -> (%.4f, %.4f, %.4f)\n",d[0],d[1],d[2],v[0]+0.0,v[1]+0.0,v[2]+0.0);
+    }
+  }
+
+}
+
+int main(int,char**) {
+  testOctahedralPacking();
+
+  GriffDataReader::setOpenMsg(false);
+  std::string reffile = Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff");
+  convert(reffile,"compact.griff");
+  GriffDataReader dr_ref(reffile), dr("compact.griff");
+  unsigned nevts(0), nsteps(0), nstructure(0);
+  Deviations dev;
+  while (dr_ref.loopEvents()) {
+    if (!dr.loopEvents()||dr.nTracks()!=dr_ref.nTracks()||dr.eventStepEncoding()!=GF::STEPENCODING_COMPACT) {
+      ++nstructure;
+      break;
+    }
+    ++nevts;
+    for (auto trk = dr.trackBegin(), trk_ref = dr_ref.trackBegin(); trk != dr.trackEnd(); ++trk, ++trk_ref) {
+      if (trk->nSegments()!=trk_ref->nSegments()) {
+        ++nstructure;
+        continue;
+      }
+      for (auto seg = trk->segmentBegin(), seg_ref = trk_ref->segmentBegin(); seg != trk->segmentEnd(); ++seg, ++seg_ref) {
+        if (seg->nStepsStored()!=seg_ref->nStepsStored()) {
+          ++nstructure;
+          continue;
+        }
+        for (auto step = seg->stepBegin(), step_ref = seg_ref->stepBegin(); step != seg->stepEnd(); ++step, ++step_ref) {
+          ++nsteps;
+          if (step->eDep()!=step_ref->eDep()||step->eDepNonIonising()!=step_ref->eDepNonIonising()
+              ||step->stepLength()!=step_ref->stepLength()||step->stepStatusStr()!=step_ref->stepStatusStr())
+            ++dev.nmismatch;
+          dev.addStepPoint(*step,*step_ref,false);
+          dev.addStepPoint(*step,*step_ref,true);
+        }
+      }
+    }
+  }
+  if (dr.loopEvents())
+    ++nstructure;
+  printf("Compared %u steps in %u events:\n",nsteps,nevts);
+  printf("  structural differences        : %u\n",nstructure);
+  printf("  differences in exact fields   : %u\n",dev.nmismatch);
+  printf("  positions within 1e-6 of step : %s\n",dev.pos<1e-6?"yes":"no");
+  printf("  times within 1e-6 relative    : %s\n",dev.time<1e-6?"yes":"no");
+  printf("  energies within 1e-6 relative : %s\n",dev.ekin<1e-6?"yes":"no");
+  printf("  momenta within 1e-6 relative  : %s\n",dev.pmag<1e-6?"yes":"no");
+  printf("  directions within 1e-4 rad    : %s\n",dev.pdir<1e-4?"yes":"no");
+  bool ok = nstructure==0 && dev.nmismatch==0 && dev.pos<1e-6 && dev.time<1e-6
+    && dev.ekin<1e-6 && dev.pmag<1e-6 && dev.pdir<1e-4;
+  if (!ok) {
+    printf("ERROR: Compact step data does not decode to the original steps\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef GriffDataRead_EventSummary_hh
+#define GriffDataRead_EventSummary_hh
+
+#include "Core/Types.hh"
+#include "EvtFile/Defs.hh"
+#include <cassert>
+#include <vector>
+#include <string>
+
+class GriffDataReader;
+
+namespace GriffDataRead {
+
+  class Touchable;
+
+  //Compact summary of an event: number of tracks, pdg codes present and energy
+  //deposits per touchable. It is stored along with events written by recent
+  //versions of G4DataCollect, and can thus be inspected without loading tracks
+  //and segments or inflating step data. For older files it is derived from the
+  //track data instead (still without touching step data).
+
+  class EventSummary {
+  public:
+
+    unsigned nTracks() const { return m_nTracks; }
+
+    //Sorted unique pdg codes of the tracks:
+    unsigned nPDGCodes() const { return m_pdgCodes.size(); }
+    std::int32_t pdgCode(unsigned i) const { assert(i<m_pdgCodes.size()); return m_pdgCodes[i]; }
+    bool hasPDGCode(std::int32_t) const;
+
+    //Touchables visited by the tracks, sorted by index, and the energy deposited in each:
+    unsigned nTouchables() const { return m_edeps.size(); }
+    EvtFile::index_type touchableIndex(unsigned i) const { assert(i<m_edeps.size()); return m_edeps[i].first; }
+    float eDep(unsigned i) const { assert(i<m_edeps.size()); return m_edeps[i].second; }
+    const std::string& volumeName(unsigned i, unsigned idepth=0) const;//i=1 for mother volume, etc.
+
+    //Convenience (the volume name refers to the innermost volume of the touchables):
+    double eDepTotal() const;
+    double eDepInVolume(const std::string& volname) const;
+    bool visitedVolume(const std::string& volname) const;
+
+    //False if the summary was not stored in the file but derived from the track data:
+    bool isStored() const { return m_stored; }
+
+    //Number of events which were simulated but vetoed by the writer since the
+    //previous event in the file (see G4DataCollect::setEventVeto):
+    std::uint32_t nVetoedBefore() const { return m_nVetoedBefore; }
+
+  private:
+    friend class ::GriffDataReader;
+    EventSummary() : m_dr(0), m_nTracks(0), m_stored(false), m_nVetoedBefore(0) {}
+    void setFromStored(GriffDataReader*, const char* data, unsigned ntracks, bool hasVetoCount);
+    void setFromTracks(GriffDataReader*, const char* data, unsigned ntracks);
+    const Touchable& getTouchable(unsigned i) const;
+    GriffDataReader * m_dr;
+    unsigned m_nTracks;
+    bool m_stored;
+    std::uint32_t m_nVetoedBefore;
+    std::vector<std::int32_t> m_pdgCodes;
+    std::vector<std::pair<EvtFile::index_type,float> > m_edeps;
+    std::vector<std::uint32_t> m_tmpNSegments;
+  };
+
+  //Event preselection, see GriffDataReader::setEventPreselection:
+  struct EventPreselection {
+    virtual ~EventPreselection() {}
+    virtual bool acceptEvent(const EventSummary&) = 0;
+  };
+
+}
+
+#endif
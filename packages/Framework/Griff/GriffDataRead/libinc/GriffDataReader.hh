@@ -9,6 +9,7 @@
 #include "GriffDataRead/PDGCodeReader.hh"
 #include "GriffDataRead/MetaData.hh"
 #include "GriffDataRead/Setup.hh"
+#include "GriffDataRead/EventSummary.hh"
 #include "GriffFormat/Format.hh"
 #include "EvtFile/FileReader.hh"
 #include "EvtFile/DBSubSectReaderMgr.hh"
@@ -69,6 +70,9 @@ public:
   int32_t currentEventVersion() const;
   GriffFormat::Format::MODE eventStorageMode() const;
   const char * eventStorageModeStr() const;
+  bool eventHasMixedStorage() const;//true if some segments nevertheless have full step data in REDUCED or MINIMAL mode
+  GriffFormat::Format::STEPENCODING eventStepEncoding() const;//decoded transparently when accessing steps
+  const char * eventStepEncodingStr() const;
   std::uint64_t seed() const;//Random seed used for event generation.
   std::string seedStr() const;//as string for convenience
 
@@ -105,6 +109,17 @@ public:
   //for trk in datareader.primaryTracks:
   //   print trk.trackID(),trk.pdgName()
   //   ...
+  //
+  //For numpy based analysis it is much faster to extract selected quantities
+  //of all tracks, segments or steps into arrays in one go, either for the
+  //current event or for the next N events (leaving the reader after them):
+  //
+  //d = datareader.stepArrays(['pdgCode','eDep','preGlobalX'])
+  //while datareader.eventActive():
+  //   d = datareader.segmentArraysBatch(1000,['trackID','eDep'])
+  //   ...
+  //
+  //The available fields are listed by GriffDataReader.stepArrayFields() etc.
 
   ////////////////////////
   //  Event navigation  //
@@ -122,6 +137,11 @@ public:
   bool loopEvents();//reset afterwards by goToFirstEvent()
   std::uint64_t loopCount() const;//loop counter (0=>first event, 1=>second event, ...)
 
+  //For faster sequential processing, worker threads can read and decompress
+  //the data of the next depth events (default 2*nthreads) while the current one
+  //is being analysed. Set nthreads=0 (the default) to disable:
+  void setPrefetch(unsigned nthreads, unsigned depth = 0);
+
   //callbacks (must live for longer than the GriffDataReader is being used to
   //navigate events, or be deregistered):
   void registerBeginEventCallBack(GriffDataRead::BeginEventCallBack*);
@@ -129,6 +149,18 @@ public:
   void deregisterBeginEventCallBack(GriffDataRead::BeginEventCallBack*);
   void deregisterEndEventCallBack(GriffDataRead::EndEventCallBack*);
 
+  //Compact summary of the current event, which is available without loading
+  //tracks or step data (see GriffDataRead/EventSummary.hh):
+  const GriffDataRead::EventSummary& eventSummary() const;
+
+  //Install a preselection, making the navigation methods silently skip events
+  //whose summary is not accepted, without ever loading their tracks or step
+  //data (note that prefetch threads might still inflate step data of skipped
+  //events). The object must live for longer than it is installed, and can be
+  //removed again by passing a null pointer. Callbacks are not fired for
+  //skipped events, and seekEventByIndexInCurrentFile ignores the preselection:
+  void setEventPreselection(GriffDataRead::EventPreselection*);
+
   //Special methods for jumping within the same file (users must be careful when their code might one day run on multiple files!):
   bool seekEventByIndexInCurrentFile(unsigned idx);
   unsigned eventIndexInCurrentFile() const;
@@ -147,6 +179,8 @@ private:
   //current file:
   unsigned m_fileIdx;
   EvtFile::FileReader * m_fr;
+  unsigned m_prefetchThreads;
+  unsigned m_prefetchDepth;
   char m_mempool_filereader[sizeof(EvtFile::FileReader)];
   //event data:
   mutable bool m_needsLoad;
@@ -189,6 +223,11 @@ private:
   EvtFile::DBEntryReader<GriffDataRead::MetaData> m_dbMetaData;
   EvtFile::DBStringsReader m_dbMetaDataStrings;
 
+  //summary and preselection:
+  mutable GriffDataRead::EventSummary m_summary;
+  mutable bool m_needsSummary;
+  GriffDataRead::EventPreselection * m_preselection;
+
   //callbacks:
   std::vector<GriffDataRead::BeginEventCallBack*> m_beginEventCallBacks;
   std::vector<GriffDataRead::EndEventCallBack*> m_endEventCallBacks;
@@ -203,6 +242,10 @@ private:
   bool setupChangedFullCheck(EvtFile::index_type current_mdidx);
   void checkSetupConsistency();
   EvtFile::index_type metaDataIdx() const;
+  std::uint32_t rawModeWord() const;
+  unsigned trackDataOffset() const;
+  bool passPreselection();
+  bool actualPassPreselection();
 
 
   friend class GriffDataRead::Track;
@@ -213,6 +256,7 @@ private:
   friend class GriffDataRead::Isotope;
   friend class GriffDataRead::Touchable;
   friend class GriffDataRead::MetaData;
+  friend class GriffDataRead::EventSummary;
 
   static bool sm_openMsg;
 public:
@@ -27,7 +27,11 @@ namespace GriffDataRead {
     unsigned nStepsOriginal() const;//number of steps comprising the segment
     unsigned nStepsStored() const;//number of steps actually available in the inputfile (in FULL mode nStepsOriginal() == nStepsStored())
 
+    //Files written in REDUCED or MINIMAL mode might keep full step data for
+    //some segments (see GriffDataReader::eventHasMixedStorage), so always
+    //check the segments individually before accessing steps:
     bool hasStepInfo() const { return nStepsStored() > 0; }
+    bool hasFullStepInfo() const { return nStepsStored() == nStepsOriginal(); }
     const Step * getStep(unsigned i) const;//i must be less than nStepsStored()
     const Step * stepBegin() const;
     const Step * stepEnd() const;
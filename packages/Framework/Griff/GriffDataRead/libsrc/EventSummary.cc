@@ -0,0 +1,120 @@
+#include "GriffDataRead/EventSummary.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include <algorithm>
+
+bool GriffDataRead::EventSummary::hasPDGCode(std::int32_t pdgcode) const
+{
+  return std::binary_search(m_pdgCodes.begin(),m_pdgCodes.end(),pdgcode);
+}
+
+const GriffDataRead::Touchable& GriffDataRead::EventSummary::getTouchable(unsigned i) const
+{
+  assert(m_dr&&i<m_edeps.size());
+  return m_dr->m_dbTouchables.getEntry(m_edeps[i].first);
+}
+
+const std::string& GriffDataRead::EventSummary::volumeName(unsigned i, unsigned idepth) const
+{
+  return m_dr->m_dbVolNames.getString(getTouchable(i).volNameIdx(idepth));
+}
+
+double GriffDataRead::EventSummary::eDepTotal() const
+{
+  double e(0.0);
+  for (auto& te : m_edeps)
+    e += te.second;
+  return e;
+}
+
+double GriffDataRead::EventSummary::eDepInVolume(const std::string& volname) const
+{
+  double e(0.0);
+  const unsigned n = m_edeps.size();
+  for (unsigned i = 0; i < n; ++i)
+    if (volumeName(i)==volname)
+      e += m_edeps[i].second;
+  return e;
+}
+
+bool GriffDataRead::EventSummary::visitedVolume(const std::string& volname) const
+{
+  const unsigned n = m_edeps.size();
+  for (unsigned i = 0; i < n; ++i)
+    if (volumeName(i)==volname)
+      return true;
+  return false;
+}
+
+void GriffDataRead::EventSummary::setFromStored(GriffDataReader* dr, const char* data, unsigned ntracks, bool hasVetoCount)
+{
+  //See GriffFormat::Format::MODEFLAG_SUMMARY for the layout:
+  m_dr = dr;
+  m_nTracks = ntracks;
+  m_stored = true;
+#ifndef NDEBUG
+  const char * dataE = data + ByteStream::interpret<std::uint32_t>(data);
+#endif
+  data += sizeof(std::uint32_t);
+  std::uint32_t npdg; ByteStream::read(data,npdg);
+  m_pdgCodes.resize(npdg);
+  for (auto& p : m_pdgCodes)
+    ByteStream::read(data,p);
+  std::uint32_t ntouchables; ByteStream::read(data,ntouchables);
+  m_edeps.resize(ntouchables);
+  for (auto& te : m_edeps) {
+    ByteStream::read(data,te.first);
+    ByteStream::read(data,te.second);
+  }
+  m_nVetoedBefore = 0;
+  if (hasVetoCount)
+    ByteStream::read(data,m_nVetoedBefore);
+  assert(data==dataE);
+}
+
+void GriffDataRead::EventSummary::setFromTracks(GriffDataReader* dr, const char* data, unsigned ntracks)
+{
+  //Parse the raw track and segment data directly (cf. GriffDataReader::actualLoadTracks):
+  m_dr = dr;
+  m_nTracks = ntracks;
+  m_stored = false;
+  m_nVetoedBefore = 0;
+  m_pdgCodes.clear();
+  m_edeps.clear();
+  std::vector<std::uint32_t>& nsegments = m_tmpNSegments;
+  nsegments.clear();
+  for (unsigned i = 0; i < ntracks; ++i) {
+    m_pdgCodes.push_back(ByteStream::interpret<std::int32_t>(data+4));
+    nsegments.push_back(ByteStream::interpret<std::uint32_t>(data+20));
+    std::uint32_t ndaughters = ByteStream::interpret<std::uint32_t>(data+24);
+    data += GriffFormat::Format::SIZE_PER_TRACK_WO_DAUGHTERLIST + ndaughters * GriffFormat::Format::SIZE_PER_DAUGHTERLIST_ENTRY;
+  }
+  for (auto nseg : nsegments) {
+    for (unsigned iseg = 0; iseg < nseg; ++iseg) {
+      EvtFile::index_type volinfo = ByteStream::interpret<EvtFile::index_type>(data+16);
+      m_edeps.emplace_back(volinfo & 0x1FFFFFFF, ByteStream::interpret<float>(data+24));
+      data += GriffFormat::Format::SIZE_PER_SEGMENT;
+      if (volinfo & 0x20000000)
+        data += GriffFormat::Format::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;//nextWasFiltered
+    }
+    data += GriffFormat::Format::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;
+  }
+
+  std::sort(m_pdgCodes.begin(),m_pdgCodes.end());
+  m_pdgCodes.erase(std::unique(m_pdgCodes.begin(),m_pdgCodes.end()),m_pdgCodes.end());
+
+  //Sum up energy deposits per touchable (in double precision like the writer):
+  std::stable_sort(m_edeps.begin(),m_edeps.end(),
+                   [](const std::pair<EvtFile::index_type,float>& a,const std::pair<EvtFile::index_type,float>& b)
+                   { return a.first < b.first; });
+  auto itOut = m_edeps.begin();
+  for (auto it = m_edeps.begin(); it!=m_edeps.end();) {
+    double e(0.0);
+    auto itNext = it;
+    for (; itNext!=m_edeps.end() && itNext->first==it->first; ++itNext)
+      e += itNext->second;
+    *itOut = std::make_pair(it->first,float(e));
+    ++itOut;
+    it = itNext;
+  }
+  m_edeps.erase(itOut,m_edeps.end());
+}
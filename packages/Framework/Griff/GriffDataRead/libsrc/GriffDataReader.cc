@@ -178,11 +178,24 @@ void GriffDataReader::init()
   m_dbmgr.addSubSection(m_dbMetaData);
   m_dbmgr.addSubSection(m_dbMetaDataStrings);
 
+  m_needsSummary = true;
+  m_preselection = 0;
+
   m_fileIdx = UINT_MAX;
   m_fr = 0;
+  m_prefetchThreads = 0;
+  m_prefetchDepth = 0;
   goToFirstEvent();
 }
 
+void GriffDataReader::setPrefetch(unsigned nthreads, unsigned depth)
+{
+  m_prefetchThreads = nthreads;
+  m_prefetchDepth = depth;
+  if (m_fr&&m_fr->is_open())
+    m_fr->setPrefetch(nthreads,depth);
+}
+
 void GriffDataReader::initFile(unsigned i)
 {
   clearEvent();
@@ -205,6 +218,9 @@ void GriffDataReader::initFile(unsigned i)
     m_fr = 0;
   }
   m_fr = new(&(m_mempool_filereader[0])) EvtFile::FileReader(GriffFormat::Format::getFormat(),m_inputFiles[i].c_str(),&m_dbmgr);
+  m_fr->setReadMode(EvtFile::FileReader::READ_AUTO);//zero-copy reading of local files
+  if (m_prefetchThreads)
+    m_fr->setPrefetch(m_prefetchThreads,m_prefetchDepth);
   bool ok = m_fr->init();
   if (!ok || m_fr->bad()) {
     printf("GriffDataReader::ERROR Trouble while opening file %s : %s\n",m_inputFiles[i].c_str(),m_fr->bad_reason());
@@ -241,8 +257,11 @@ bool GriffDataReader::goToNextFile()
   if (m_fileIdx==m_inputFiles.size())
     return false;//there is no next file to try
   initFile(m_fileIdx);
-  if (eventActive())
+  if (eventActive()) {
+    if (!passPreselection())
+      return goToNextEvent();
     beginEventActions();
+  }
   return eventActive();
 }
 
@@ -275,7 +294,7 @@ void GriffDataReader::actualLoadTracks() const
 #ifndef NDEBUG
   const char * dataE = data + m_fr->nBytesBriefData();
 #endif
-  data += GriffFormat::Format::SIZE_TRACKHEADER;
+  data += trackDataOffset();
 
   unsigned iposp1(1);
   unsigned nsegments(0);
@@ -341,6 +360,30 @@ void GriffDataReader::actualLoadTracks() const
   assert(data==dataE);
 }
 
+const GriffDataRead::EventSummary& GriffDataReader::eventSummary() const
+{
+  assert(eventActive());
+  if (m_needsSummary) {
+    m_needsSummary = false;
+    GriffDataReader * self = const_cast<GriffDataReader*>(this);
+    const char * data = m_fr->getBriefData() + GriffFormat::Format::SIZE_TRACKHEADER;
+    if (rawModeWord()&GriffFormat::Format::MODEFLAG_SUMMARY)
+      m_summary.setFromStored(self,data,nTracks(),rawModeWord()&GriffFormat::Format::MODEFLAG_VETOCOUNT);
+    else
+      m_summary.setFromTracks(self,data,nTracks());
+  }
+  return m_summary;
+}
+
+bool GriffDataReader::actualPassPreselection()
+{
+  assert(m_preselection);
+  if (m_preselection->acceptEvent(eventSummary()))
+    return true;
+  m_needsSummary = true;
+  return false;
+}
+
 bool GriffDataReader::setupChangedFullCheck(EvtFile::index_type current_mdidx)
 {
   assert(eventActive());
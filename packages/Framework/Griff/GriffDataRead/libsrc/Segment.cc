@@ -3,6 +3,9 @@
 #include "GriffDataRead/Track.hh"
 #include "GriffDataRead/GriffDataReader.hh"
 #include "GriffDataRead/DumpObj.hh"
+#include "GriffFormat/OctahedralPack.hh"
+#include <cstring>
+#include <stdexcept>
 
 const GriffDataRead::Touchable& GriffDataRead::Segment::getTouchable() const
 {
@@ -21,6 +24,65 @@ double GriffDataRead::Segment::segmentLength() const
   return sl;
 }
 
+namespace GriffDataRead {
+  namespace {
+    template<class T>
+    void put(char*& o, T val)
+    {
+      std::memcpy(o,&val,sizeof(T));
+      o += sizeof(T);
+    }
+    //Decode step data in the compact encoding (see
+    //GriffFormat::Format::STEPENCODING_COMPACT) into a buffer with the layout
+    //of the standard encoding, which is then owned by the pool (input is read
+    //with memcpy, so no assumptions are made about its alignment):
+    const char * decodeCompactSteps(const char * in, unsigned nsteps, std::vector<char*>& pool)
+    {
+      namespace GF = GriffFormat;
+      char * out = new char[GF::Format::SIZE_STEPHEADER+nsteps*(GF::Format::SIZE_STEPPREPOSTPART+GF::Format::SIZE_STEPOTHERPART)
+                            +GF::Format::SIZE_STEPPREPOSTPART];
+      pool.push_back(out);
+      //The header and the first step point are stored as in the standard encoding:
+      std::memcpy(out,in,GF::Format::SIZE_STEPHEADER+GF::Format::SIZE_STEPPREPOSTPART);
+      in += GF::Format::SIZE_STEPHEADER;
+      double ref[4];//x,y,z,t
+      std::memcpy(ref,in,sizeof(ref));
+      in += GF::Format::SIZE_STEPPREPOSTPART;
+      char * o = out + GF::Format::SIZE_STEPHEADER + GF::Format::SIZE_STEPPREPOSTPART;
+      float f[9];//position and time deltas, eKin, locpos and momentum magnitude
+      std::uint16_t pdir[2];
+      double dir[3];
+      for (unsigned i = 0; i < nsteps; ++i) {
+        //edep, edep_nonion, steplength and status are stored as in the standard encoding:
+        std::memcpy(o,in,GF::Format::SIZE_STEPOTHERPART);
+        o += GF::Format::SIZE_STEPOTHERPART;
+        in += GF::Format::SIZE_STEPOTHERPART_COMPACT;
+        static_assert(GF::Format::SIZE_STEPOTHERPART_COMPACT==GF::Format::SIZE_STEPOTHERPART);
+        //next step point (position and time as deltas, eKin as float, momentum
+        //as magnitude and packed direction):
+        std::memcpy(f,in,sizeof(f));
+        std::memcpy(pdir,in+sizeof(f),sizeof(pdir));
+        for (unsigned j = 0; j < 4; ++j)
+          put(o,(ref[j] += f[j]));
+        put(o,double(f[4]));
+        for (unsigned j = 5; j < 8; ++j)
+          put(o,f[j]);//locpos
+        GriffFormat::unpackOctahedral(pdir,dir);
+        for (unsigned j = 0; j < 3; ++j)
+          put(o,float(f[8]*dir[j]));//mom
+        std::memcpy(o,in+sizeof(f)+sizeof(pdir),sizeof(EvtFile::index_type));//process
+        o += sizeof(EvtFile::index_type);
+        in += GF::Format::SIZE_STEPPREPOSTPART_COMPACT;
+        static_assert(GF::Format::SIZE_STEPPREPOSTPART_COMPACT==sizeof(f)+sizeof(pdir)+sizeof(EvtFile::index_type));
+        static_assert(GF::Format::SIZE_STEPPREPOSTPART==5*sizeof(double)+6*sizeof(float)+sizeof(EvtFile::index_type));
+      }
+      assert(o==out+GF::Format::SIZE_STEPHEADER+nsteps*(GF::Format::SIZE_STEPPREPOSTPART+GF::Format::SIZE_STEPOTHERPART)
+             +GF::Format::SIZE_STEPPREPOSTPART);
+      return out;
+    }
+  }
+}
+
 void GriffDataRead::Segment::actualSetupSteps() const
 {
   assert(!m_stepsBegin);
@@ -31,9 +93,27 @@ void GriffDataRead::Segment::actualSetupSteps() const
     return;
   }
   GriffDataReader * dr = m_trk->m_dr;
-  const char * stepdata = dr->m_fr->getFullData() + rawstep;
-  unsigned nsteps_stored = ByteStream::interpret<std::uint32_t>(stepdata + 4);
+  //Only request the step data of this segment (if the step section was
+  //compressed in chunks, other chunks thus stay compressed):
+  EvtFile::FileReader * fr = dr->m_fr;
+  unsigned nsteps_stored = ByteStream::interpret<std::uint32_t>(fr->getFullData(rawstep,GriffFormat::Format::SIZE_STEPHEADER) + 4);
   assert(nsteps_stored>=1);
+  const char * stepdata;
+  if (dr->eventStepEncoding()==GriffFormat::Format::STEPENCODING_STANDARD) {
+    stepdata = fr->getFullData(rawstep,GriffFormat::Format::SIZE_STEPHEADER
+                               +nsteps_stored*(GriffFormat::Format::SIZE_STEPPREPOSTPART+GriffFormat::Format::SIZE_STEPOTHERPART)
+                               +GriffFormat::Format::SIZE_STEPPREPOSTPART);//post step point of last step
+  } else {
+    if (dr->eventStepEncoding()!=GriffFormat::Format::STEPENCODING_COMPACT) {
+      printf("GriffDataReader ERROR: Unknown step encoding in input file (written with newer software?)\n");
+      throw std::runtime_error("Unknown Griff step encoding");
+    }
+    stepdata = decodeCompactSteps(fr->getFullData(rawstep,GriffFormat::Format::SIZE_STEPHEADER
+                                                  +nsteps_stored*(GriffFormat::Format::SIZE_STEPPREPOSTPART_COMPACT
+                                                                  +GriffFormat::Format::SIZE_STEPOTHERPART_COMPACT)
+                                                  +GriffFormat::Format::SIZE_STEPPREPOSTPART),
+                                  nsteps_stored,dr->m_mempool_dynamic);
+  }
   stepdata+=GriffFormat::Format::SIZE_STEPHEADER;
   static_assert(GriffFormat::Format::SIZE_STEPHEADER==8);
   //Get memory big enough to store nsteps_stored Step objects:
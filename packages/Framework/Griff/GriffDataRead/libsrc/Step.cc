@@ -3,19 +3,10 @@
 
 const std::string& GriffDataRead::Step::stepStatusStr() const
 {
-  static std::string status_strings[8];
-  static bool needs_init = true;
-  if (needs_init) {
-    needs_init = false;
-    status_strings[0] = "WorldBoundary";
-    status_strings[1] = "GeomBoundary";
-    status_strings[2] = "AtRestDoItProc";
-    status_strings[3] = "AlongStepDoItProc";
-    status_strings[4] = "PostStepDoItProc";
-    status_strings[5] = "UserDefinedLimit";
-    status_strings[6] = "ExclusivelyForcedProc";
-    status_strings[7] = "Undefined";
-  }
+  //initialised in a thread-safe manner (readers might live in different threads):
+  static const std::string status_strings[8] = { "WorldBoundary", "GeomBoundary", "AtRestDoItProc",
+                                                 "AlongStepDoItProc", "PostStepDoItProc", "UserDefinedLimit",
+                                                 "ExclusivelyForcedProc", "Undefined" };
   unsigned s(stepStatus_raw());
   assert(s<8);
   return status_strings[s];
@@ -0,0 +1,287 @@
+#include <pybind11/numpy.h>
+
+//Bulk columnar access to tracks, segments and steps for numpy based analysis:
+//all requested quantities are extracted in a single C++ pass over the event(s)
+//into std::vectors, whose buffers are then handed over to numpy arrays without
+//copying.
+
+namespace GDR_arrays {
+  namespace {
+    using Track = GriffDataRead::Track;
+    using Segment = GriffDataRead::Segment;
+    using Step = GriffDataRead::Step;
+
+    //A field is either floating point (stored as double) or integral (stored
+    //as int64). The row context gives access to the enclosing objects:
+    struct Row {
+      const GriffDataReader * dr;
+      const Track * trk;
+      const Segment * seg;
+      const Step * step;
+    };
+    struct Field {
+      const char * name;
+      double (*getDbl)(const Row&);
+      std::int64_t (*getInt)(const Row&);
+    };
+
+#define GDR_DBLFIELD(name,expr) { name, [](const Row& r) -> double { return (expr); }, nullptr }
+#define GDR_INTFIELD(name,expr) { name, nullptr, [](const Row& r) -> std::int64_t { return (expr); } }
+
+    //Fields common to all three kinds of rows:
+#define GDR_COMMONFIELDS                                        \
+    GDR_INTFIELD("runNumber",r.dr->runNumber()),                \
+    GDR_INTFIELD("eventNumber",r.dr->eventNumber()),            \
+    GDR_INTFIELD("trackID",r.trk->trackID()),                   \
+    GDR_INTFIELD("parentID",r.trk->parentID()),                 \
+    GDR_INTFIELD("pdgCode",r.trk->pdgCode())
+
+    const Field s_trackFields[] = {
+      GDR_COMMONFIELDS,
+      GDR_INTFIELD("nDaughters",r.trk->nDaughters()),
+      GDR_INTFIELD("nSegments",r.trk->nSegments()),
+      GDR_INTFIELD("isPrimary",r.trk->isPrimary()),
+      GDR_DBLFIELD("weight",r.trk->weight()),
+      GDR_DBLFIELD("startTime",r.trk->startTime()),
+      GDR_DBLFIELD("startEKin",r.trk->startEKin())
+    };
+
+    const Field s_segmentFields[] = {
+      GDR_COMMONFIELDS,
+      GDR_INTFIELD("iSegment",r.seg->iSegment()),
+      GDR_INTFIELD("nStepsOriginal",r.seg->nStepsOriginal()),
+      GDR_INTFIELD("volumeCopyNumber",r.seg->volumeCopyNumber()),
+      GDR_INTFIELD("startAtVolumeBoundary",r.seg->startAtVolumeBoundary()),
+      GDR_INTFIELD("endAtVolumeBoundary",r.seg->endAtVolumeBoundary()),
+      GDR_INTFIELD("nextWasFiltered",r.seg->nextWasFiltered()),
+      GDR_DBLFIELD("startTime",r.seg->startTime()),
+      GDR_DBLFIELD("endTime",r.seg->endTime()),
+      GDR_DBLFIELD("startEKin",r.seg->startEKin()),
+      GDR_DBLFIELD("endEKin",r.seg->endEKin()),
+      GDR_DBLFIELD("eDep",r.seg->eDep()),
+      GDR_DBLFIELD("eDepNonIonising",r.seg->eDepNonIonising())
+    };
+
+    const Field s_stepFields[] = {
+      GDR_COMMONFIELDS,
+      GDR_INTFIELD("iSegment",r.seg->iSegment()),
+      GDR_INTFIELD("iStep",r.step->iStep()),
+      GDR_INTFIELD("stepStatus",r.step->stepStatus()),
+      GDR_INTFIELD("preAtVolEdge",r.step->preAtVolEdge()),
+      GDR_INTFIELD("postAtVolEdge",r.step->postAtVolEdge()),
+      GDR_DBLFIELD("eDep",r.step->eDep()),
+      GDR_DBLFIELD("eDepNonIonising",r.step->eDepNonIonising()),
+      GDR_DBLFIELD("stepLength",r.step->stepLength()),
+      GDR_DBLFIELD("preTime",r.step->preTime()),
+      GDR_DBLFIELD("postTime",r.step->postTime()),
+      GDR_DBLFIELD("preEKin",r.step->preEKin()),
+      GDR_DBLFIELD("postEKin",r.step->postEKin()),
+      GDR_DBLFIELD("preGlobalX",r.step->preGlobalX()),
+      GDR_DBLFIELD("preGlobalY",r.step->preGlobalY()),
+      GDR_DBLFIELD("preGlobalZ",r.step->preGlobalZ()),
+      GDR_DBLFIELD("postGlobalX",r.step->postGlobalX()),
+      GDR_DBLFIELD("postGlobalY",r.step->postGlobalY()),
+      GDR_DBLFIELD("postGlobalZ",r.step->postGlobalZ()),
+      GDR_DBLFIELD("preLocalX",r.step->preLocalX()),
+      GDR_DBLFIELD("preLocalY",r.step->preLocalY()),
+      GDR_DBLFIELD("preLocalZ",r.step->preLocalZ()),
+      GDR_DBLFIELD("postLocalX",r.step->postLocalX()),
+      GDR_DBLFIELD("postLocalY",r.step->postLocalY()),
+      GDR_DBLFIELD("postLocalZ",r.step->postLocalZ()),
+      GDR_DBLFIELD("preMomentumX",r.step->preMomentumX()),
+      GDR_DBLFIELD("preMomentumY",r.step->preMomentumY()),
+      GDR_DBLFIELD("preMomentumZ",r.step->preMomentumZ()),
+      GDR_DBLFIELD("postMomentumX",r.step->postMomentumX()),
+      GDR_DBLFIELD("postMomentumY",r.step->postMomentumY()),
+      GDR_DBLFIELD("postMomentumZ",r.step->postMomentumZ())
+    };
+
+#undef GDR_COMMONFIELDS
+#undef GDR_INTFIELD
+#undef GDR_DBLFIELD
+
+    enum class Kind { Track, Segment, Step };
+
+    template <std::size_t N>
+    void selectFields(const Field (&avail)[N], py::object fieldnames, std::vector<const Field*>& out)
+    {
+      if (fieldnames.is_none()) {
+        for (auto& f : avail)
+          out.push_back(&f);
+        return;
+      }
+      for (auto pyname : fieldnames) {
+        std::string name = pyname.cast<std::string>();
+        const Field * found = nullptr;
+        for (auto& f : avail) {
+          if (name==f.name) {
+            found = &f;
+            break;
+          }
+        }
+        if (!found) {
+          std::string msg = "Unknown field \""+name+"\". Available fields are:";
+          for (auto& f : avail)
+            msg += std::string(" ")+f.name;
+          PyErr_SetString(PyExc_ValueError, msg.c_str());
+          throw py::error_already_set();
+        }
+        out.push_back(found);
+      }
+    }
+
+    class Columns {
+    public:
+      Columns(Kind kind, py::object fieldnames)
+        : m_kind(kind)
+      {
+        switch (kind) {
+        case Kind::Track: selectFields(s_trackFields,fieldnames,m_fields); break;
+        case Kind::Segment: selectFields(s_segmentFields,fieldnames,m_fields); break;
+        case Kind::Step: selectFields(s_stepFields,fieldnames,m_fields); break;
+        }
+        m_dbl.resize(m_fields.size());
+        m_int.resize(m_fields.size());
+      }
+
+      //Append the rows of the current event:
+      void addEvent(const GriffDataReader* dr)
+      {
+        Row r{dr,nullptr,nullptr,nullptr};
+        //Segments without step info are skipped (MINIMAL mode, possibly mixed
+        //with segments having full step info):
+        const bool hasSteps = dr->eventStorageMode() != GriffFormat::Format::MODE_MINIMAL || dr->eventHasMixedStorage();
+        auto trkE = dr->trackEnd();
+        for (r.trk = dr->trackBegin(); r.trk!=trkE; ++r.trk) {
+          if (m_kind==Kind::Track) {
+            addRow(r);
+            continue;
+          }
+          auto segE = r.trk->segmentEnd();
+          for (r.seg = r.trk->segmentBegin(); r.seg!=segE; ++r.seg) {
+            if (m_kind==Kind::Segment) {
+              addRow(r);
+              continue;
+            }
+            if (!hasSteps)
+              break;
+            if (!r.seg->hasStepInfo())
+              continue;
+            auto stepE = r.seg->stepEnd();
+            for (r.step = r.seg->stepBegin(); r.step!=stepE; ++r.step)
+              addRow(r);
+          }
+        }
+      }
+
+      //Hand over the buffers to numpy arrays in a dict keyed by field name:
+      py::dict toDict()
+      {
+        py::dict d;
+        for (std::size_t i = 0; i < m_fields.size(); ++i) {
+          if (m_fields[i]->getDbl)
+            d[m_fields[i]->name] = toArray(m_dbl[i]);
+          else
+            d[m_fields[i]->name] = toArray(m_int[i]);
+        }
+        return d;
+      }
+
+    private:
+      void addRow(const Row& r)
+      {
+        const std::size_t n = m_fields.size();
+        for (std::size_t i = 0; i < n; ++i) {
+          const Field * f = m_fields[i];
+          if (f->getDbl)
+            m_dbl[i].push_back(f->getDbl(r));
+          else
+            m_int[i].push_back(f->getInt(r));
+        }
+      }
+
+      template <class T>
+      static py::array_t<T,py::array::c_style> toArray(std::vector<T>& v)
+      {
+        auto owner = new std::vector<T>();
+        owner->swap(v);
+        py::capsule freeWhenDone(owner, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+        return py::array_t<T,py::array::c_style>(owner->size(),owner->data(),freeWhenDone);
+      }
+
+      Kind m_kind;
+      std::vector<const Field*> m_fields;
+      std::vector<std::vector<double> > m_dbl;
+      std::vector<std::vector<std::int64_t> > m_int;
+    };
+
+    void checkEventActive(const GriffDataReader* dr)
+    {
+      if (!dr->eventActive()) {
+        PyErr_SetString(PyExc_RuntimeError, "No active event in GriffDataReader");
+        throw py::error_already_set();
+      }
+    }
+
+    //Current event only:
+    py::dict arrays(GriffDataReader* dr, Kind kind, py::object fieldnames)
+    {
+      checkEventActive(dr);
+      Columns c(kind,fieldnames);
+      c.addEvent(dr);
+      return c.toDict();
+    }
+
+    //Up to nevents events starting with the current one, leaving the reader at
+    //the event following the last one included (so eventActive() is false when
+    //the input is exhausted):
+    py::dict arraysBatch(GriffDataReader* dr, Kind kind, unsigned nevents, py::object fieldnames)
+    {
+      checkEventActive(dr);
+      Columns c(kind,fieldnames);
+      for (unsigned i = 0; i < nevents && dr->eventActive(); ++i) {
+        c.addEvent(dr);
+        dr->goToNextEvent();
+      }
+      return c.toDict();
+    }
+
+    py::list fieldNames(Kind kind)
+    {
+      py::list l;
+      auto add = [&l](const Field* b, const Field* e) { for (;b!=e;++b) l.append(b->name); };
+      switch (kind) {
+      case Kind::Track: add(std::begin(s_trackFields),std::end(s_trackFields)); break;
+      case Kind::Segment: add(std::begin(s_segmentFields),std::end(s_segmentFields)); break;
+      case Kind::Step: add(std::begin(s_stepFields),std::end(s_stepFields)); break;
+      }
+      return l;
+    }
+
+    py::dict trackArrays(GriffDataReader* dr, py::object f) { return arrays(dr,Kind::Track,f); }
+    py::dict segmentArrays(GriffDataReader* dr, py::object f) { return arrays(dr,Kind::Segment,f); }
+    py::dict stepArrays(GriffDataReader* dr, py::object f) { return arrays(dr,Kind::Step,f); }
+    py::dict trackArraysBatch(GriffDataReader* dr, unsigned n, py::object f) { return arraysBatch(dr,Kind::Track,n,f); }
+    py::dict segmentArraysBatch(GriffDataReader* dr, unsigned n, py::object f) { return arraysBatch(dr,Kind::Segment,n,f); }
+    py::dict stepArraysBatch(GriffDataReader* dr, unsigned n, py::object f) { return arraysBatch(dr,Kind::Step,n,f); }
+    py::list trackFieldNames() { return fieldNames(Kind::Track); }
+    py::list segmentFieldNames() { return fieldNames(Kind::Segment); }
+    py::list stepFieldNames() { return fieldNames(Kind::Step); }
+
+    template <class TPyClass>
+    void pyexport( TPyClass& thecls )
+    {
+      thecls
+        .def("trackArrays",&trackArrays,py::arg("fields")=py::none())
+        .def("segmentArrays",&segmentArrays,py::arg("fields")=py::none())
+        .def("stepArrays",&stepArrays,py::arg("fields")=py::none())
+        .def("trackArraysBatch",&trackArraysBatch,py::arg("nevents"),py::arg("fields")=py::none())
+        .def("segmentArraysBatch",&segmentArraysBatch,py::arg("nevents"),py::arg("fields")=py::none())
+        .def("stepArraysBatch",&stepArraysBatch,py::arg("nevents"),py::arg("fields")=py::none())
+        .def_static("trackArrayFields",&trackFieldNames)
+        .def_static("segmentArrayFields",&segmentFieldNames)
+        .def_static("stepArrayFields",&stepFieldNames)
+        ;
+    }
+  }
+}
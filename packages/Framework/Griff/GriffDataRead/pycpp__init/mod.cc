@@ -8,6 +8,7 @@
 #include "GriffDataRead/Material.hh"
 #include "GriffDataRead/Element.hh"
 #include "GriffDataRead/Isotope.hh"
+#include "GriffDataRead/EventSummary.hh"
 
 namespace {
   template < typename T>
@@ -21,6 +22,7 @@ namespace {
 #include "segment.hh"
 #include "track.hh"
 #include "materials.hh"
+#include "arrays.hh"
 
 namespace {
   py::dict pyGriffDataReadSetup_metaData(GriffDataRead::Setup*self)
@@ -58,6 +60,20 @@ namespace {
   void pyGriffDataRead_GeoParams_dump_0args(GriffDataRead::GeoParams*self) { self->dump(); }
   void pyGriffDataRead_GenParams_dump_0args(GriffDataRead::GenParams*self) { self->dump(); }
   void pyGriffDataRead_FilterParams_dump_0args(GriffDataRead::FilterParams*self) { self->dump(); }
+
+  //Preselection implemented by a python callable taking an EventSummary:
+  struct PyEventPreselection : public GriffDataRead::EventPreselection {
+    PyEventPreselection(py::object fct) : m_fct(fct) {}
+    bool acceptEvent(const GriffDataRead::EventSummary& s) override
+    {
+      return m_fct(py::cast(&s,py::return_value_policy::reference)).cast<bool>();
+    }
+    py::object m_fct;
+  };
+
+  void pyGriffDataReader_setEventPreselection(GriffDataReader*self, PyEventPreselection* p) { self->setEventPreselection(p); }
+  const char* pyEventSummary_volumeName_1arg(GriffDataRead::EventSummary*self,unsigned i) { return self->volumeName(i).c_str(); }
+  const char* pyEventSummary_volumeName(GriffDataRead::EventSummary*self,unsigned i,unsigned idepth) { return self->volumeName(i,idepth).c_str(); }
 }
 
 PYTHON_MODULE( mod )
@@ -108,7 +124,30 @@ PYTHON_MODULE( mod )
     .def("dump",&pyGriffDataReadSetup_dump_0args)
     ;
 
-  py::class_<GriffDataReader,std::shared_ptr<GriffDataReader>>(mod,"GriffDataReader")
+  py::class_<GriffDataRead::EventSummary,
+             std::unique_ptr<GriffDataRead::EventSummary, BlankDeleter<GriffDataRead::EventSummary>>>(mod,"EventSummary")
+    .def("nTracks",&GriffDataRead::EventSummary::nTracks)
+    .def("nPDGCodes",&GriffDataRead::EventSummary::nPDGCodes)
+    .def("pdgCode",&GriffDataRead::EventSummary::pdgCode)
+    .def("hasPDGCode",&GriffDataRead::EventSummary::hasPDGCode)
+    .def("nTouchables",&GriffDataRead::EventSummary::nTouchables)
+    .def("touchableIndex",&GriffDataRead::EventSummary::touchableIndex)
+    .def("eDep",&GriffDataRead::EventSummary::eDep)
+    .def("volumeName",&pyEventSummary_volumeName_1arg)
+    .def("volumeName",&pyEventSummary_volumeName)
+    .def("eDepTotal",&GriffDataRead::EventSummary::eDepTotal)
+    .def("eDepInVolume",&GriffDataRead::EventSummary::eDepInVolume)
+    .def("visitedVolume",&GriffDataRead::EventSummary::visitedVolume)
+    .def("isStored",&GriffDataRead::EventSummary::isStored)
+    .def("nVetoedBefore",&GriffDataRead::EventSummary::nVetoedBefore)
+    ;
+
+  py::class_<PyEventPreselection>(mod,"EventPreselection")
+    .def(py::init<py::object>())
+    ;
+
+  py::class_<GriffDataReader,std::shared_ptr<GriffDataReader>> pyDR(mod,"GriffDataReader");
+  pyDR
     .def(py::init<std::string>())
     .def(py::init( []( py::list l )
     {
@@ -144,6 +183,8 @@ PYTHON_MODULE( mod )
     .def("nPrimaryTracks",&GriffDataReader::nPrimaryTracks)
     .def("loopEvents",&GriffDataReader::loopEvents)
     .def("eventStorageMode",&GriffDataReader::eventStorageModeStr)
+    .def("eventHasMixedStorage",&GriffDataReader::eventHasMixedStorage)
+    .def("eventStepEncoding",&GriffDataReader::eventStepEncodingStr)
     .def("seed",&GriffDataReader::seed)
     .def("seedStr",&GriffDataReader::seedStr)
     .def("getTrack",&GriffDataReader::getTrack,py::return_value_policy::reference)
@@ -152,12 +193,16 @@ PYTHON_MODULE( mod )
     .def("setup",&GriffDataReader::setup,py::return_value_policy::reference)
     .def("allowSetupChange",&GriffDataReader::allowSetupChange)
     .def("loopCount",&GriffDataReader::loopCount)
+    .def("setPrefetch",&GriffDataReader::setPrefetch,py::arg("nthreads"),py::arg("depth")=0)
     .def_static("setOpenMsg",&GriffDataReader::setOpenMsg)
     .def_static("openMsg",&GriffDataReader::openMsg)
     .def("seekEventByIndexInCurrentFile",&GriffDataReader::seekEventByIndexInCurrentFile)
     .def("eventIndexInCurrentFile",&GriffDataReader::eventIndexInCurrentFile)
     .def("eventCheckSum",&GriffDataReader::eventCheckSum)
     .def("verifyEventDataIntegrity",&GriffDataReader::verifyEventDataIntegrity)
+    .def("eventSummary",&GriffDataReader::eventSummary,py::return_value_policy::reference)
+    .def("_setEventPreselection",&pyGriffDataReader_setEventPreselection,py::keep_alive<1,2>())
     ;
+  GDR_arrays::pyexport(pyDR);
 
 }
@@ -43,6 +43,7 @@ namespace GDR_segment {
         .def("nextWasFiltered",&Segment::nextWasFiltered)
         .def("getStep",&Segment::getStep,py::return_value_policy::reference)
         .def("hasStepInfo",&Segment::hasStepInfo)
+        .def("hasFullStepInfo",&Segment::hasFullStepInfo)
         .def("stepBegin",&Segment::stepBegin,py::return_value_policy::reference)
         .def("stepEnd",&Segment::stepEnd,py::return_value_policy::reference)
         .def("firstStep",&Segment::firstStep,py::return_value_policy::reference)
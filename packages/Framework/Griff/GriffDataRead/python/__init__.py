@@ -54,3 +54,8 @@ def _dr_trk_iter(self):
         yield t
         i+=1
 GriffDataReader.tracks = property(_dr_trk_iter)
+
+def _dr_setEventPreselection(self,fct):
+    """Skip events for which fct(eventsummary) is not True (pass None to remove)"""
+    self._setEventPreselection(EventPreselection(fct) if fct is not None else None)
+GriffDataReader.setEventPreselection = _dr_setEventPreselection
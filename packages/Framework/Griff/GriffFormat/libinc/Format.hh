@@ -43,6 +43,40 @@ namespace GriffFormat {
     //2) coalesce adjacent steps in the same volume(/filtered sequence) => all segments will have just 1 step
     //3) minimal => no step info at all, just tracks and segments.
 
+    //The mode word in the track header can carry flags in the bits above MODE_MASK:
+    static const std::uint32_t MODE_MASK = 0xFF;
+    //Event summary block follows the track header. It consists of 32bit words
+    //with the size in bytes of the block (including this word) and the number
+    //of unique pdg codes, followed by the sorted pdg codes, the number of
+    //touchables visited and finally that many pairs of (touchable index, float
+    //with total energy deposit), sorted by touchable index:
+    static const std::uint32_t MODEFLAG_SUMMARY = 0x100;
+    //Set (along with MODEFLAG_SUMMARY) when events were vetoed by the writer,
+    //in which case the summary block ends with an extra 32bit word holding the
+    //number of events vetoed since the previous event in the file:
+    static const std::uint32_t MODEFLAG_VETOCOUNT = 0x200;
+    //Set when some segments were nevertheless written with full step data in
+    //REDUCED or MINIMAL mode. Such segments are encoded exactly as in FULL
+    //mode, with a step offset and as many steps stored as were simulated,
+    //while the other segments are encoded according to the mode:
+    static const std::uint32_t MODEFLAG_MIXED = 0x400;
+
+    //Encoding of the steps in the full data section, stored in the mode word
+    //bits covered by STEPENCODING_MASK. In both encodings the step data of a
+    //segment starts with a header (SIZE_STEPHEADER) and the pre step point of
+    //the first step (SIZE_STEPPREPOSTPART), followed by the rest of each step
+    //(the "other part" and the post step point). In the compact encoding these
+    //use SIZE_STEPOTHERPART_COMPACT and SIZE_STEPPREPOSTPART_COMPACT bytes:
+    //the other part is unchanged, while the global position and time of the
+    //step points are stored as float deltas to the previous step point (as
+    //decoded by readers, so errors do not accumulate), the kinetic energy as a
+    //float, and the momentum as a float magnitude and a direction packed with
+    //packOctahedral (see OctahedralPack.hh). All sizes are multiples of 4
+    //bytes, keeping the data aligned:
+    enum STEPENCODING { STEPENCODING_STANDARD=0, STEPENCODING_COMPACT=1 };
+    static const std::uint32_t STEPENCODING_MASK = 0xF000;
+    static const unsigned STEPENCODING_SHIFT = 12;
+
     //For the implementation of file writer/reader we provide a common reference of expected sizes:
     static const unsigned SIZE_TRACKHEADER = sizeof(std::uint32_t)*2+sizeof(std::uint64_t)+sizeof(EvtFile::index_type);
     static const unsigned SIZE_PER_TRACK_WO_DAUGHTERLIST = sizeof(std::uint32_t)*5+sizeof(float)+sizeof(EvtFile::index_type);
@@ -53,6 +87,8 @@ namespace GriffFormat {
     static const unsigned SIZE_STEPHEADER = 2*sizeof(std::uint32_t);
     static const unsigned SIZE_STEPPREPOSTPART = 68;
     static const unsigned SIZE_STEPOTHERPART = 3*sizeof(float)+sizeof(std::uint32_t);
+    static const unsigned SIZE_STEPPREPOSTPART_COMPACT = 9*sizeof(float)+2*sizeof(std::uint16_t)+sizeof(EvtFile::index_type);
+    static const unsigned SIZE_STEPOTHERPART_COMPACT = SIZE_STEPOTHERPART;
 
   private:
     Format(){}
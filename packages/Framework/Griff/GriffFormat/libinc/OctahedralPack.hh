@@ -0,0 +1,47 @@
+#ifndef GriffFormat_OctahedralPack_hh
+#define GriffFormat_OctahedralPack_hh
+
+#include "Core/Types.hh"
+#include <cmath>
+
+//Quantised octahedral packing of directions into two 16 bit integers, as used
+//for the momenta in the compact step encoding. The direction is projected onto
+//the octahedron |x|+|y|+|z|=1, the lower half of which is folded over the
+//upper half, mapping it onto the square [-1,1]x[-1,1] where each coordinate is
+//stored with 16 bits. The angular error after unpacking is below 1e-4. Null
+//vectors unpack to (0,0,1).
+
+namespace GriffFormat {
+
+  inline void packOctahedral(const float * v, std::uint16_t * out)
+  {
+    const double l1 = std::fabs(v[0])+std::fabs(v[1])+std::fabs(v[2]);
+    double u(l1 ? v[0]/l1 : 0.0), w(l1 ? v[1]/l1 : 0.0);
+    if (v[2]<0.0f) {
+      const double ufold = (1.0-std::fabs(w))*(u<0.0?-1.0:1.0);
+      w = (1.0-std::fabs(u))*(w<0.0?-1.0:1.0);
+      u = ufold;
+    }
+    out[0] = static_cast<std::uint16_t>(std::lround(u*32767.0)+32767);
+    out[1] = static_cast<std::uint16_t>(std::lround(w*32767.0)+32767);
+  }
+
+  inline void unpackOctahedral(const std::uint16_t * in, double * v)
+  {
+    double u = (int(in[0])-32767)*(1.0/32767.0);
+    double w = (int(in[1])-32767)*(1.0/32767.0);
+    const double z = 1.0-std::fabs(u)-std::fabs(w);
+    if (z<0.0) {
+      const double ufold = (1.0-std::fabs(w))*(u<0.0?-1.0:1.0);
+      w = (1.0-std::fabs(u))*(w<0.0?-1.0:1.0);
+      u = ufold;
+    }
+    const double norm = 1.0/std::sqrt(u*u+w*w+z*z);
+    v[0] = u*norm;
+    v[1] = w*norm;
+    v[2] = z*norm;
+  }
+
+}
+
+#endif
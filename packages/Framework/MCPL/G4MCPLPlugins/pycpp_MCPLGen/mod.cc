@@ -11,6 +11,8 @@
 #include "CLHEP/Geometry/Vector3D.h"
 #include "CLHEP/Geometry/Transform3D.h"
 #include <map>
+#include <vector>
+#include <limits>
 #include <stdexcept>
 #include "G4ParticleTable.hh"
 #include "G4IonTable.hh"
@@ -30,10 +32,25 @@ protected:
 private:
   void skip_forward(unsigned nskip);
   void delayed_init();
+  void init_ranges();
+  void build_index();
+  const mcpl_particle_t * read_next();
   void setPDG(int);
   mcpl_file_t m_mcplfile;
   const mcpl_particle_t * m_p;//particle to be used for next generation
   bool m_unfiltered;
+  //With mp_ranges, each process reads particles until it reaches the end of
+  //its range (as a position in the file, or as a number of accepted particles
+  //when using the index of mp_balance_filtered):
+  bool m_mp_ranges;
+  std::uint64_t m_rangeEnd;
+  std::uint64_t m_nleft;
+  //Index built before forking, with the file position of every
+  //s_indexStride'th accepted particle (after skip_events):
+  static constexpr std::uint64_t s_indexStride = 1024;
+  bool m_useIndex;
+  std::vector<std::uint64_t> m_index;
+  std::uint64_t m_nAccepted;
   G4ParticleGun * m_gun;
   std::map<int,G4ParticleDefinition*> m_pdg2pdef;
   int m_nprocs;
@@ -52,6 +69,11 @@ MCPLGen::MCPLGen()
   : ParticleGenBase("G4MCPLPlugins/MCPLGen"),
     m_p(0),
     m_unfiltered(true),
+    m_mp_ranges(false),
+    m_rangeEnd(std::numeric_limits<std::uint64_t>::max()),
+    m_nleft(std::numeric_limits<std::uint64_t>::max()),
+    m_useIndex(false),
+    m_nAccepted(0),
     m_gun(0),
     m_nprocs(0),
     m_lastpdgcode(0),
@@ -81,6 +103,16 @@ MCPLGen::MCPLGen()
   //If not set, input events with weight=0 triggers an error.
   addParameterBoolean("allow_zero_weight",false);
 
+  //When multi-processing, each process by default reads the whole file,
+  //using every N'th particle. With mp_ranges, process i instead reads only
+  //the i'th of N contiguous ranges of the file (seeking directly to it), so
+  //each particle is read and filtered just once. The ranges are of equal
+  //size in the file, unless mp_balance_filtered is also set, in which case a
+  //single pass over the file before forking indexes the particles accepted by
+  //the input_filter, so each process gets the same number of them:
+  addParameterBoolean("mp_ranges",false);
+  addParameterBoolean("mp_balance_filtered",false);
+
 }
 
 MCPLGen::~MCPLGen()
@@ -117,6 +149,11 @@ bool MCPLGen::validateParameters()
 
   m_unfiltered = ( m_eval_filter.isConstant() && m_eval_filter() );
 
+  if (getParameterBoolean("mp_balance_filtered")&&!getParameterBoolean("mp_ranges")) {
+    printf("MCPLGen ERROR - mp_balance_filtered requires mp_ranges to be enabled\n");
+    return false;
+  }
+
   return true;
 }
 
@@ -135,8 +172,16 @@ void MCPLGen::init()
   m_rotation = HepGeom::RotateZ3D(rotz)* HepGeom::RotateY3D(roty) * HepGeom::RotateX3D(rotx);
 
   m_allow_zero_weight = getParameterBoolean("allow_zero_weight");
+  m_mp_ranges = getParameterBoolean("mp_ranges");
+  //The index is only needed to split the input between several processes:
+  m_useIndex = m_mp_ranges && !m_unfiltered && getParameterBoolean("mp_balance_filtered")
+               && FrameworkGlobals::forkScheduled();
 
   m_gun = new G4ParticleGun(1);
+
+  //The index must be shared by all processes, so build it before forking:
+  if (m_useIndex)
+    build_index();
 }
 
 void MCPLGen::skip_forward(unsigned nskip) {
@@ -155,38 +200,118 @@ void MCPLGen::skip_forward(unsigned nskip) {
   }
 }
 
-void MCPLGen::delayed_init()
+const mcpl_particle_t * MCPLGen::read_next()
 {
-  //opening files should happen after fork() when multi-processing.
-  std::string fn = getParameterString("input_file");
-  std::string fn_resolved = Core::findData(fn);
-  if (fn_resolved.empty()) {
-    printf("MCPLGen ERROR - File specified in input_file parameter not found : \"%s\"\n",fn.c_str());
-    throw std::runtime_error("MCPLGen: File specified in input_file parameter not found");
+  //Next particle passing the filter (within the range of this process):
+  while (m_nleft) {
+    if (mcpl_currentposition(m_mcplfile)>=m_rangeEnd)
+      return nullptr;
+    auto p = mcpl_read(m_mcplfile);
+    if (!p)
+      return nullptr;
+    if (!m_unfiltered) {
+      m_builder.setCurrentParticle(p);
+      if (!m_eval_filter())
+        continue;
+    }
+    if (m_nleft!=std::numeric_limits<std::uint64_t>::max())
+      --m_nleft;
+    return p;
   }
+  return nullptr;
+}
 
-  m_mcplfile = mcpl_open_file(fn_resolved.c_str());
+namespace {
+  mcpl_file_t open_input(const std::string& fn)
+  {
+    std::string fn_resolved = Core::findData(fn);
+    if (fn_resolved.empty()) {
+      printf("MCPLGen ERROR - File specified in input_file parameter not found : \"%s\"\n",fn.c_str());
+      throw std::runtime_error("MCPLGen: File specified in input_file parameter not found");
+    }
+    return mcpl_open_file(fn_resolved.c_str());
+  }
+}
 
-  m_has_polarisation = mcpl_hdr_has_polarisation(m_mcplfile);
+void MCPLGen::build_index()
+{
+  //Temporarily open the file (the real file handle is opened after forking):
+  assert(!m_mcplfile.internal);
+  m_mcplfile = open_input(getParameterString("input_file"));
+  unsigned nskip = getParameterInt("skip_events");
+  if (nskip)
+    skip_forward(nskip);
+  m_index.clear();
+  m_nAccepted = 0;
+  while (true) {
+    std::uint64_t pos = mcpl_currentposition(m_mcplfile);
+    auto p = mcpl_read(m_mcplfile);
+    if (!p)
+      break;
+    m_builder.setCurrentParticle(p);
+    if (!m_eval_filter())
+      continue;
+    if (m_nAccepted%s_indexStride==0)
+      m_index.push_back(pos);
+    ++m_nAccepted;
+  }
+  mcpl_close_file(m_mcplfile);
+  m_mcplfile.internal = 0;
+  printf("MCPLGen: Indexed %llu particles accepted by the input_filter\n",(long long unsigned)m_nAccepted);
+}
 
+void MCPLGen::init_ranges()
+{
+  const std::uint64_t nprocs = m_nprocs;
+  const std::uint64_t iproc = FrameworkGlobals::isForked() ? FrameworkGlobals::mpID() : 0;
+  if (m_useIndex) {
+    //Equal numbers of accepted particles, starting from the nearest indexed
+    //position:
+    std::uint64_t ibegin = iproc*m_nAccepted/nprocs;
+    std::uint64_t iend = (iproc+1)*m_nAccepted/nprocs;
+    m_nleft = iend - ibegin;
+    if (!m_nleft)
+      return;
+    mcpl_seek(m_mcplfile,m_index.at(ibegin/s_indexStride));
+    unsigned nskip = (unsigned)(ibegin%s_indexStride);
+    if (nskip)
+      skip_forward(nskip);
+    return;
+  }
+  //Equal numbers of particles in the file:
   unsigned nskip = getParameterInt("skip_events");
   if (nskip)
     skip_forward(nskip);
+  std::uint64_t first = mcpl_currentposition(m_mcplfile);
+  std::uint64_t ntot = mcpl_hdr_nparticles(m_mcplfile);
+  std::uint64_t n = ntot > first ? ntot - first : 0;
+  std::uint64_t begin = first + iproc*n/nprocs;
+  m_rangeEnd = first + (iproc+1)*n/nprocs;
+  mcpl_seek(m_mcplfile,begin);//OK if failed, we will catch it in next mcpl_read.
+}
 
-  m_nprocs = FrameworkGlobals::nProcs();
+void MCPLGen::delayed_init()
+{
+  //opening files should happen after fork() when multi-processing.
+  m_mcplfile = open_input(getParameterString("input_file"));
 
-  if (m_nprocs!=1&&FrameworkGlobals::mpID())
-    skip_forward(FrameworkGlobals::mpID());
+  m_has_polarisation = mcpl_hdr_has_polarisation(m_mcplfile);
 
-  m_p = mcpl_read(m_mcplfile);
-  if (m_unfiltered)
-    return;
-  while(m_p) {
-    m_builder.setCurrentParticle(m_p);
-    if (m_eval_filter())
-      return;
-    m_p = mcpl_read(m_mcplfile);
+  m_nprocs = FrameworkGlobals::nProcs();
+
+  if (m_mp_ranges&&m_nprocs>1) {
+    init_ranges();
+  } else {
+    //Every N'th particle, or all of them in a single process (where mp_ranges
+    //has no effect):
+    unsigned nskip = getParameterInt("skip_events");
+    if (nskip)
+      skip_forward(nskip);
+    if (m_nprocs!=1&&FrameworkGlobals::mpID())
+      skip_forward(FrameworkGlobals::mpID());
   }
+
+  m_p = read_next();
 }
 
 void MCPLGen::setPDG(int p)
@@ -232,7 +357,8 @@ void MCPLGen::gen(G4Event* evt)
   if (!m_p) {
     //Oups, we don't have a particle to generate in this event! Should only
     //happen if number of (filtered) particles in the file is less than the
-    //number of processes:
+    //number of processes (or with mp_ranges, if the range of this process has
+    //no accepted particles):
     signalEndOfEvents(true);
     return;
   }
@@ -290,20 +416,12 @@ void MCPLGen::gen(G4Event* evt)
   //Finally, find the particle we will simulate in the next event. If not found,
   //we signal this already (thus avoiding an ungraceful abort in the middle of
   //the next event):
-  if (m_nprocs>1) {
+  if (m_nprocs>1&&!m_mp_ranges) {
     //skip over events destined for other processes:
     skip_forward(m_nprocs-1);
   }
 
-  m_p = mcpl_read(m_mcplfile);
-  if (!m_unfiltered) {
-    while(m_p) {
-      m_builder.setCurrentParticle(m_p);
-      if (m_eval_filter())
-        break;
-      m_p = mcpl_read(m_mcplfile);
-    }
-  }
+  m_p = read_next();
   if (!m_p)
     signalEndOfEvents(false);//signal that this will be the last event
 
@@ -2,6 +2,7 @@
 
 #include "G4MCPL/G4MCPLUserFlags.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/MPMergeService.hh"
 #include "G4Interfaces/GeoConstructBase.hh"
 #include "G4Interfaces/ParticleGenBase.hh"
 #include "G4ExprParser/G4SteppingASTBuilder.hh"
@@ -24,11 +25,14 @@ namespace G4MCPLWriter {
   class MCPLSensitiveDetector;
   typedef std::shared_ptr<G4ExprParser::G4SteppingASTBuilder> BuilderPtr;
 
-  class MCPLOutputMerger {
+  class MCPLOutputMerger : public G4Interfaces::MPMerger {
   public:
     MCPLOutputMerger(MCPLSensitiveDetector* sd) : m_sd(sd) {}
-    ~MCPLOutputMerger(){}
-    void merge();
+    virtual ~MCPLOutputMerger(){}
+    const char* mergerName() const { return "MCPLWriter"; }
+    std::vector<std::string> prepareMerge();
+    void mergeFiles(const std::string& target, const std::string& source);
+    void finishMerge(const std::string& merged);
   private:
     MCPLSensitiveDetector * m_sd;
   };
@@ -87,7 +91,6 @@ namespace G4MCPLWriter {
         m_opt_universalweight(universalweight),
         m_initialised(false),
         m_closed(false),
-        m_om(0),
         m_comments_and_blobs(comments_and_blobs)
     {
       std::memset(&m_p,0,sizeof(m_p));
@@ -130,7 +133,6 @@ namespace G4MCPLWriter {
     virtual ~MCPLSensitiveDetector()
     {
       ensure_close_file();
-      delete m_om;
     }
 
     virtual G4bool ProcessHits(G4Step * step,G4TouchableHistory*)
@@ -269,10 +271,7 @@ namespace G4MCPLWriter {
       if (m_opt_universalweight) mcpl_enable_universal_weight(m_f,m_opt_universalweight);
 
       if (FrameworkGlobals::isForked()&&FrameworkGlobals::isParent()) {
-        m_om = new MCPLOutputMerger(this);
-        py::object pylauncher = pyextra::pyimport("G4Launcher").attr("getTheLauncher")();
-        py::object pyhook = py::cast(m_om);
-        pylauncher.attr("postmp_hook")(pyhook);
+        G4Interfaces::MPMergeService::registerMerger(std::make_shared<MCPLOutputMerger>(this));
       }
     }
 
@@ -287,28 +286,30 @@ namespace G4MCPLWriter {
     bool m_closed;
     mcpl_outfile_t m_f;
     mcpl_particle_t m_p;
-    MCPLOutputMerger * m_om;
     std::vector<std::pair<std::string,std::string>> m_comments_and_blobs;
   };
 
-  void MCPLOutputMerger::merge() {
+  std::vector<std::string> MCPLOutputMerger::prepareMerge() {
     m_sd->ensure_close_file();
-    std::string filename = m_sd->filename();
     //Ok, we now have nprocs output files which we need to merge.
+    std::vector<std::string> files;
+    files.push_back(m_sd->filename());
     unsigned nprocs = FrameworkGlobals::nProcs();
     for (unsigned i = 1; i < nprocs; ++i) {
       std::stringstream tmp;
-      tmp << filename << "." << i << ".mcpl";
-      std::string fn2 = tmp.str();
-
-      printf("MCPLWriter: Merging output of proc%i into %s\n",i,filename.c_str());
-      mcpl_merge_inplace(filename.c_str(), fn2.c_str());
-      int r = remove(fn2.c_str());
-      if (r)
-        printf("MCPLWriter WARNING: Could not remove file after merging: %s\n",fn2.c_str());
+      tmp << m_sd->filename() << "." << i << ".mcpl";
+      files.push_back(tmp.str());
     }
-    printf("MCPLWriter: Done merging output from %i processes into file %s\n",nprocs,filename.c_str());
-    mcpl_gzip_file(filename.c_str());
+    return files;
+  }
+
+  void MCPLOutputMerger::mergeFiles(const std::string& target, const std::string& source) {
+    //Appends particles, so the tree reduction keeps them in proc order:
+    mcpl_merge_inplace(target.c_str(), source.c_str());
+  }
+
+  void MCPLOutputMerger::finishMerge(const std::string& merged) {
+    mcpl_gzip_file(merged.c_str());
   }
 
   class MCPLWriter {
@@ -638,9 +639,5 @@ PYTHON_MODULE( mod )
     .def("setKillStrategy",&MCPLWriter::setKillStrategyFromString)
     .def("inithook",&MCPLWriter::inithook)
     ;
-
-  py::class_<MCPLOutputMerger>(mod,"_MCPLOutputMerger")
-    .def("__call__",&MCPLOutputMerger::merge)
-    ;
 }
 
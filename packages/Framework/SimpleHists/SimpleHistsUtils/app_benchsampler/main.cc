@@ -0,0 +1,98 @@
+#include "SimpleHistsUtils/Sampler.hh"
+#include "SimpleHists/Hist1D.hh"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+//Benchmark the time per sampled value of SimpleHists::Sampler, with both the
+//cumulative (binary search) and alias methods, for a histogram with a smooth
+//spectrum plus a few narrow peaks.
+
+namespace {
+  double secondsSince(std::chrono::steady_clock::time_point t0)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  }
+  //Mean of the sampled values is printed, so the compiler can not skip
+  //generating them (and both methods should agree on it):
+  void report(const char* what, double secs, const std::vector<double>& v)
+  {
+    double sum(0.0);
+    for (auto x : v)
+      sum += x;
+    printf("  %-36s : %7.3f ns/value (mean %.6f)\n",what,1e9*secs/v.size(),sum/v.size());
+  }
+  void bench(SimpleHists::Hist1D* h, SimpleHists::Sampler::Method method, const char* methodname,
+             const std::vector<double>& rands)
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    SimpleHists::Sampler sampler(h,1.0,method);
+    printf("  %-36s : %7.3f ms\n",(std::string("init[")+methodname+"]").c_str(),1e3*secondsSince(t0));
+    std::vector<double> out(rands.size());
+    t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < rands.size(); ++i)
+      out[i] = sampler.sample(rands[i]);
+    report((std::string("sample[")+methodname+"]").c_str(),secondsSince(t0),out);
+    t0 = std::chrono::steady_clock::now();
+    sampler.sampleMany(&rands[0],&out[0],rands.size());
+    report((std::string("sampleMany[")+methodname+"]").c_str(),secondsSince(t0),out);
+  }
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> args(argv+1, argv+argc);
+  bool request_help( std::find(args.begin(), args.end(), "-h") != args.end()
+                     || std::find(args.begin(), args.end(), "--help") != args.end() );
+  if (request_help || args.size()>2 ) {
+    printf("\nUsage:\n\n  %s [NBINS [NMILLION]]\n\n"
+           "Samples NMILLION million values (default 10) from a histogram with NBINS\n"
+           "bins (default 100000) with each method and reports the time per value.\n"
+           "\nExample:\n\n"
+           "  %s 1000000 50\n\n",
+           argv[0],argv[0]);
+    return request_help ? 0 : 1;
+  }
+  unsigned nbins = 100000;
+  std::uint64_t nmillion = 10;
+  try {
+    if (args.size()>=1)
+      nbins = (unsigned)std::stoul(args[0]);
+    if (args.size()>=2)
+      nmillion = std::stoull(args[1]);
+  } catch (std::exception&) {
+    nbins = 0;
+  }
+  if (!nbins||!nmillion) {
+    printf("ERROR: Invalid arguments!\n");
+    return 1;
+  }
+
+  SimpleHists::Hist1D h(nbins,0.0,10.0);
+  for (unsigned i = 0; i < nbins; ++i) {
+    double x = h.getBinCenter(i);
+    double w = x*x*std::exp(-x);
+    for (double peak : { 1.5, 4.0, 7.25 })
+      w += 0.5*std::exp(-0.5*(x-peak)*(x-peak)/1e-4);
+    if (i%7==3)
+      w = 0.0;//a few empty bins
+    h.fill(x,w);
+  }
+
+  const std::uint64_t n = nmillion * 1000000;
+  std::vector<double> rands(n);
+  std::mt19937_64 rng(123456789);
+  std::uniform_real_distribution<double> flat(0.0,1.0);
+  for (auto& r : rands)
+    r = flat(rng);
+
+  printf("Sampling %llu values from histogram with %u bins (mean %.6f):\n",(long long unsigned)n,nbins,h.getMean());
+  bench(&h,SimpleHists::Sampler::Method::CUMULATIVE,"CUMULATIVE",rands);
+  bench(&h,SimpleHists::Sampler::Method::ALIAS,"ALIAS",rands);
+  return 0;
+}
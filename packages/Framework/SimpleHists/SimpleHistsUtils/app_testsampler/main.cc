@@ -0,0 +1,110 @@
+#include "SimpleHistsUtils/Sampler.hh"
+#include "SimpleHists/Hist1D.hh"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+//Test that SimpleHists::Sampler reproduces the distribution of a histogram
+//with both the cumulative and alias methods, and that sampleMany gives the
+//same values as sample.
+
+namespace {
+
+  const double s_contents[] = { 1.0, 0.0, 5.0, 2.0, 0.5, 0.0, 8.0, 3.0, 1.0, 0.25 };
+  const unsigned s_nbins = sizeof(s_contents)/sizeof(s_contents[0]);
+
+  //Uniform random numbers in [0,1), identical on all platforms:
+  std::vector<double> randomNumbers(std::size_t n)
+  {
+    std::mt19937_64 rng(123456);
+    std::vector<double> v(n);
+    for (auto& r : v)
+      r = (rng()>>11)*(1.0/9007199254740992.0);
+    return v;
+  }
+
+  bool testMethod(SimpleHists::Hist1D& h, SimpleHists::Sampler::Method method, const char * methodname)
+  {
+    SimpleHists::Sampler sampler(&h,1.0,method);
+    const std::size_t n = 1000000;
+    std::vector<double> rands = randomNumbers(n);
+    std::vector<double> values(n);
+    sampler.sampleMany(&rands[0],&values[0],n);
+
+    unsigned ndiffer(0), noutside(0);
+    std::vector<double> counts(s_nbins,0.0), sums(s_nbins,0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (values[i]!=sampler.sample(rands[i]))
+        ++ndiffer;
+      double x = values[i];
+      if (!(x>=0.0&&x<10.0)) {
+        ++noutside;
+        continue;
+      }
+      unsigned ibin = static_cast<unsigned>(x);
+      counts[ibin] += 1.0;
+      sums[ibin] += x;
+    }
+
+    double total(0.0);
+    for (auto c : s_contents)
+      total += c;
+    double chi2(0.0);
+    unsigned ndf(0), nempty_sampled(0), nbadmean(0);
+    for (unsigned i = 0; i < s_nbins; ++i) {
+      double expected = n*s_contents[i]/total;
+      if (!expected) {
+        if (counts[i])
+          ++nempty_sampled;
+        continue;
+      }
+      chi2 += (counts[i]-expected)*(counts[i]-expected)/expected;
+      ++ndf;
+      //Values are flat within bins (the outermost bins only extend to the
+      //lowest and highest filled values):
+      double lo(std::max(i+0.0,0.5)), hi(std::min(i+1.0,9.5));
+      double mean = sums[i]/counts[i];
+      if (std::fabs(mean-0.5*(lo+hi))>5.0*(hi-lo)*std::sqrt(1.0/(12.0*counts[i])))
+        ++nbadmean;
+    }
+    --ndf;//normalisation
+    //Extremes of the random numbers must give the edges of the filled range:
+    bool edgesok = sampler.sample(0.0)==0.5 && sampler.sample(1.0)==9.5;
+
+    printf("  %-10s : sample==sampleMany %s, values outside range: %u, empty bins sampled: %u\n",
+           methodname,ndiffer?"no":"yes",noutside,nempty_sampled);
+    printf("  %-10s : chi2/ndf below 3: %s, flat within bins: %s, edges ok: %s\n",
+           methodname,chi2/ndf<3.0?"yes":"no",nbadmean?"no":"yes",edgesok?"yes":"no");
+    return !ndiffer && !noutside && !nempty_sampled && chi2/ndf<3.0 && !nbadmean && edgesok;
+  }
+
+}
+
+int main(int,char**) {
+  SimpleHists::Hist1D h(s_nbins,0.0,10.0);
+  for (unsigned i = 0; i < s_nbins; ++i)
+    if (s_contents[i])
+      h.fill(i+0.5,s_contents[i]);
+  printf("Sampling histogram with %u bins:\n",s_nbins);
+  bool ok = testMethod(h,SimpleHists::Sampler::Method::CUMULATIVE,"CUMULATIVE");
+  ok = testMethod(h,SimpleHists::Sampler::Method::ALIAS,"ALIAS") && ok;
+
+  //A scale factor applies to the sampled values:
+  SimpleHists::Sampler scaled(&h,2.0,SimpleHists::Sampler::Method::ALIAS);
+  std::vector<double> rands = randomNumbers(1000);
+  unsigned nbad(0);
+  SimpleHists::Sampler unscaled(&h,1.0,SimpleHists::Sampler::Method::ALIAS);
+  for (auto r : rands)
+    if (scaled.sample(r)!=2.0*unscaled.sample(r))
+      ++nbad;
+  printf("Scale factor applied to all values: %s\n",nbad?"no":"yes");
+  if (nbad||!ok) {
+    printf("ERROR: Sampled distribution is not as expected\n");
+    return 1;
+  }
+  return 0;
+}
@@ -2,6 +2,8 @@
 #define SimpleHists_Sampler_hh
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
 namespace SimpleHists {
 
@@ -14,19 +16,43 @@ namespace SimpleHists {
     //uniformly distributed between 0 and 1. Optionally supply a scale-factor to
     //sampled values (making it easy to incorporate unit conversions between
     //histogram bin units and needed unit of sampled quantities).
+    //
+    //By default, a bin is selected by a binary search in the cumulative bin
+    //contents, which makes the sampled value a monotonic function of the
+    //random number. The ALIAS method instead selects the bin in constant time
+    //via an alias table (Walker/Vose), which is faster for histograms with
+    //many bins, but maps random numbers to values differently (the sampled
+    //distribution is the same). In both cases values are distributed flat
+    //within the selected bin.
 
   public:
-    Sampler(Hist1D*, double scalefact = 1.0 );
+    enum class Method { CUMULATIVE, ALIAS };
+
+    Sampler(Hist1D*, double scalefact = 1.0, Method = Method::CUMULATIVE );
     ~Sampler();
 
     double sample(double rand) const;
     double operator()(double rand) const { return sample(rand); }
 
-    void reinit(Hist1D*, double scalefact = 1.0);
+    //Sample n values (out and rands may point to the same array):
+    void sampleMany(const double* rands, double* out, std::size_t n) const;
+
+    void reinit(Hist1D*, double scalefact = 1.0, Method = Method::CUMULATIVE);
+
+    Method method() const { return m_method; }
 
   private:
-    std::vector<double> m_cumul;
+    double sampleCumulative(double rand) const;
+    double sampleAlias(double rand) const;
+    void initAlias();
+    struct AliasEntry {
+      double prob;//probability to keep the bin rather than using its alias
+      std::uint32_t alias;
+    };
+    Method m_method;
+    std::vector<double> m_cumul;//(only kept for Method::CUMULATIVE)
     std::vector<double> m_edges;
+    std::vector<AliasEntry> m_alias;
   };
 }
 
@@ -5,19 +5,22 @@
 #include <algorithm>
 #include <functional>
 
-SimpleHists::Sampler::Sampler(Hist1D*h,double scalefact)
+SimpleHists::Sampler::Sampler(Hist1D*h,double scalefact,Method method)
+  : m_method(method)
 {
-  reinit(h,scalefact);
+  reinit(h,scalefact,method);
 }
 
 SimpleHists::Sampler::~Sampler()
 {
 }
 
-void SimpleHists::Sampler::reinit(SimpleHists::Hist1D*h,double scalefact)
+void SimpleHists::Sampler::reinit(SimpleHists::Hist1D*h,double scalefact,Method method)
 {
+  m_method = method;
   m_cumul.clear();
   m_edges.clear();
+  m_alias.clear();
 
   if (h->empty())
     throw std::runtime_error("SimpleHists::Sampler ERROR: Can't initialise from empty histogram");
@@ -80,9 +83,96 @@ void SimpleHists::Sampler::reinit(SimpleHists::Hist1D*h,double scalefact)
     m_edges.swap(tmp2);
   }
   assert(m_edges.size()==m_cumul.size()+1);
+
+  if (m_method==Method::ALIAS)
+    initAlias();
+}
+
+void SimpleHists::Sampler::initAlias()
+{
+  //Build alias table with Vose's algorithm, from the normalised bin contents
+  //scaled by the number of bins (so the average is 1):
+  const std::size_t n = m_cumul.size();
+  if (n>UINT32_MAX)
+    throw std::runtime_error("SimpleHists::Sampler ERROR: Too many bins for alias method");
+  std::vector<double> p;
+  p.reserve(n);
+  std::vector<std::uint32_t> small, large;
+  double prev(0.0);
+  for (std::size_t i = 0; i < n; ++i) {
+    p.push_back((m_cumul[i]-prev)*n);
+    prev = m_cumul[i];
+    (p.back()<1.0?small:large).push_back(static_cast<std::uint32_t>(i));
+  }
+  m_alias.resize(n);
+  while (!small.empty()&&!large.empty()) {
+    std::uint32_t s = small.back();
+    small.pop_back();
+    std::uint32_t l = large.back();
+    m_alias[s].prob = p[s];
+    m_alias[s].alias = l;
+    p[l] = (p[l]+p[s])-1.0;
+    if (p[l]<1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  //Remaining entries have probability 1 (up to rounding errors):
+  for (auto i : large)
+    m_alias[i] = { 1.0, i };
+  for (auto i : small)
+    m_alias[i] = { 1.0, i };
+
+  //Not needed any more:
+  m_cumul.clear();
+  m_cumul.shrink_to_fit();
 }
 
 double SimpleHists::Sampler::sample(double rand) const
+{
+  return m_method==Method::ALIAS ? sampleAlias(rand) : sampleCumulative(rand);
+}
+
+void SimpleHists::Sampler::sampleMany(const double* rands, double* out, std::size_t n) const
+{
+  const double * randsE = rands + n;
+  if (m_method==Method::ALIAS) {
+    for (;rands!=randsE;++rands,++out)
+      *out = sampleAlias(*rands);
+  } else {
+    for (;rands!=randsE;++rands,++out)
+      *out = sampleCumulative(*rands);
+  }
+}
+
+double SimpleHists::Sampler::sampleAlias(double rand) const
+{
+  if (!(rand>0.0))
+    return m_edges.front();
+  if (!(rand<1.0))
+    return m_edges.back();
+  //The integer part of rand*n selects an entry in the table, and the
+  //fractional part both whether to use the entry or its alias and the
+  //position within the resulting bin:
+  const std::size_t n = m_alias.size();
+  const double x = rand * n;
+  std::size_t i = std::min<std::size_t>(static_cast<std::size_t>(x),n-1);
+  const double f = x - i;
+  const AliasEntry& a = m_alias[i];
+  double rand2;
+  if (f<a.prob) {
+    rand2 = f / a.prob;
+  } else {
+    rand2 = (f-a.prob) / (1.0-a.prob);
+    i = a.alias;
+  }
+  const double e0 = m_edges[i];
+  const double e1 = m_edges[i+1];
+  double res = e0*(1.0-rand2) + rand2*e1;
+  return (res<e0?e0:(res>e1?e1:res));
+}
+
+double SimpleHists::Sampler::sampleCumulative(double rand) const
 {
   if (rand<=0.0)
     return m_edges.front();
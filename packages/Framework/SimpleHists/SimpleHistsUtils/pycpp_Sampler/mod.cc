@@ -4,33 +4,51 @@
 #include <pybind11/numpy.h>
 
 namespace SimpleHists_Sampler_py {
-  void reinit_1arg(SimpleHists::Sampler* s, SimpleHists::Hist1D*h) { s->reinit(h); }
 
-  py::object sampleMany(SimpleHists::Sampler* s, py::array_t<double> rand_vals) {
+  typedef py::array_t<double, py::array::c_style | py::array::forcecast> darray;
+
+  py::object sampleMany(SimpleHists::Sampler* s, darray rand_vals) {
     //Replace rand_vals with sample values and return. This is because I can't
     //figure out how to create a new object without compile-time dependencies on
     //numpy and without memory leaks.
     //TODO: Use new function in NumpyUtils to create the array.
-    auto n = rand_vals.size();
     double * vals = rand_vals.mutable_data();
-    double * valsE = vals + n;
-    for (;vals!=valsE;++vals)
-      *vals = s->sample(*vals);
+    s->sampleMany(vals,vals,rand_vals.size());
     return rand_vals;
   }
 
+  py::object sampleManyOut(SimpleHists::Sampler* s, darray rand_vals, py::array out) {
+    //Fill existing array out with sample values, leaving rand_vals untouched
+    //(out is not converted, as results in a copy would be lost):
+    typedef py::array_t<double, py::array::c_style> outarray;
+    if (!py::isinstance<outarray>(out))
+      throw std::runtime_error("SimpleHists::Sampler ERROR: Output array passed to sampleMany must be contiguous with dtype float64");
+    if (out.size()!=rand_vals.size())
+      throw std::runtime_error("SimpleHists::Sampler ERROR: Arrays passed to sampleMany must have same size");
+    s->sampleMany(rand_vals.data(),static_cast<double*>(out.mutable_data()),rand_vals.size());
+    return out;
+  }
+
 }
 
 PYTHON_MODULE( mod )
 {
   pyextra::pyimport("SimpleHists");
-  py::class_<SimpleHists::Sampler >(mod,"Sampler")
-    .def(py::init<SimpleHists::Hist1D*>())
-    .def(py::init<SimpleHists::Hist1D*,double>())
+  py::class_<SimpleHists::Sampler > pysampler(mod,"Sampler");
+  py::enum_<SimpleHists::Sampler::Method>(pysampler,"Method")
+    .value("CUMULATIVE",SimpleHists::Sampler::Method::CUMULATIVE)
+    .value("ALIAS",SimpleHists::Sampler::Method::ALIAS)
+    .export_values()
+    ;
+  pysampler
+    .def(py::init<SimpleHists::Hist1D*,double,SimpleHists::Sampler::Method>(),
+         py::arg("hist"),py::arg("scalefact")=1.0,py::arg("method")=SimpleHists::Sampler::Method::CUMULATIVE)
     .def("sample",&SimpleHists::Sampler::sample)
     .def("sampleMany",&SimpleHists_Sampler_py::sampleMany)
+    .def("sampleMany",&SimpleHists_Sampler_py::sampleManyOut)
     .def("__call__",&SimpleHists::Sampler::sample)
-    .def("reinit",&SimpleHists::Sampler::reinit)
-    .def("reinit",&SimpleHists_Sampler_py::reinit_1arg)
+    .def("reinit",&SimpleHists::Sampler::reinit,
+         py::arg("hist"),py::arg("scalefact")=1.0,py::arg("method")=SimpleHists::Sampler::Method::CUMULATIVE)
+    .def("method",&SimpleHists::Sampler::method)
     ;
 }
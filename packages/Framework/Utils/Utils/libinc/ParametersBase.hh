@@ -64,6 +64,11 @@ namespace Utils {
     //used to instantiate DummyParamHolder objects with similar parameters and
     //values as the original object.
     void serialiseParameters(char*& output, unsigned& outputLength) const;
+
+    //Set all parameters to the current values of the same parameters on
+    //another object (typically another instance of the same class):
+    void setParametersFrom(const ParametersBase& other);
+
     void noHardExitOnParameterFailure();//call to trigger runtime exceptions rather than exit(1) calls in case of problems.
 
     //Tie two parameters, so changes on one is propagated to the other (the
@@ -534,6 +534,26 @@ void Utils::ParametersBase::serialiseParameters(char*& output, unsigned& outputL
   assert(data==dataExpectedEnd);
 }
 
+void Utils::ParametersBase::setParametersFrom(const ParametersBase& other)
+{
+  if (other.m_imp->m_ignoreRanges)
+    setIgnoreRanges();
+  auto itE = other.m_imp->m_addedorder.end();
+  for (auto it = other.m_imp->m_addedorder.begin(); it!=itE; ++it) {
+    const std::string& n = it->first;
+    if (other.hasParameterDouble(n)) {
+      setParameterDouble(n,other.getParameterDoubleNoLock(n));
+    } else if (other.hasParameterInt(n)) {
+      setParameterInt(n,other.getParameterIntNoLock(n));
+    } else if (other.hasParameterString(n)) {
+      setParameterString(n,other.getParameterStringNoLock(n));
+    } else {
+      assert(other.hasParameterBoolean(n));
+      setParameterBoolean(n,other.getParameterBooleanNoLock(n));
+    }
+  }
+}
+
 void Utils::ParametersBase::exposeParameter(const std::string& other_name, ParametersBase * other, const std::string& new_name, bool tieOnClash )
 {
   std::string n = new_name.empty() ? other_name : new_name;
@@ -11,9 +11,17 @@ namespace ZLibUtils {
   //allows the caller to recycle the output buffer.
 
   //Note from TK ~10 years later: This is not exactly a great way to do it - and perhaps even UB.
+  //
+  //The compression level is 1 (fastest) to 9 (best compression), or -1 for the
+  //zlib default (currently 6).
 
-  void compressToBuffer(const char* indata, unsigned indataLength, std::vector<char>& output,unsigned& outdataLength);
+  void compressToBuffer(const char* indata, unsigned indataLength, std::vector<char>& output,unsigned& outdataLength, int level = -1);
   void decompressToBuffer(const char* indata, unsigned indataLength, std::vector<char>& output,unsigned& outdataLength);
+
+  //Decompress data from compressToBuffer directly into output, which must have
+  //room for exactly outdataLength bytes (throws if the data does not inflate to
+  //that size):
+  void decompressToRawBuffer(const char* indata, unsigned indataLength, char* output, unsigned outdataLength);
 }
 
 #endif
@@ -3,10 +3,12 @@
 #include "ZLibUtils/Compress.hh"
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <stdexcept>
 
-void ZLibUtils::compressToBuffer(const char* indata, unsigned indataLength, std::vector<char>& output,unsigned& outdataLength)
+void ZLibUtils::compressToBuffer(const char* indata, unsigned indataLength, std::vector<char>& output,unsigned& outdataLength, int level)
 {
+  assert(level==Z_DEFAULT_COMPRESSION||(level>=Z_BEST_SPEED&&level<=Z_BEST_COMPRESSION));
   outdataLength = 0;
   output.clear();
   assert(indataLength<UINT32_MAX);
@@ -18,8 +20,8 @@ void ZLibUtils::compressToBuffer(const char* indata, unsigned indataLength, std:
     return;
   }
   unsigned long outlength = output.capacity()-1 - sizeof(std::uint32_t);
-  int res = compress(reinterpret_cast<unsigned char*>(&(output[sizeof(std::uint32_t)])),&outlength,
-                     reinterpret_cast<const unsigned char*>(indata),indataLength);
+  int res = compress2(reinterpret_cast<unsigned char*>(&(output[sizeof(std::uint32_t)])),&outlength,
+                      reinterpret_cast<const unsigned char*>(indata),indataLength,level);
   if (res==Z_OK) {
     assert(outlength<UINT_MAX-sizeof(std::uint32_t));
     outdataLength = static_cast<unsigned>(outlength) + sizeof(std::uint32_t);
@@ -40,7 +42,8 @@ void ZLibUtils::decompressToBuffer(const char* indata, unsigned indataLength, st
 {
   output.clear();
   assert(indataLength>=sizeof(std::uint32_t));
-  std::uint32_t outdataLength_orig = *(reinterpret_cast<const std::uint32_t*>(indata));
+  std::uint32_t outdataLength_orig;
+  std::memcpy(&outdataLength_orig,indata,sizeof(std::uint32_t));//indata might not be aligned
   outdataLength = outdataLength_orig;
   if (outdataLength_orig==0&&indataLength==sizeof(std::uint32_t))
     {
@@ -50,7 +53,7 @@ void ZLibUtils::decompressToBuffer(const char* indata, unsigned indataLength, st
   output.reserve(outdataLength);
   unsigned long outlength = outdataLength;
   int res = uncompress(reinterpret_cast<unsigned char*>(&(output[0])),&outlength,
-                       reinterpret_cast<const unsigned char*>(indata)+sizeof(std::uint32_t),indataLength);
+                       reinterpret_cast<const unsigned char*>(indata)+sizeof(std::uint32_t),indataLength-sizeof(std::uint32_t));
   if (res==Z_OK) {
     assert(outlength<UINT_MAX-sizeof(std::uint32_t));
     outdataLength = static_cast<unsigned>(outlength);
@@ -72,3 +75,32 @@ void ZLibUtils::decompressToBuffer(const char* indata, unsigned indataLength, st
   }
   throw std::runtime_error("ZLibUtils::decompressToBuffer failed");
 }
+
+void ZLibUtils::decompressToRawBuffer(const char* indata, unsigned indataLength, char* output, unsigned outdataLength)
+{
+  assert(indataLength>=sizeof(std::uint32_t));
+  std::uint32_t outdataLength_orig;
+  std::memcpy(&outdataLength_orig,indata,sizeof(std::uint32_t));//indata might not be aligned
+  if (outdataLength_orig!=outdataLength) {
+    printf("ZLibUtils::decompressToRawBuffer ERROR: Unexpected size of compressed data. Data might be corrupted.\n");
+    throw std::runtime_error("ZLibUtils::decompressToRawBuffer failed");
+  }
+  if (outdataLength==0)
+    return;
+  unsigned long outlength = outdataLength;
+  int res = uncompress(reinterpret_cast<unsigned char*>(output),&outlength,
+                       reinterpret_cast<const unsigned char*>(indata)+sizeof(std::uint32_t),indataLength-sizeof(std::uint32_t));
+  if (res==Z_OK&&outlength==outdataLength)
+    return;
+  //something went wrong:
+  if (res==Z_MEM_ERROR) {
+    printf("ZLibUtils::decompressToRawBuffer ERROR: Z_MEM_ERROR during decompression.\n");
+  } else if (res==Z_DATA_ERROR||res==Z_OK) {
+    printf("ZLibUtils::decompressToRawBuffer ERROR: Z_DATA_ERROR during decompression. Data might be incomplete or corrupted.\n");
+  } else if (res==Z_BUF_ERROR) {
+    printf("ZLibUtils::decompressToRawBuffer ERROR: Z_BUF_ERROR during decompression.\n");
+  } else {
+    printf("ZLibUtils::decompressToRawBuffer ERROR: Unknown problem during decompression.\n");
+  }
+  throw std::runtime_error("ZLibUtils::decompressToRawBuffer failed");
+}